@@ -1,38 +1,47 @@
 #ifndef ARITHMETICS_H
 #define ARITHMETICS_H
 
-#include <concepts>
+#include <type_traits>
 
 namespace rainbow {
 
 /**
- * A concept for any "real" number
+ * True for any "real" number type
  */
 template<class T>
-concept Real = std::integral<T> || std::floating_point<T>;
+constexpr bool is_real = std::is_integral<T>::value || std::is_floating_point<T>::value;
 
 /**
- * A concept for any natural number
+ * True for any natural number type
  */
 template<class T>
-concept Natural = std::unsigned_integral<T>;
+constexpr bool is_natural = std::is_integral<T>::value && std::is_unsigned<T>::value;
 
 /**
  * Computes b^e using the fast exponentiation algorithm.
  * @brief Computes b^e.
  * @param b the base
  * @param e the exponent
- * @return b^2
+ * @return b^e
  */
-template<Real Number, Natural N>
-Number pow(Number b, N e);
+template<class Number, class N>
+constexpr Number pow(Number b, N e);
 
-template<Natural N>
-N factorial(N n);
+/**
+ * Computes n!.
+ * @brief Computes n!.
+ * @param n the natural
+ * @return n!
+ */
+template<class N>
+constexpr N factorial(N n);
 
-template<Real Number, Natural N>
-Number pow(Number base, N exp)
+template<class Number, class N>
+constexpr Number pow(Number base, N exp)
 {
+    static_assert(is_real<Number>, "The base must be a real number");
+    static_assert(is_natural<N>, "The exponent must be a natural number");
+
     if(exp == 0)
         return 1;
     else if(exp == 1)
@@ -43,15 +52,18 @@ Number pow(Number base, N exp)
         return base * pow(base * base, exp / 2);
 }
 
-template<Natural N>
-N factorial(N n)
+template<class N>
+constexpr N factorial(N n)
 {
-    unsigned prod = 1;
+    static_assert(is_natural<N>, "The parameter must be a natural number");
+
+    N prod = 1;
     while(n > 0)
     {
         prod *= n;
         n--;
     }
+    return prod;
 }
 
 }
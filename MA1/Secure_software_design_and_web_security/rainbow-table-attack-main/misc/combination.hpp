@@ -6,6 +6,8 @@
 #include <array>
 #include <iostream>
 #include <limits>
+#include <numeric>
+#include <stdexcept>
 
 //TODO: make common class for iterators ? They kinda look alike
 //TODO: make template specializations for N=0 &&|| K=0
@@ -19,16 +21,18 @@ namespace rainbow {
  * objects are picked matters not, that is, to compute the binomial
  * coefficient (n k).
  * <p>
- * Note that the triangle is not computed until a call to
- * <code>operator()</code> is made. Furthermore, once
- * <code>operator(n,k)</code> has been called, every subsequent calls
- * to this operator with lower <code>n</code> or <code>k</code> are
- * performed in constant time.
+ * Note that the whole triangle is computed by the constructor, row
+ * by row, so that every call to <code>operator()</code> is performed
+ * in constant time.
  * <p>
- * Note that this class uses n * n * sizeof(N) bytes of dynamic
- * memory while instanciated.
+ * Note that this class uses (n + 1) * (n + 2) / 2 * sizeof(N) bytes of
+ * dynamic memory while instanciated : row <code>n</code> only holds
+ * (n 0)...(n n). Should the maximum <code>n</code> be known at compile
+ * time, <code>BinomialTable</code> holds the same triangle without
+ * dynamic memory.
  * @brief This class models a pascal triangle used to compute the
  * binomial coefficient indexed by a pair of given naturals
+ * @see BinomialTable
  */
 //template<Natural N>
 template<class N>
@@ -37,8 +41,6 @@ class PascalTriangle
     N size;
     N* array;
 
-    N& memo(const N& n, const N& k) const;
-
     public:
         /**
          * Builds upp a pascal triangle used to compute and store binomial
@@ -75,20 +77,64 @@ class PascalTriangle
         PascalTriangle& operator=(PascalTriangle&&) noexcept;
 
         /**
-         * Computes and returns the binomial coefficient (n k).
-         * <p>
-         * Note that when this function is called with some <code>n</code>
-         * and some <code>k</code>, subsequent calls with lower
-         * <code>n</code> or <code>k</code> are executed in constant time.
+         * Returns the binomial coefficient (n k), in constant time.
          * <p>
          * The behaviour of this function is undefined if <code>n</code>
          * is larger than the <code>n</code> provided in the constructor.
-         * @brief Computes and returns the binomial coefficient (n k).
+         * @brief Returns the binomial coefficient (n k).
+         * @param n the parameter <code>n</code> in the binomial coefficient (n k).
+         * @param k the parameter <code>k</code> in the binomial coefficient (n k).
+         * @return the binomial coefficient (n k), 0 if k > n.
+         */
+        N operator()(const N& n, const N& k) const;
+};
+
+/**
+ * This class models a pascal triangle whose size is known at compile
+ * time, computed once and for all, at compile time when it is declared
+ * <code>constexpr</code>.
+ * <p>
+ * Rows are packed one after the other : row <code>n</code> holds the
+ * n + 1 coefficients (n 0)...(n n), so that the triangle takes
+ * (N + 1) * (N + 2) / 2 * sizeof(T) bytes, and no dynamic memory.
+ * <p>
+ * Coefficients too large for <code>T</code> are saturated to the
+ * largest value of <code>T</code> : with 64-bit naturals, every
+ * coefficient is exact up to N = 67.
+ * <p>
+ * <h3>Code example</h3>
+ * <p>
+ * <pre><code>
+ constexpr BinomialTable<64> binomials; //computed by the compiler
+ static_assert(binomials(64, 32) == 1832624140942590534ull);
+ </code></pre>
+ * @brief This class models a pascal triangle of fixed size, that may be
+ * computed at compile time
+ * @see PascalTriangle
+ */
+template<std::size_t N, class T = std::size_t>
+class BinomialTable
+{
+    std::array<T, (N + 1) * (N + 2) / 2> table;
+
+    public:
+        /**
+         * Builds up the triangle, row by row, with Pascal's rule.
+         * @brief Builds up the triangle
+         */
+        constexpr BinomialTable();
+
+        /**
+         * Returns the binomial coefficient (n k), in constant time.
+         * <p>
+         * The behaviour of this function is undefined if <code>n</code>
+         * is larger than <code>N</code>.
+         * @brief Returns the binomial coefficient (n k).
          * @param n the parameter <code>n</code> in the binomial coefficient (n k).
          * @param k the parameter <code>k</code> in the binomial coefficient (n k).
-         * @return the binomial coefficient (n k).
+         * @return the binomial coefficient (n k), 0 if k > n.
          */
-        N operator()(const N& n, const N& k);
+        constexpr T operator()(std::size_t n, std::size_t k) const;
 };
 
 /**
@@ -98,18 +144,20 @@ class PascalTriangle
  * <code>k</code> distinct objects among a set of <code>n</code> objects,
  * where the order in which these objects are picked matters not.
  * <p>
- * Should you need several consecutive calls to this function, it might be
- * significantly faster to directly use <code>PascalTriangle</code>.
- * <p>
- * Note that this algorithm uses n * n * sizeof(N) bytes of dynamic
- * memory while running.
+ * It is computed in min(k, n - k) steps, without dynamic memory, as
+ * the product of the (n - k + j) / j for j = 1, 2... : every partial
+ * product is itself a binomial coefficient, so that intermediate values
+ * do not overflow unless (n k) does. Should you need several
+ * consecutive calls to this function, it might be faster to directly
+ * use <code>PascalTriangle</code> or <code>BinomialTable</code>.
  * @brief Returns the binomial coefficient indexed by a pair of given
  * naturals.
  * @return the binomial coefficient indexed by a pair of given naturals.
  * @see PascalTriangle
+ * @see BinomialTable
  */
-template<Natural N>
-N binom(N n, N k);
+template<class N>
+constexpr N binom(N n, N k);
 
 /**
  * A type alias for combinations, modeled as bit-arrays of specific length.
@@ -420,6 +468,8 @@ class KCombinationGenerator
     std::size_t _nk;//(n k)
     bool over; //are there more combinations to generate ?
 
+    static constexpr BinomialTable<N> binomials {}; //(n k) for every n <= N, computed at compile time
+
     KCombinationGenerator(bool);//for symbolicEnd (the bool is a phantom param)
 
     friend class KCombinationIterator<N,K>;
@@ -475,6 +525,60 @@ class KCombinationGenerator
          */
         Combination<N> pick(std::size_t i) const;
 
+        /**
+         * Returns the positions of the objects selected by the
+         * i<sup>th</sup> k-combination according to the lexical order,
+         * in increasing order.
+         * <p>
+         * Each position is found by a binary search on the binomial
+         * coefficients, so that this call takes O(k log n) steps. pick
+         * also sets the n objects of its combination, in O(n) steps.
+         * @brief Returns the positions of the objects selected by the
+         * i<sup>th</sup> k-combination.
+         * @param i the index (according to lexical order) of the k-combination
+         * @return the positions of the k objects selected, in increasing order
+         * @throw std::out_of_range if i >= (n k)
+         */
+        static std::array<std::size_t, K> unrank(std::size_t i);
+
+        /**
+         * Returns the index of a k-combination according to the lexical
+         * order, given the positions of its selected objects in increasing
+         * order. This is the inverse of unrank.
+         * <p>
+         * It costs one lookup of a binomial coefficient per selected object,
+         * that is O(k) steps, while unrank costs O(k log n) steps.
+         * @brief Returns the index of a k-combination given its positions.
+         * @param positions the positions of the k objects selected, in increasing order
+         * @return the index of the k-combination according to lexical order
+         */
+        static std::size_t rank(const std::array<std::size_t, K>& positions);
+
+        /**
+         * Returns the index of a k-combination according to the lexical
+         * order. This is the inverse of pick.
+         * @brief Returns the index of a k-combination.
+         * @param comb a combination with exactly k objects selected
+         * @return the index of the k-combination according to lexical order
+         */
+        static std::size_t rank(const Combination<N>& comb);
+
+        /**
+         * Sets the generator so that the next call to next() returns
+         * the i<sup>th</sup> k-combination according to the lexical
+         * order, without generating the ones before it. With i = (n k),
+         * the generator is over after the next call to next().
+         * <p>
+         * This allows to split the k-combinations in ranges of indices,
+         * each enumerated by its own generator (on its own thread, for
+         * example). It costs a call to pick, that is O(n + k log n) steps.
+         * @brief Sets the generator on the i<sup>th</sup> k-combination.
+         * @param i the index (according to lexical order) of the next
+         * k-combination to generate
+         * @throw std::out_of_range if i > (n k)
+         */
+        void seek(std::size_t i);
+
         /**
          * Returns an iterator over k-combinations to generate.
          * <p>
@@ -508,12 +612,27 @@ class KCombinationGenerator
         inline KCombinationIterator<N,K> end() const;        
 };
 
-//template<Natural N> //takes n * n * sizeof(Natural) bytes in memory
+//fills the rows 0 to n of a pascal triangle packed row after row, saturating coefficients too large for T
+template<class T>
+constexpr void fillPascalTriangle(T* triangle, std::size_t n)
+{
+    for(std::size_t row = 0; row <= n; row++)
+    {
+        T* current = triangle + row * (row + 1) / 2;
+        const T* previous = triangle + (row - 1) * row / 2;
+
+        current[0] = current[row] = 1;
+        for(std::size_t k = 1; k < row; k++)
+            current[k] = previous[k - 1] > std::numeric_limits<T>::max() - previous[k] ?
+                             std::numeric_limits<T>::max() : previous[k - 1] + previous[k];
+    }
+}
+
+//template<Natural N> //takes (n + 1) * (n + 2) / 2 * sizeof(Natural) bytes in memory
 template<class N>
-PascalTriangle<N>::PascalTriangle(const N& n) : size(n), array(new N[n * n])
+PascalTriangle<N>::PascalTriangle(const N& n) : size(n), array(new N[(n + 1) * (n + 2) / 2])
 {
-    static auto zero = static_cast<N>(0);
-    std::fill_n(array, size, zero);
+    fillPascalTriangle(array, size);
 }
 
 //template<Natural N>
@@ -545,39 +664,40 @@ PascalTriangle<N>& PascalTriangle<N>::operator=(PascalTriangle<N>&& triangle) no
 
 //template<Natural N>
 template<class N>
-N& PascalTriangle<N>::memo(const N& n, const N& k) const
+N PascalTriangle<N>::operator()(const N& n, const N& k) const
 {
-    return array[size * n + k];
+    return k > n ? 0 : array[n * (n + 1) / 2 + k];
 }
 
-//template<Natural N>
-template<class N>
-N PascalTriangle<N>::operator()(const N& n, const N& k)
+template<std::size_t N, class T>
+constexpr BinomialTable<N, T>::BinomialTable() : table{}
 {
-    if(n == 0 || k == 0 || k == n)
-        return 1;
-    else if (k  > n)
-        return 0;
-    else if (k == 1)
-        return n;
-
-    //ALL HAIL DYNAMIC PROGRAMMING AND OUR GRANDMASTER BELLMAN !!!
-    N v1 = memo(n - 1, k - 1);
-    if (v1 == 0) //not memoized
-        v1 = memo(n - 1, k - 1) = (*this)(n - 1, k - 1); //I'm sexy and I know it
-
-    N v2 = memo(n - 1, k);
-    if (v2 == 0)
-        v2 = memo(n - 1, k) = (*this)(n - 1, k);
+    fillPascalTriangle(table.data(), N);
+}
 
-    return v1 + v2;
+template<std::size_t N, class T>
+constexpr T BinomialTable<N, T>::operator()(std::size_t n, std::size_t k) const
+{
+    return k > n ? 0 : table[n * (n + 1) / 2 + k];
 }
 
-template<Natural N>
-N binom(N n, N k) //takes n * n * sizeof(Natural) bytes in memory
+template<class N>
+constexpr N binom(N n, N k) //no dynamic memory
 {
-    PascalTriangle<N> triangle(n);
-    return triangle(n, k);
+    static_assert(is_natural<N>, "The parameters must be natural numbers");
+
+    if(k > n)
+        return 0;
+    k = std::min<N>(k, n - k); //(n k) = (n n-k)
+
+    N result = 1;
+    for(N j = 1; j <= k; j++) //result = (n-k+j-1 j-1), and (n-k+j j) = result * (n-k+j) / j
+    {
+        //j / g divides n - k + j since it is coprime with result / g
+        const N g = std::gcd(result, j);
+        result = (result / g) * ((n - k + j) / (j / g));
+    }
+    return result;
 }
 
 //fake constructor for end()
@@ -694,7 +814,7 @@ KCombinationGenerator<N,K>::KCombinationGenerator(bool) : comb(Combination<N>{})
 {}
 
 template<std::size_t N, std::size_t K>
-KCombinationGenerator<N,K>::KCombinationGenerator() : comb(Combination<N>{}), i(0), _nk(binom(N, K)), over(false)
+KCombinationGenerator<N,K>::KCombinationGenerator() : comb(Combination<N>{}), i(0), _nk(binomials(N, K)), over(false)
 {
     if(N != K)
     {
@@ -763,37 +883,78 @@ Combination<N> KCombinationGenerator<N,K>::next()
 template<std::size_t N, std::size_t K>
 Combination<N> KCombinationGenerator<N,K>::pick(size_t i) const
 {
-    if(i >= _nk)
-        throw std::out_of_range("Parameter must be between 0 and (n k) exclusive");
-    i++; //next algorithm starts at i=1
-
-    static PascalTriangle<std::size_t> n_choose_k(N);//we will cache values of (n, k)
     Combination<N> comb {};
+    for(std::size_t position : unrank(i))
+        comb[position] = true;
 
-    auto n = N;
-    auto k = K;
-    unsigned index = 0;
-    while(n <= N) //controlled overflow
+    return comb;
+}
+
+//In lexical order, the k-combinations whose object at some position is not selected come first. Thus, when the
+//t-th selected object (t = 0, 1...) is at position p, (n-1-p k-t) k-combinations precede it : the ones with the same
+//objects selected before p, p not selected, and the k-t objects left among the n-1-p positions after p.
+template<std::size_t N, std::size_t K>
+std::array<std::size_t, K> KCombinationGenerator<N,K>::unrank(std::size_t i)
+{
+    if(i >= binomials(N, K))
+        throw std::out_of_range("Parameter must be between 0 and (n k) exclusive");
+
+    std::array<std::size_t, K> positions {};
+    std::size_t first = 0; //first position left
+    for(std::size_t t = 0; t < K; t++)
     {
-        if(n > k)
-        {
-            if(i > n_choose_k(n - 1, k))
-            {
-                comb[index] = true;
-                i -= n_choose_k(n - 1, k);
-                k--;
-            } //else, bit is set to zero, but it already is
-        }
-        else
+        //the position of the t-th selected object is the first p >= first with (n-1-p k-t) <= i, and it is at most
+        //n-(k-t), where (k-t-1 k-t) = 0. (n-1-p k-t) decreases with p.
+        std::size_t low = first;
+        std::size_t high = N - (K - t);
+        while(low < high)
         {
-            comb[index] = true;
-            k--;
+            const std::size_t middle = low + (high - low) / 2;
+            if(binomials(N - 1 - middle, K - t) <= i)
+                high = middle;
+            else
+                low = middle + 1;
         }
-        index++;
-        n--;
+        positions[t] = low;
+        i -= binomials(N - 1 - low, K - t);
+        first = low + 1;
     }
 
-    return comb;
+    return positions;
+}
+
+template<std::size_t N, std::size_t K>
+std::size_t KCombinationGenerator<N,K>::rank(const std::array<std::size_t, K>& positions)
+{
+    std::size_t i = 0;
+    for(std::size_t t = 0; t < K; t++)
+        i += binomials(N - 1 - positions[t], K - t);
+
+    return i;
+}
+
+template<std::size_t N, std::size_t K>
+std::size_t KCombinationGenerator<N,K>::rank(const Combination<N>& comb)
+{
+    std::size_t i = 0;
+    std::size_t t = 0;
+    for(std::size_t position = 0; position < N && t < K; position++)
+        if(comb[position])
+            i += binomials(N - 1 - position, K - t++);
+
+    return i;
+}
+
+template<std::size_t N, std::size_t K>
+void KCombinationGenerator<N,K>::seek(std::size_t i)
+{
+    if(i > _nk)
+        throw std::out_of_range("Parameter must be between 0 and (n k) inclusive");
+
+    //comb is the last k-combination generated, and this->i the number of k-combinations generated
+    comb = pick(i == 0 ? 0 : i - 1);
+    this->i = i;
+    over = false;
 }
 
 template<std::size_t N, std::size_t K>
@@ -0,0 +1,207 @@
+#ifndef INPLACETASK_HPP
+#define INPLACETASK_HPP
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/**
+ * This class models a task : a move-only function taking no argument and returning nothing.
+ * <p>
+ * Unlike std::function, the function is stored in the task itself when it fits in CAPACITY bytes (a lambda capturing
+ * a few references, pointers, sizes or shared pointers, or a std::packaged_task), so that building, moving and running
+ * such a task never allocates memory. Larger functions, and functions that may throw when moved, are stored on the
+ * heap. It also accepts functions that cannot be copied, such as std::packaged_task.
+ * <p>
+ * A task is one cache line : CAPACITY bytes for the function, and a pointer to the operations of its type.
+ * @brief This class models a move-only task, stored in place when it is small enough
+ */
+class InplaceTask
+{
+    public:
+        /**
+         * The size of the largest function stored in place
+         */
+        static constexpr size_t CAPACITY = 56;
+
+    private:
+        //what a task does with its function, one table per type of function
+        struct Operations
+        {
+            void (*invoke)(void * storage);
+            void (*relocate)(void * from, void * to); //moves the function from from to to, and destroys it in from
+            void (*destroy)(void * storage);
+        };
+
+        template<class Function>
+        static constexpr bool fits = sizeof(Function) <= CAPACITY && alignof(Function) <= alignof(std::max_align_t)
+                                     && std::is_nothrow_move_constructible<Function>::value;
+
+        template<class Function>
+        struct InPlace
+        {
+            static Function * get(void * storage)
+            {
+                return std::launder(static_cast<Function *>(storage));
+            }
+
+            static void invoke(void * storage)
+            {
+                (*get(storage))();
+            }
+
+            static void relocate(void * from, void * to)
+            {
+                new (to) Function(std::move(*get(from)));
+                get(from)->~Function();
+            }
+
+            static void destroy(void * storage)
+            {
+                get(storage)->~Function();
+            }
+
+            static constexpr Operations operations = {invoke, relocate, destroy};
+        };
+
+        template<class Function>
+        struct OnHeap //the storage holds a pointer to the function
+        {
+            static Function *& get(void * storage)
+            {
+                return *std::launder(static_cast<Function **>(storage));
+            }
+
+            static void invoke(void * storage)
+            {
+                (*get(storage))();
+            }
+
+            static void relocate(void * from, void * to)
+            {
+                new (to) Function *(get(from));
+            }
+
+            static void destroy(void * storage)
+            {
+                delete get(storage);
+            }
+
+            static constexpr Operations operations = {invoke, relocate, destroy};
+        };
+
+        alignas(std::max_align_t) unsigned char storage[CAPACITY];
+        const Operations * operations; //nullptr for an empty task
+
+    public:
+        /**
+         * Builds up an empty task
+         * @brief Builds up an empty task
+         */
+        InplaceTask() : operations(nullptr)
+        {
+        }
+
+        /**
+         * Builds up a task running f
+         * @brief Builds up a task running f
+         * @param f the function to run, moved or copied into the task
+         * @tparam Function the type of the function, callable as f()
+         */
+        template<class Function, class = std::enable_if_t<! std::is_same<std::decay_t<Function>, InplaceTask>::value>>
+        InplaceTask(Function && f)
+        {
+            using Stored = std::decay_t<Function>;
+            if constexpr(fits<Stored>)
+            {
+                new (storage) Stored(std::forward<Function>(f));
+                operations = &InPlace<Stored>::operations;
+            }
+            else
+            {
+                new (storage) Stored *(new Stored(std::forward<Function>(f)));
+                operations = &OnHeap<Stored>::operations;
+            }
+        }
+
+        /**
+         * Move constructor : other is left empty
+         * @brief Move constructor
+         */
+        InplaceTask(InplaceTask && other) noexcept : operations(other.operations)
+        {
+            if(operations != nullptr)
+                operations->relocate(other.storage, storage);
+            other.operations = nullptr;
+        }
+
+        /**
+         * Move-assignment operator : other is left empty
+         * @brief Move-assignment operator
+         */
+        InplaceTask & operator=(InplaceTask && other) noexcept
+        {
+            if(this != &other)
+            {
+                reset();
+                operations = other.operations;
+                if(operations != nullptr)
+                    operations->relocate(other.storage, storage);
+                other.operations = nullptr;
+            }
+            return *this;
+        }
+
+        /**
+         * Deleted copy constructor
+         * @brief Deleted copy constructor
+         */
+        InplaceTask(const InplaceTask &) = delete;
+
+        /**
+         * Deleted assignment operator
+         * @brief Deleted assignment operator
+         */
+        InplaceTask & operator=(const InplaceTask &) = delete;
+
+        /**
+         * Destructor : destroys the function
+         * @brief Destructor : destroys the function
+         */
+        ~InplaceTask()
+        {
+            reset();
+        }
+
+        /**
+         * Destroys the function, the task is left empty
+         * @brief Destroys the function
+         */
+        void reset()
+        {
+            if(operations != nullptr)
+                operations->destroy(storage);
+            operations = nullptr;
+        }
+
+        /**
+         * Runs the function. The task must not be empty.
+         * @brief Runs the function
+         */
+        void operator()()
+        {
+            operations->invoke(storage);
+        }
+
+        /**
+         * Returns true if the task holds a function, false if it is empty
+         * @brief Returns true if the task holds a function
+         */
+        explicit operator bool() const
+        {
+            return operations != nullptr;
+        }
+};
+
+#endif // INPLACETASK_HPP
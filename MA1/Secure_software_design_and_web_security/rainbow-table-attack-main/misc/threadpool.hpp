@@ -1,16 +1,19 @@
 #ifndef THREADPOOL_HPP
 #define THREADPOOL_HPP
 
-#include <queue>
 #include <functional>
 #include <thread>
 #include <vector>
 #include <mutex>
+#include <condition_variable>
 #include <future>
+#include <atomic>
+#include <memory>
+#include <exception>
+#include <stdexcept>
+#include <algorithm>
 
-#include <iostream>
-
-//TODO : write ThreadPool::join()
+#include "inplacetask.hpp"
 
 /**
  * Simple alias type for unique locks
@@ -23,15 +26,29 @@ using GuardLock = std::unique_lock<std::mutex>;
  * It is possible to enqueue tasks (that is, functions taking an arbitrary number of arguments and potentially
  * returning a value) that will be runned when a worker is free.
  * <p>
- * It is also possile to stop every worker. In that case, any running tasks finish their work, and emaining tasks
- * are not runned. Note that after calling this function, calling std::future::get on a tasks that has not been
- * runned will block with no possibility of unblocking.
+ * Enqueuing a task allocates the shared state of its future. Tasks whose result nobody waits for are better submitted
+ * (submit, or enqueue_n for many of them under one lock per worker) : the tasks are stored in place (see InplaceTask)
+ * in queues that only allocate memory when they grow, so that submitting a small task does not allocate at all.
+ * <p>
+ * Every worker has its own queue of tasks, so that workers taking tasks do not all wait on the same lock. A worker
+ * takes the tasks of its queue from the front, and when its queue is empty it steals tasks from the back of the
+ * queues of the other workers. Tasks enqueued from outside the pool are spread over the queues in turn, tasks
+ * enqueued by a task go to the queue of its worker.
+ * <p>
+ * Ranges of indices are better split with parallel_for than enqueued chunk by chunk : every worker gets a contiguous
+ * part of the range, that it runs chunk by chunk, and a worker that is done with its part takes chunks from the end
+ * of the part of another one.
+ * <p>
+ * It is possible to wait until every enqueued task has run (wait_idle), to wait and then stop the workers (join), or
+ * to stop every worker at once (stop). In the last case, any running tasks finish their work, and remaining tasks
+ * are not runned. Note that after calling stop, calling std::future::get on a task that has not been runned blocks
+ * until the pool is destroyed, and then throws std::future_error (broken promise).
  * <p>
  * Also note that it is possible to specify the behaviour of the destructor of this class, by telling wether or not the
  * worker threads need to be stopped when a threadpool object is deallocated. By default, this parameter is set as true.
  * Note that when set true, it means that on deallocation, the current tasks that are running are finished (and are not
  * brutally stopped), and no other tasks are ran. It is then possible that when stopped, there are still some remaining
- * enqueued tasks that have not been ran.
+ * enqueued tasks that have not been ran. When set false, the destructor joins the pool : every enqueued task is ran.
  * <p>
  * <h3>Code example</h3>
  * <p>
@@ -43,7 +60,7 @@ using GuardLock = std::unique_lock<std::mutex>;
 
  int main()
  {
-    dg::utils::ThreadPool t(5); //a pool of five threads
+    ThreadPool t(5); //a pool of five threads
 
     std::vector<std::future<int>> v; //int because make_addition returns ints
 
@@ -53,40 +70,127 @@ using GuardLock = std::unique_lock<std::mutex>;
 
     for(unsigned i = 0; i < v.size(); i++)
         cout << v[i].get() << endl; //get blocks until the result has been computed
+
+    std::vector<int> squares(100000);
+    t.parallel_for(0, squares.size(), 1000, [&](size_t first, size_t last) //chunks of at most 1000 indices
+    {
+        for(size_t i = first; i < last; i++)
+            squares[i] = i * i;
+    }); //returns when every chunk has been done
   }
   </code></pre>
  * @brief This class models a thread pool with a specified number of workers.
  */
-class ThreadPool //FIXME : I suspect I'm vulnerable to race / spurious wakeups
+class ThreadPool
 {
-    class ThreadWorker
+    using Task = InplaceTask;
+
+    //the tasks of one worker : it takes them from the front, the other workers steal them from the back. They are
+    //kept in a ring buffer, that only allocates when it grows.
+    struct WorkerQueue
     {
-        static int id_count;
+        std::mutex mutex;
+        std::vector<Task> slots; //the capacity of the ring, zero or a power of two
+        size_t first = 0;
+        size_t count = 0;
+
+        bool empty() const
+        {
+            return count == 0;
+        }
+
+        void push_back(Task && task)
+        {
+            if(count == slots.size())
+            {
+                std::vector<Task> grown(std::max<size_t>(16, 2 * slots.size()));
+                for(size_t i = 0; i < count; i++)
+                    grown[i] = std::move(slots[(first + i) & (slots.size() - 1)]);
+                slots.swap(grown);
+                first = 0;
+            }
+            slots[(first + count) & (slots.size() - 1)] = std::move(task);
+            count++;
+        }
+
+        void pop_front(Task & task)
+        {
+            task = std::move(slots[first]);
+            first = (first + 1) & (slots.size() - 1);
+            count--;
+        }
+
+        void pop_back(Task & task)
+        {
+            count--;
+            task = std::move(slots[(first + count) & (slots.size() - 1)]);
+        }
+    };
 
-        const int _id; //incremented automaticaly from id_count
+    class ThreadWorker
+    {
         ThreadPool * pool; //it's just an adress : nothing is allocated
+        const unsigned _index; //index of its queue in pool->queues
 
         public:
-            explicit ThreadWorker(ThreadPool * pool);
-
-            ThreadWorker(ThreadWorker&&) = default;
+            ThreadWorker(ThreadPool * pool, unsigned index);
 
-            ThreadWorker(const ThreadWorker& w) = delete;
-            ThreadWorker& operator =(const ThreadWorker &) = delete;
-            ThreadWorker& operator =(ThreadWorker &&) = delete;
+            unsigned index() const;
 
-            int id() const; //for debugging purposes
+            void operator()(); //runs the tasks of its queue, steals when it is empty, sleeps when there is none left
+    };
 
-            void operator()(); //waits until notified, then it takes the first task and runs it
+    //the chunks of the part of a parallel_for range given to a worker, [next, end) in chunks
+    struct ChunkRange
+    {
+        std::mutex mutex;
+        size_t next;
+        size_t end;
     };
 
+    //a parallel_for call, shared by its caller and its range tasks : when the pool is stopped, the caller returns
+    //while range tasks that never ran are still queued. Those only touch the function of the caller once active.
+    struct ParallelFor
+    {
+        std::unique_ptr<ChunkRange[]> ranges;
+        unsigned nb_ranges;
+        size_t begin;
+        size_t end;
+        size_t grain;
+        std::atomic<bool> failed;
+        std::exception_ptr error; //the first exception thrown by a chunk
+        unsigned running = 0; //range tasks not done yet
+        unsigned active = 0; //range tasks started and not done yet
+    }; //error, running and active are protected by idle_mutex, changes of running and active are notified on idle_condition
+
     bool _stop_on_deallocation;
-    bool _stopped; //did we ask to stop it ?
-    std::queue<std::function<void()>> tasks; //list of tasks yet to perform
-    //std::array<std::thread, N> threads; //running threads
+    std::atomic<bool> _stopped; //did we ask to stop it ?
+    std::vector<std::unique_ptr<WorkerQueue>> queues; //one per worker
     std::vector<std::thread> threads;
-    std::mutex mutex; //mutex
-    std::condition_variable condition; //for notifying
+    std::function<void(unsigned)> _on_start;
+
+    std::atomic<size_t> queued; //tasks in the queues, changed under the lock of the queue
+    std::atomic<size_t> unfinished; //tasks enqueued and not finished yet
+    std::atomic<unsigned> sleeping; //workers waiting on condition
+    std::atomic<unsigned> next_queue; //queue of the next task enqueued from outside the pool
+
+    std::mutex mutex; //for the sleeping workers
+    std::condition_variable condition; //for notifying them
+    std::mutex idle_mutex;
+    std::mutex join_mutex; //stop and the destructor may join the workers at once
+    std::condition_variable idle_condition; //for notifying wait_idle and parallel_for
+
+    static inline thread_local ThreadPool * current_pool = nullptr; //the pool of the calling worker, if any
+    static inline thread_local unsigned current_index = 0;
+
+    void push(Task task);
+    void push(unsigned index, Task task);
+    bool pop(unsigned index, Task & task);
+    void wake(size_t count);
+    void run(Task & task);
+    void join_workers(bool detach_self); //joins every worker but the calling one, which is detached if detach_self
+
+    static bool take_chunk(ParallelFor & state, unsigned index, size_t & chunk);
 
     public:
         /**
@@ -97,15 +201,21 @@ class ThreadPool //FIXME : I suspect I'm vulnerable to race / spurious wakeups
          * this parameter is set as true. Note that when set true, it means that on deallocation, the current
          * tasks that are running are finished (and are not brutally stopped), and no other tasks are ran. It
          * is then possible that when stopped, there are still some remaining enqueued tasks that have not been
-         * ran.
+         * ran. When set false, the destructor runs them all first.
          * @brief Builds up a thread pool
-         * @param n the number of worker threads to run
+         * @param n the number of worker threads to run, at least one
          * @param stop_on_deallocation true if you want to stop the workers when deallocating the pool
+         * @param on_start called by each worker with its index before it runs any task (to pin it, for example)
          */
-        explicit ThreadPool(unsigned n = std::thread::hardware_concurrency(), bool stop_on_deallocation = true);
+        explicit ThreadPool(unsigned n = std::thread::hardware_concurrency(), bool stop_on_deallocation = true,
+                            std::function<void(unsigned)> on_start = nullptr);
 
         /**
-          * Destructor : stops the pool if <code>stop_on_deallocation</code> is true.
+          * Destructor : stops the pool if <code>stop_on_deallocation</code> is true, joins it otherwise.
+          * <p>
+          * It does not throw. It may run in a task of the pool (which held the last reference to it, for example) :
+          * the tasks queued are then run by that task when <code>stop_on_deallocation</code> is false, and its worker
+          * leaves the pool as soon as the task returns.
           * @brief Destructor : stops the pool if <code>stop_on_deallocation</code> is true.
           */
         ~ThreadPool();
@@ -137,23 +247,53 @@ class ThreadPool //FIXME : I suspect I'm vulnerable to race / spurious wakeups
         /**
          * Stops the thread pool.
          * <p>
-         * Basically, any running tasks finish their work. Remaining tasks are not runned.
+         * Basically, any running tasks finish their work. Remaining tasks are not runned. It may be called from a
+         * task of the pool : the other workers are joined, and its own worker leaves once the task returns.
          * <p>
          * Note that after calling this function, calling std::future::get on a tasks that has
-         * not been runned will block with no possibility of unblocking.
+         * not been runned blocks until the pool is destroyed.
          * @brief Stops the pool
          */
         void stop();
 
-        //TODO
-        //void join();
+        /**
+         * Waits until every enqueued task has been runned, then stops the pool.
+         * <p>
+         * Throws std::runtime_error when called from a task of the pool, as wait_idle does.
+         * @brief Runs the remaining tasks, then stops the pool
+         */
+        void join();
+
+        /**
+         * Waits until every enqueued task has been runned, including the tasks they enqueue. The pool keeps running.
+         * It also returns when the pool is stopped, without waiting for the tasks that will not be runned.
+         * <p>
+         * Throws std::runtime_error when called from a task of the pool, that would wait for itself.
+         * @brief Waits until every enqueued task has been runned
+         */
+        void wait_idle();
 
         /**
          * Returns true if the pool is stopped, fasle otherwise.
          * @brief Returns true if the pool is stopped, fasle otherwise.
          * @return true if the pool is stopped, fasle otherwise.
          */
-        inline bool stopped() const;
+        bool stopped() const;
+
+        /**
+         * Returns the number of workers
+         * @brief Returns the number of workers
+         * @return the number of workers
+         */
+        unsigned size() const;
+
+        /**
+         * Returns the index of the calling worker in its pool, in [0, size()), or -1 if the calling thread
+         * is not a worker
+         * @brief Returns the index of the calling worker in its pool
+         * @return the index of the calling worker, or -1
+         */
+        static int worker_index();
 
         /**
          * Enqueues a task (a function with its arguments) on the pool
@@ -164,103 +304,410 @@ class ThreadPool //FIXME : I suspect I'm vulnerable to race / spurious wakeups
          */
         template<class Function, class ... Args>
         auto enqueue(Function&& f, Args&& ... args) -> std::future<decltype(f(args...))>;
-};
 
-int ThreadPool::ThreadWorker::id_count = 1;
+        /**
+         * Submits a task whose result is not waited for : there is no future, and no memory is allocated when f
+         * fits in an InplaceTask. Use wait_idle to wait for it.
+         * <p>
+         * f must not throw : an exception leaving a task ends the program, as with any thread.
+         * @brief Submits a task without a future
+         * @param f the function to call, as f()
+         * @tparam Function the type of the function to run
+         */
+        template<class Function>
+        void submit(Function&& f);
+
+        /**
+         * Submits n tasks calling f(0), f(1)... f(n - 1), as submit does, with one lock per worker queue rather
+         * than one per task. Each task holds a copy of f : keep f small (references, pointers, shared pointers)
+         * for the tasks to be stored in place.
+         * @brief Submits n tasks calling f(i), under one lock per worker
+         * @param n the number of tasks
+         * @param f the function to call, as f(size_t i)
+         * @tparam Function the type of the function to run
+         */
+        template<class Function>
+        void enqueue_n(size_t n, const Function& f);
+
+        /**
+         * Calls f(first, last) on chunks [first, last) of at most grain indices covering [begin, end), on the
+         * workers, and returns when every chunk has been done.
+         * <p>
+         * The first exception thrown by f is rethrown here, once the running chunks are done : the chunks not
+         * started yet are skipped. A task of the pool calling parallel_for runs other tasks while it waits.
+         * <p>
+         * If the pool is stopped meanwhile, it returns as soon as the running chunks are done, as wait_idle does :
+         * the chunks not started are skipped, check stopped() to tell. Throws std::runtime_error if the pool is
+         * already stopped.
+         * @brief Splits [begin, end) in chunks of grain indices, run by the workers
+         * @param begin the first index
+         * @param end the index after the last one
+         * @param grain the maximal number of indices of a chunk
+         * @param f the function to call on each chunk
+         * @tparam Function the type of the function, callable as f(size_t first, size_t last)
+         */
+        template<class Function>
+        void parallel_for(size_t begin, size_t end, size_t grain, Function&& f);
+};
 
-ThreadPool::ThreadWorker::ThreadWorker(ThreadPool * pool) : _id(id_count), pool(pool)
+inline ThreadPool::ThreadWorker::ThreadWorker(ThreadPool * pool, unsigned index) : pool(pool), _index(index)
 {
-    id_count++;
 }
 
-int ThreadPool::ThreadWorker::id() const
+inline unsigned ThreadPool::ThreadWorker::index() const
 {
-    return _id;
+    return _index;
 }
 
-void ThreadPool::ThreadWorker::operator()()
+inline void ThreadPool::ThreadWorker::operator()()
 {
-    while(! pool->stopped()) //I want to join if the pool is stopped
+    current_pool = pool;
+    current_index = _index;
+    if(pool->_on_start)
+        pool->_on_start(_index);
+
+    Task task;
+    while(true)
     {
-        GuardLock lock(pool->mutex);
-        if(pool->tasks.empty()) //wait if there is nothing to do
-            pool->condition.wait(lock);
+        if(pool->_stopped.load()) //I want to join if the pool is stopped
+            return;
 
-        if(! pool->tasks.empty()) //if there is work to do, do it
+        if(pool->pop(_index, task))
         {
-            std::function<void()> f = pool->tasks.front();
-            pool->tasks.pop();
-
-            lock.unlock(); //looks suspicious, but isn't
-
-            f();
+            pool->run(task);
+            if(current_pool == nullptr) //the task destroyed the pool
+                return;
+            continue;
         }
+
+        GuardLock lock(pool->mutex);
+        //sleeping is raised before queued is read, and push raises queued before it reads sleeping : either
+        //this worker sees the task, or push sees this worker and notifies it under the lock
+        pool->sleeping++;
+        pool->condition.wait(lock, [this] { return pool->_stopped.load() || pool->queued.load() > 0; });
+        pool->sleeping--;
     }
 }
 
-ThreadPool::ThreadPool(unsigned n, bool stop_on_deallocation)
+inline ThreadPool::ThreadPool(unsigned n, bool stop_on_deallocation, std::function<void(unsigned)> on_start)
     : _stop_on_deallocation(stop_on_deallocation),
       _stopped(false), //as soon as I enqueue a function, it will start running
-      tasks(std::queue<std::function<void()>>()), //stuff to do
-      //threads(std::array<std::thread, N>()), //pool with N threads
-      threads(std::vector<std::thread>(n)),
-      mutex(std::mutex()),
-      condition(std::condition_variable()) //mutex
+      _on_start(std::move(on_start)),
+      queued(0),
+      unfinished(0),
+      sleeping(0),
+      next_queue(0)
 {
-    for (unsigned i = 0; i < n; ++i)
-          threads[i] = std::thread { ThreadWorker(this) };
+    n = std::max(n, 1u);
+    for(unsigned i = 0; i < n; i++)
+        queues.emplace_back(new WorkerQueue());
+    //the queues are all there before any worker steals from them
+    for(unsigned i = 0; i < n; i++)
+        threads.emplace_back(ThreadWorker(this, i));
 }
 
-ThreadPool::~ThreadPool()
+inline ThreadPool::~ThreadPool()
 {
-    if(_stop_on_deallocation)
-        stop();
+    if(current_pool == this) //destroyed by one of its tasks, that cannot wait for itself
+    {
+        Task task;
+        if(! _stop_on_deallocation) //it runs the queued tasks itself
+            while(! _stopped.load() && pop(current_index, task))
+                run(task);
+        current_pool = nullptr; //its worker leaves once the task returns, without touching the pool
+    }
+    else if(! _stop_on_deallocation)
+        wait_idle();
+    stop();
+    //a worker that called stop is joined here, the one running this destructor goes on without the pool
+    join_workers(true);
 }
 
-void ThreadPool::stop()
+inline void ThreadPool::stop()
 {
-    if(_stopped)
-        return;
-
-    _stopped = true;
+    { //lock to stop, so that no worker misses the notification
+        GuardLock lock(mutex);
+        if(_stopped.exchange(true))
+            return;
+    }
     condition.notify_all();
 
-    for(unsigned i = 0; i < threads.size(); i++)
-        if(threads[i].joinable())
-            threads[i].join();
+    { //nor a thread in wait_idle
+        GuardLock lock(idle_mutex);
+    }
+    idle_condition.notify_all();
+
+    join_workers(false);
 }
 
-//void ThreadPool::join() //I suspect foulness
-//{
-//    GuardLock lock(mutex);
-//    while(! tasks.empty())
-//        condition.wait(lock);
-//}
+inline void ThreadPool::join_workers(bool detach_self)
+{
+    GuardLock lock(join_mutex);
+    for(std::thread & thread : threads)
+        if(thread.get_id() == std::this_thread::get_id())
+        {
+            if(detach_self)
+                thread.detach();
+        }
+        else if(thread.joinable())
+            thread.join();
+}
 
-bool ThreadPool::stopped() const
+inline void ThreadPool::join()
 {
-    return _stopped;
+    wait_idle();
+    stop();
+}
+
+inline void ThreadPool::wait_idle()
+{
+    if(current_pool == this)
+        throw std::runtime_error("ThreadPool::wait_idle called from a task of the pool");
+
+    GuardLock lock(idle_mutex);
+    idle_condition.wait(lock, [this] { return _stopped.load() || unfinished.load() == 0; });
+}
+
+inline bool ThreadPool::stopped() const
+{
+    return _stopped.load();
+}
+
+inline unsigned ThreadPool::size() const
+{
+    return threads.size();
+}
+
+inline int ThreadPool::worker_index()
+{
+    return current_pool != nullptr ? static_cast<int>(current_index) : -1;
+}
+
+inline void ThreadPool::push(Task task)
+{
+    //a task enqueued by a task stays on the queue of its worker, the others are spread over the queues
+    push(current_pool == this ? current_index : next_queue++ % queues.size(), std::move(task));
+}
+
+inline void ThreadPool::push(unsigned index, Task task)
+{
+    unfinished++;
+    {
+        GuardLock lock(queues[index]->mutex);
+        queues[index]->push_back(std::move(task));
+        queued++;
+    }
+    wake(1);
+}
+
+inline bool ThreadPool::pop(unsigned index, Task & task)
+{
+    { //its own queue first
+        WorkerQueue & own = *queues[index];
+        GuardLock lock(own.mutex);
+        if(! own.empty())
+        {
+            own.pop_front(task);
+            queued--;
+            return true;
+        }
+    }
+
+    for(unsigned k = 1; k < queues.size() && queued.load() > 0; k++)
+    {
+        WorkerQueue & victim = *queues[(index + k) % queues.size()];
+        GuardLock lock(victim.mutex);
+        if(! victim.empty())
+        {
+            victim.pop_back(task);
+            queued--;
+            return true;
+        }
+    }
+    return false;
+}
+
+inline void ThreadPool::wake(size_t count)
+{
+    if(sleeping.load() == 0) //nobody to wake up, and no lock to take
+        return;
+
+    { //a worker between its check of queued and its wait holds the lock
+        GuardLock lock(mutex);
+    }
+    if(count == 1)
+        condition.notify_one();
+    else
+        condition.notify_all();
+}
+
+inline void ThreadPool::run(Task & task)
+{
+    task();
+    task.reset(); //what it captured is released before wait_idle returns
+    if(current_pool == nullptr) //the task destroyed the pool
+        return;
+
+    if(unfinished.fetch_sub(1) == 1)
+    {
+        GuardLock lock(idle_mutex);
+        idle_condition.notify_all();
+    }
+}
+
+inline bool ThreadPool::take_chunk(ParallelFor & state, unsigned index, size_t & chunk)
+{
+    { //the next chunk of its own range
+        ChunkRange & own = state.ranges[index];
+        GuardLock lock(own.mutex);
+        if(own.next < own.end)
+        {
+            chunk = own.next++;
+            return true;
+        }
+    }
+
+    for(unsigned k = 1; k < state.nb_ranges; k++) //or the last chunk of another range
+    {
+        ChunkRange & victim = state.ranges[(index + k) % state.nb_ranges];
+        GuardLock lock(victim.mutex);
+        if(victim.next < victim.end)
+        {
+            chunk = --victim.end;
+            return true;
+        }
+    }
+    return false;
 }
 
 template<class Function, class ... Args>
 auto ThreadPool::enqueue(Function&& f, Args&& ... args) -> std::future<decltype(f(args...))>
 {
-    std::function<decltype(f(args...))()> func = std::bind(std::forward<Function>(f), std::forward<Args>(args)...);
-    auto task_ptr = std::make_shared<std::packaged_task<decltype(f(args...))()>>(func);
+    //the shared state of the future holds the function and its arguments, the task only points to it
+    std::packaged_task<decltype(f(args...))()> task(std::bind(std::forward<Function>(f), std::forward<Args>(args)...));
+    std::future<decltype(f(args...))> future = task.get_future();
+    push(Task(std::move(task)));
+    return future;
+}
+
+template<class Function>
+void ThreadPool::submit(Function&& f)
+{
+    push(Task(std::forward<Function>(f)));
+}
+
+template<class Function>
+void ThreadPool::enqueue_n(size_t n, const Function& f)
+{
+    if(n == 0)
+        return;
 
-    std::function<void()> wrapper = [task_ptr]() //wrapper to match types of 'tasks'... ugly
+    //consecutive tasks on the same queue, each queue locked once
+    const unsigned nb_queues = std::min<size_t>(queues.size(), n);
+    const unsigned offset = next_queue.fetch_add(nb_queues);
+    unfinished += n;
+    for(unsigned q = 0; q < nb_queues; q++)
     {
-        (*task_ptr)();
-    };
+        WorkerQueue & queue = *queues[(offset + q) % queues.size()];
+        {
+            GuardLock lock(queue.mutex);
+            for(size_t i = n * q / nb_queues; i < n * (q + 1) / nb_queues; i++)
+                queue.push_back(Task([f, i]() { f(i); }));
+            queued += n * (q + 1) / nb_queues - n * q / nb_queues;
+        }
+    }
+    wake(n);
+}
 
-    { //lock to push
-        GuardLock lock(mutex);
-        tasks.push(wrapper);
-    } //lock released on scope exit
+template<class Function>
+void ThreadPool::parallel_for(size_t begin, size_t end, size_t grain, Function&& f)
+{
+    if(begin >= end)
+        return;
+    if(_stopped.load())
+        throw std::runtime_error("ThreadPool::parallel_for called on a stopped pool");
+
+    grain = std::max<size_t>(grain, 1);
+    const size_t nb_chunks = (end - begin - 1) / grain + 1;
+
+    //one range of consecutive chunks per worker, no more ranges than chunks
+    std::shared_ptr<ParallelFor> state = std::make_shared<ParallelFor>();
+    state->nb_ranges = std::min<size_t>(queues.size(), nb_chunks);
+    state->ranges.reset(new ChunkRange[state->nb_ranges]);
+    state->begin = begin;
+    state->end = end;
+    state->grain = grain;
+    state->failed = false;
+    state->running = state->nb_ranges;
+    for(unsigned r = 0; r < state->nb_ranges; r++)
+    {
+        state->ranges[r].next = nb_chunks * r / state->nb_ranges;
+        state->ranges[r].end = nb_chunks * (r + 1) / state->nb_ranges;
+    }
+
+    //the task of range r is pushed on the queue of worker r, that does its chunks unless another worker steals it
+    for(unsigned r = 0; r < state->nb_ranges; r++)
+    {
+        push(r, [this, state, &f, r]()
+        {
+            {
+                //once the pool is stopped, the caller returns as soon as no range task is active : f may be gone
+                GuardLock lock(idle_mutex);
+                if(_stopped.load())
+                {
+                    state->running--;
+                    idle_condition.notify_all();
+                    return;
+                }
+                state->active++;
+            }
+
+            size_t chunk;
+            while(! state->failed.load() && ! _stopped.load() && take_chunk(*state, r, chunk))
+            {
+                try
+                {
+                    f(state->begin + chunk * state->grain, std::min(state->begin + (chunk + 1) * state->grain, state->end));
+                }
+                catch(...)
+                {
+                    GuardLock lock(idle_mutex);
+                    if(! state->error)
+                        state->error = std::current_exception();
+                    state->failed = true;
+                }
+            }
+
+            //notified under the lock : the caller cannot return before this task is done with f
+            GuardLock lock(idle_mutex);
+            state->active--;
+            state->running--;
+            idle_condition.notify_all();
+        });
+    }
 
-    condition.notify_one(); //wake up a worker
+    if(current_pool == this) //a worker waiting here would be one less worker, it runs tasks instead
+    {
+        Task task;
+        while(! _stopped.load())
+        {
+            {
+                GuardLock lock(idle_mutex);
+                if(state->running == 0)
+                    break;
+            }
+            if(pop(current_index, task))
+                run(task);
+            else
+                std::this_thread::yield();
+        }
+    }
 
-    return task_ptr->get_future();
+    //stop notifies idle_condition under idle_mutex, after setting _stopped
+    GuardLock lock(idle_mutex);
+    idle_condition.wait(lock, [this, &state] { return state->running == 0 || (_stopped.load() && state->active == 0); });
+    if(state->error)
+        std::rethrow_exception(state->error);
 }
 
 #endif // THREADPOOL_HPP
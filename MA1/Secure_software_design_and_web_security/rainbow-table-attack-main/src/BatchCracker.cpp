@@ -0,0 +1,179 @@
+#include "BatchCracker.hpp"
+
+#include <cstring>
+
+#include "Instantiate.hpp"
+#include "Trace.hpp"
+
+
+template<unsigned PASSWDLENGTH, class Hash, class Charset>
+unsigned BatchCracker<PASSWDLENGTH, Hash, Charset>::crackBatch(Target* const* batch, unsigned count, bool* cracked,
+                                                const std::atomic<bool>& keepRunning) {
+    // active[k] is the target walked in slot k, slots[k] its index in batch
+    Target* active[BATCHSIZE];
+    unsigned slots[BATCHSIZE];
+    unsigned nbActive = count;
+    for (unsigned k = 0; k < count; k++) {
+        active[k] = batch[k];
+        slots[k] = k;
+        cracked[k] = false;
+    }
+
+    bool found[BATCHSIZE];
+    for (int column = chainLength; 0 <= column && nbActive > 0 && keepRunning.load(); column--) {
+        if (crackColumn(active, nbActive, column, found) == 0) {
+            continue;
+        }
+
+        // Cracked targets leave the batch
+        unsigned kept = 0;
+        for (unsigned k = 0; k < nbActive; k++) {
+            if (found[k]) {
+                cracked[slots[k]] = true;
+            } else {
+                active[kept] = active[k];
+                slots[kept++] = slots[k];
+            }
+        }
+        nbActive = kept;
+    }
+    return count - nbActive;
+}
+
+template<unsigned PASSWDLENGTH, class Hash, class Charset>
+unsigned BatchCracker<PASSWDLENGTH, Hash, Charset>::crackColumn(Target* const* batch, unsigned count, int column, bool* cracked) {
+    walkColumn(batch, count, column);
+    probe(count);
+    counters.lookups += count;
+    counters.hashes += count * static_cast<uint64_t>(chainLength - column);
+
+    // Gather the candidate chains of this column
+    Target* candidates[BATCHSIZE];
+    uint64_t heads[BATCHSIZE];
+    unsigned slots[BATCHSIZE];
+    unsigned nbCandidates = 0;
+    for (unsigned k = 0; k < count; k++) {
+        cracked[k] = false;
+        if (matches[k] != nullptr) {
+            candidates[nbCandidates] = batch[k];
+            heads[nbCandidates] = matches[k]->first;
+            slots[nbCandidates++] = k;
+        }
+    }
+    if (nbCandidates == 0) {
+        return 0;
+    }
+
+    bool verified[BATCHSIZE];
+    unsigned nbCracked = verify(candidates, heads, nbCandidates, column, verified);
+    counters.alarms += nbCandidates;
+    counters.falseAlarms += nbCandidates - nbCracked;
+    counters.hashes += nbCandidates * static_cast<uint64_t>(column + 1);
+    for (unsigned j = 0; j < nbCandidates; j++) {
+        cracked[slots[j]] = verified[j];
+    }
+    return nbCracked;
+}
+
+template<unsigned PASSWDLENGTH, class Hash, class Charset>
+const uint64_t* BatchCracker<PASSWDLENGTH, Hash, Charset>::walkColumn(Target* const* batch, unsigned count, int column) {
+    for (unsigned k = 0; k < count; k++) {
+        digestToHex(batch[k]->digest, hashes[k], Hash::DIGESTSIZE);
+    }
+    for (int i = column; i < chainLength; i++) {
+        for (unsigned k = 0; k < count; k++) {
+            reduceHex<PASSWDLENGTH, Charset>(hashes[k], i, passwords[k]);
+        }
+        hashPasswords(count);
+    }
+    for (unsigned k = 0; k < count; k++) {
+        reduceHex<PASSWDLENGTH, Charset>(hashes[k], chainLength, passwords[k]);
+    }
+    Charset::encodeBatch(&passwords[0][0], PASSWDLENGTH, PASSWDLENGTH, count, endpoints);
+    return endpoints;
+}
+
+template<unsigned PASSWDLENGTH, class Hash, class Charset>
+unsigned BatchCracker<PASSWDLENGTH, Hash, Charset>::verify(Target* const* batch, const uint64_t* heads, unsigned count, int column, bool* cracked) {
+    TRACE_ZONE("verify");
+    Charset::decodeBatch(heads, count, PASSWDLENGTH, &passwords[0][0], PASSWDLENGTH);
+    for (int i = 0; i < column; i++) {
+        hashPasswords(count);
+        for (unsigned j = 0; j < count; j++) {
+            reduceHex<PASSWDLENGTH, Charset>(hashes[j], i, passwords[j]);
+        }
+    }
+    Hash::hashBatch(&passwords[0][0], PASSWDLENGTH, PASSWDLENGTH, count, digests);
+
+    unsigned nbCracked = 0;
+    for (unsigned j = 0; j < count; j++) {
+        cracked[j] = std::memcmp(digests + j * Hash::DIGESTSIZE, batch[j]->digest, Hash::DIGESTSIZE) == 0;
+        if (cracked[j]) {
+            std::memcpy(batch[j]->password, passwords[j], PASSWDLENGTH);
+            nbCracked++;
+        }
+    }
+    return nbCracked;
+}
+
+template<unsigned PASSWDLENGTH, class Hash, class Charset>
+void BatchCracker<PASSWDLENGTH, Hash, Charset>::generateChains(const uint64_t* heads, unsigned count, uint64_t* tails) {
+    Charset::decodeBatch(heads, count, PASSWDLENGTH, &passwords[0][0], PASSWDLENGTH);
+    for (int i = 0; i < chainLength; i++) {
+        hashPasswords(count);
+        for (unsigned k = 0; k < count; k++) {
+            reduceHex<PASSWDLENGTH, Charset>(hashes[k], i, passwords[k]);
+        }
+    }
+    hashPasswords(count);
+    for (unsigned k = 0; k < count; k++) {
+        reduceHex<PASSWDLENGTH, Charset>(hashes[k], chainLength, passwords[k]);
+    }
+    Charset::encodeBatch(&passwords[0][0], PASSWDLENGTH, PASSWDLENGTH, count, tails);
+}
+
+template<unsigned PASSWDLENGTH, class Hash, class Charset>
+void BatchCracker<PASSWDLENGTH, Hash, Charset>::hashPasswords(unsigned count) {
+    Hash::hashBatch(&passwords[0][0], PASSWDLENGTH, PASSWDLENGTH, count, digests);
+    for (unsigned k = 0; k < count; k++) {
+        digestToHex(digests + k * Hash::DIGESTSIZE, hashes[k], Hash::DIGESTSIZE);
+    }
+}
+
+template<unsigned PASSWDLENGTH, class Hash, class Charset>
+void BatchCracker<PASSWDLENGTH, Hash, Charset>::probe(unsigned count) {
+    // Branchless lower bounds on the tails, one step of every search at a time:
+    // the loads of the different searches are independent and overlap in memory.
+    const Entry* base[BATCHSIZE];
+    for (unsigned k = 0; k < count; k++) {
+        base[k] = entries;
+    }
+
+    size_t length = nbEntries;
+    if (length == 0) {
+        for (unsigned k = 0; k < count; k++) {
+            matches[k] = nullptr;
+        }
+        return;
+    }
+
+    while (length > 1) {
+        size_t half = length / 2;
+        size_t next = (length - half) / 2;
+        for (unsigned k = 0; k < count; k++) {
+            // both possible positions of the next step
+            __builtin_prefetch(base[k] + next);
+            __builtin_prefetch(base[k] + half + next);
+            base[k] = (base[k][half].second < endpoints[k]) ? base[k] + half : base[k];
+        }
+        length -= half;
+    }
+
+    for (unsigned k = 0; k < count; k++) {
+        const Entry* it = base[k] + (base[k]->second < endpoints[k]);
+        matches[k] = (it != entries + nbEntries && it->second == endpoints[k]) ? it : nullptr;
+    }
+}
+
+
+INSTANTIATE_ENGINE(BatchCracker)
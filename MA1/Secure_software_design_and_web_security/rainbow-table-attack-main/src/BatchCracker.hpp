@@ -0,0 +1,90 @@
+#ifndef BATCHCRACKER_HPP
+#define BATCHCRACKER_HPP
+
+#include <vector>
+#include <atomic>
+#include <cstdint>
+
+#include "Chain.hpp"
+#include "HashPolicy.hpp"
+#include "Charset.hpp"
+
+/**
+ * Lookup engine that cracks a batch of target hashes in lockstep.
+ * <p>
+ * For a given start column, the online chains of every pending target of the
+ * batch need the same number of reduction/hash steps, so they are advanced
+ * together through the multi-lane kernel of the Hash policy. Passwords are
+ * reduced onto and encoded with the Charset (see Charset.hpp). The resulting endpoints are
+ * then searched in the table with interleaved binary searches, so that the
+ * memory accesses of all probes overlap, and the matching chains of a column
+ * are regenerated together as well.
+ */
+template<unsigned PASSWDLENGTH, class Hash = Sha256Policy, class Charset = AlnumCharset>
+class BatchCracker {
+    static_assert(1 <= PASSWDLENGTH && PASSWDLENGTH <= Charset::MAXLENGTH, "unsupported password length");
+
+    public:
+        using Entry = std::pair<uint64_t, uint64_t>;
+        using Table = std::vector<Entry>;
+
+        // Number of targets advanced together
+        static const unsigned BATCHSIZE = 64;
+
+        struct Target {
+            unsigned char digest[DIGESTSIZE]; // the first Hash::DIGESTSIZE bytes are used
+            size_t idx;
+            char password[PASSWDLENGTH]; // set once cracked
+        };
+
+    private:
+        const Entry* entries; // null for engines that search the table themselves
+        size_t nbEntries;
+        int chainLength;
+
+        // per-slot working buffers, reused for every column
+        char hashes[BATCHSIZE][HEXDIGESTSIZE];
+        char passwords[BATCHSIZE][PASSWDLENGTH];
+        unsigned char digests[BATCHSIZE * Hash::DIGESTSIZE];
+        uint64_t endpoints[BATCHSIZE];
+        const Entry* matches[BATCHSIZE];
+
+        rainbow::CrackStatistics counters;
+
+        void hashPasswords(unsigned count);
+
+        void probe(unsigned count);
+
+    public:
+        BatchCracker(const Entry* entries, size_t nbEntries, int chainLength)
+            : entries{entries}, nbEntries{nbEntries}, chainLength{chainLength} {}
+
+        BatchCracker(const Table& table, int chainLength) : BatchCracker(table.data(), table.size(), chainLength) {}
+
+        explicit BatchCracker(int chainLength) : BatchCracker(nullptr, 0, chainLength) {}
+
+        // Cracks the count (<= BATCHSIZE) given targets, from the last column down to column 0, until they are
+        // all found or keepRunning is cleared. cracked[k] is set for every target found, and its password is
+        // filled in. Returns the number of targets cracked.
+        unsigned crackBatch(Target* const* batch, unsigned count, bool* cracked, const std::atomic<bool>& keepRunning);
+
+        // Walks the count (<= BATCHSIZE) given targets from column to the end of the chain and checks the
+        // matching chains. cracked[k] is set for every target found, and its password is filled in.
+        unsigned crackColumn(Target* const* batch, unsigned count, int column, bool* cracked);
+
+        // Walks the count (<= BATCHSIZE) given targets from column to the end of the chain and returns
+        // their encoded endpoints (valid until the next call)
+        const uint64_t* walkColumn(Target* const* batch, unsigned count, int column);
+
+        // Regenerates the chains of the count (<= BATCHSIZE) given heads up to column and checks them
+        // against batch[j], the target of heads[j]. cracked[j] is set and the password filled in on success.
+        unsigned verify(Target* const* batch, const uint64_t* heads, unsigned count, int column, bool* cracked);
+
+        // Generates the chains of the count (<= BATCHSIZE) given encoded heads and writes their encoded tails
+        void generateChains(const uint64_t* heads, unsigned count, uint64_t* tails);
+
+        // Work done by crackBatch and crackColumn since the construction of the cracker
+        const rainbow::CrackStatistics& statistics() const { return counters; }
+};
+
+#endif // BATCHCRACKER_HPP
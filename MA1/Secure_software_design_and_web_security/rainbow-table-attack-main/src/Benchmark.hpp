@@ -0,0 +1,156 @@
+#ifndef BENCHMARK_HPP
+#define BENCHMARK_HPP
+
+#include <string>
+#include <vector>
+#include <ostream>
+#include <iostream>
+#include <functional>
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <cstdint>
+#include <unistd.h>
+
+/**
+ * A small benchmark runner in the style of Google Benchmark.
+ * <p>
+ * A benchmark is a function that runs a given number of iterations and
+ * returns the number of items it processed (hashes, chains, lookups...).
+ * It is run with more and more iterations until one run lasts at least
+ * minTime seconds, and that run is kept. The results are written in the JSON
+ * format of Google Benchmark, so its compare.py can diff two runs.
+ * <p>
+ * Given a counter of the heap allocations of the program, the runner also
+ * reports the allocations of the kept run, and flags the benchmarks declared
+ * allocation free that made some. Those are warmed up by an unrecorded run
+ * first, so that thread locals and lazily built tables are left out of the
+ * steady state.
+ */
+
+// Keeps the compiler from optimizing away the computation of value
+template<class T>
+inline void doNotOptimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+class BenchmarkRunner {
+    public:
+        // Runs iterations iterations, returns the number of items processed
+        using Function = std::function<uint64_t(uint64_t iterations)>;
+
+    private:
+        struct Result {
+            std::string name;
+            unsigned threads;
+            uint64_t iterations;
+            double realTime; // nanoseconds per iteration
+            double cpuTime;  // nanoseconds per iteration, added up over the threads of the process
+            double itemsPerSecond;
+            double allocationsPerIteration;
+        };
+
+        double minTime;
+        std::string filter;
+        const std::atomic<uint64_t>* allocations;
+        std::vector<Result> results;
+        std::vector<std::string> allocating; // allocation free benchmarks that allocated
+
+        static void writeString(std::ostream& stream, const std::string& string) {
+            stream << '"';
+            for (char c : string) {
+                if (c == '"' || c == '\\') {
+                    stream << '\\';
+                }
+                stream << c;
+            }
+            stream << '"';
+        }
+
+    public:
+        // allocations counts the heap allocations of the program, none are reported if it is null
+        BenchmarkRunner(double minTime, const std::string& filter, const std::atomic<uint64_t>* allocations = nullptr)
+            : minTime{minTime}, filter{filter}, allocations{allocations} {}
+
+        // Whether the benchmark of this name is selected by the filter (a substring of the name)
+        bool selected(const std::string& name) const { return name.find(filter) != std::string::npos; }
+
+        // Runs function until a run lasts minTime seconds and records it as name. threads is the number of
+        // threads function runs on, for the record only. An allocationFree benchmark whose kept run allocates is
+        // listed by allocatingBenchmarks.
+        void run(const std::string& name, const Function& function, unsigned threads = 1, bool allocationFree = false) {
+            if (!selected(name)) {
+                return;
+            }
+            if (allocationFree) {
+                function(1);
+            }
+            uint64_t iterations = 1;
+            while (true) {
+                const uint64_t allocationsStart = allocations != nullptr ? allocations->load() : 0;
+                const std::clock_t cpuStart = std::clock();
+                const auto start = std::chrono::steady_clock::now();
+                const uint64_t items = function(iterations);
+                const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                const double cpuSeconds = static_cast<double>(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+                const uint64_t nbAllocations = allocations != nullptr ? allocations->load() - allocationsStart : 0;
+
+                if (seconds >= minTime || iterations >= 1000000000) {
+                    results.push_back({name, threads, iterations, 1e9 * seconds / iterations, 1e9 * cpuSeconds / iterations,
+                                       seconds > 0 ? items / seconds : 0, static_cast<double>(nbAllocations) / iterations});
+                    const Result& result = results.back();
+                    std::cerr << name << ": " << result.realTime << " ns/iteration, " << result.itemsPerSecond
+                              << " items/s (" << iterations << " iterations";
+                    if (allocations != nullptr) {
+                        std::cerr << ", " << (items > 0 ? static_cast<double>(nbAllocations) / items : 0) << " allocations/item";
+                    }
+                    std::cerr << ")" << std::endl;
+                    if (allocationFree && nbAllocations > 0) {
+                        allocating.push_back(name);
+                    }
+                    return;
+                }
+                // Aim a little past minTime, growing tenfold at most
+                const double target = seconds > 0 ? 1.4 * minTime / seconds * iterations : 10.0 * iterations;
+                iterations = std::max<uint64_t>(iterations + 1, std::min<double>(target, 10.0 * iterations));
+            }
+        }
+
+        // The benchmarks run with allocationFree set that allocated in their steady state
+        const std::vector<std::string>& allocatingBenchmarks() const { return allocating; }
+
+        void writeJson(std::ostream& stream) const {
+            char hostName[256] = "";
+            gethostname(hostName, sizeof(hostName) - 1);
+            char date[64];
+            const std::time_t now = std::time(nullptr);
+            std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z", std::localtime(&now));
+
+            stream << "{\n  \"context\": {\n    \"date\": ";
+            writeString(stream, date);
+            stream << ",\n    \"host_name\": ";
+            writeString(stream, hostName);
+            stream << ",\n    \"num_cpus\": " << sysconf(_SC_NPROCESSORS_ONLN)
+                   << ",\n    \"library_build_type\": \"release\"\n  },\n  \"benchmarks\": [";
+            for (size_t i = 0; i < results.size(); i++) {
+                const Result& result = results[i];
+                stream << (i == 0 ? "\n" : ",\n") << "    {\n      \"name\": ";
+                writeString(stream, result.name);
+                stream << ",\n      \"run_name\": ";
+                writeString(stream, result.name);
+                stream << ",\n      \"run_type\": \"iteration\",\n      \"repetitions\": 1,\n      \"threads\": " << result.threads
+                       << ",\n      \"iterations\": " << result.iterations
+                       << ",\n      \"real_time\": " << result.realTime
+                       << ",\n      \"cpu_time\": " << result.cpuTime
+                       << ",\n      \"time_unit\": \"ns\",\n      \"items_per_second\": " << result.itemsPerSecond;
+                if (allocations != nullptr) {
+                    stream << ",\n      \"allocs_per_iter\": " << result.allocationsPerIteration;
+                }
+                stream << "\n    }";
+            }
+            stream << "\n  ]\n}\n";
+        }
+};
+
+#endif // BENCHMARK_HPP
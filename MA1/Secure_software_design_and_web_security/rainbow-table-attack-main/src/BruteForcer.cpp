@@ -0,0 +1,134 @@
+#include "BruteForcer.hpp"
+
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+#include "Timer.hpp"
+#include "Instantiate.hpp"
+#include "Trace.hpp"
+
+// Key of a digest in the set, never 0 which marks the empty slots
+static inline uint64_t digestKey(const unsigned char* digest) {
+    uint64_t key;
+    std::memcpy(&key, digest, sizeof(key));
+    return key | (key == 0);
+}
+
+BruteForcer::BruteForcer(const std::vector<rainbow::Digest>& targets, unsigned passwordLength, rainbow::HashAlgorithm hash,
+                         rainbow::CharsetKind charset)
+    : targets{targets}, digestSize{rainbow::hashDigestSize(hash)}, remaining{targets.size()} {
+    if (passwordLength < rainbow::MINPASSWORDLENGTH || passwordLength > rainbow::charsetMaxLength(charset)) {
+        throw std::invalid_argument("Unsupported password length: " + std::to_string(passwordLength)
+                                    + " (" + rainbow::charsetName(charset) + ")");
+    }
+    dispatchEngine(hash, charset, passwordLength, [this](auto length, auto policy, auto charsetPolicy) {
+        searchRange = &BruteForcer::searchWith<decltype(length)::value, decltype(policy), decltype(charsetPolicy)>;
+    });
+
+    size_t capacity = 16;
+    while (capacity < 2 * targets.size()) {
+        capacity *= 2;
+    }
+    prefixes.assign(capacity, 0);
+    owners.assign(capacity, 0);
+    mask = capacity - 1;
+
+    for (size_t t = 0; t < targets.size(); t++) {
+        uint64_t key = digestKey(targets[t].bytes);
+        size_t slot = key & mask;
+        while (prefixes[slot] != 0) {
+            slot = (slot + 1) & mask;
+        }
+        prefixes[slot] = key;
+        owners[slot] = t;
+    }
+}
+
+int64_t BruteForcer::find(const unsigned char* digest) const {
+    uint64_t key = digestKey(digest);
+    for (size_t slot = key & mask; prefixes[slot] != 0; slot = (slot + 1) & mask) {
+        if (prefixes[slot] == key && std::memcmp(targets[owners[slot]].bytes, digest, digestSize) == 0) {
+            return owners[slot];
+        }
+    }
+    return -1;
+}
+
+uint64_t BruteForcer::keyspaceSize(unsigned passwordLength, rainbow::CharsetKind charset) {
+    uint64_t size = 1;
+    for (unsigned i = 0; i < passwordLength; i++) {
+        size *= rainbow::charsetSize(charset);
+    }
+    return size;
+}
+
+template<unsigned PASSWDLENGTH, class Hash, class Charset>
+size_t BruteForcer::searchWith(uint64_t first, uint64_t last, std::vector<rainbow::Result>& results,
+                               const std::atomic<bool>& keepRunning) {
+    TRACE_ZONE("brute force range");
+    char candidates[BATCHSIZE][PASSWDLENGTH];
+    unsigned char digests[BATCHSIZE * Hash::DIGESTSIZE];
+
+    // odometer[i] is the position in the charset of current[i], the last one turns fastest
+    unsigned char odometer[PASSWDLENGTH];
+    char current[PASSWDLENGTH];
+    uint64_t index = first;
+    for (int i = PASSWDLENGTH - 1; 0 <= i; i--) {
+        odometer[i] = index % Charset::SIZE;
+        current[i] = Charset::symbol(odometer[i]);
+        index /= Charset::SIZE;
+    }
+
+    size_t nbFound = 0;
+    for (index = first; index < last && keepRunning.load() && !done();) {
+        unsigned count = std::min<uint64_t>(BATCHSIZE, last - index);
+        for (unsigned k = 0; k < count; k++) {
+            std::memcpy(candidates[k], current, PASSWDLENGTH);
+            int i = PASSWDLENGTH - 1;
+            while (0 < i && ++odometer[i] == Charset::SIZE) {
+                odometer[i] = 0;
+                current[i--] = Charset::symbol(0);
+            }
+            if (i == 0) {
+                odometer[0] = (odometer[0] + 1) % Charset::SIZE;
+            }
+            current[i] = Charset::symbol(odometer[i]);
+        }
+
+        Hash::hashBatch(&candidates[0][0], PASSWDLENGTH, PASSWDLENGTH, count, digests);
+        for (unsigned k = 0; k < count; k++) {
+            int64_t t = find(digests + k * Hash::DIGESTSIZE);
+            if (t >= 0) {
+                results[t].length = PASSWDLENGTH;
+                std::memcpy(results[t].password, candidates[k], PASSWDLENGTH);
+                remaining--;
+                nbFound++;
+            }
+        }
+        index += count;
+    }
+    return nbFound;
+}
+
+double BruteForcer::measureRate(unsigned passwordLength, rainbow::HashAlgorithm hash, rainbow::CharsetKind charset,
+                                double seconds) {
+    // a target that is never found, so that the search is never cut short
+    std::vector<rainbow::Digest> dummy(1);
+    std::memset(dummy[0].bytes, 0, DIGESTSIZE);
+    std::vector<rainbow::Result> results(1);
+    std::atomic<bool> keepRunning(true);
+    BruteForcer forcer(dummy, passwordLength, hash, charset);
+
+    const uint64_t step = 1 << 14;
+    uint64_t nbCandidates = 0;
+    Timer timer;
+    timer.start();
+    do {
+        forcer.search(nbCandidates, nbCandidates + step, results, keepRunning);
+        nbCandidates += step;
+    } while (timer.elapsedTime() < seconds);
+    return nbCandidates / timer.elapsedTime();
+}
+
@@ -0,0 +1,70 @@
+#ifndef BRUTEFORCER_HPP
+#define BRUTEFORCER_HPP
+
+#include <vector>
+#include <atomic>
+#include <cstdint>
+
+#include "Rainbow.hpp"
+
+/**
+ * Exhaustive search of the keyspace of a charset, for short passwords.
+ * <p>
+ * Candidates are numbered from 0 to SIZE^passwordLength - 1 and a range of them is
+ * enumerated with an odometer (only the last characters change from one
+ * candidate to the next), BATCHSIZE at a time through the multi-lane kernel
+ * of the hash. Every digest is looked up in an open-addressing set of the targets,
+ * keyed on their first 8 bytes. Unlike table lookups, there are no false
+ * alarms and every target is found once the whole keyspace is searched.
+ * <p>
+ * The hash, the charset and the password length are given at run time: only the
+ * search of a range is instantiated for each of them, and picked on construction.
+ */
+class BruteForcer {
+    public:
+        // Number of candidates hashed at once
+        static const unsigned BATCHSIZE = 64;
+
+    private:
+        const std::vector<rainbow::Digest>& targets;
+        unsigned digestSize;
+        std::vector<uint64_t> prefixes; // first 8 bytes of the digests, 0 for an empty slot
+        std::vector<uint32_t> owners;   // index of the target of each slot
+        size_t mask;
+        std::atomic<size_t> remaining;
+
+        using SearchFunction = size_t (BruteForcer::*)(uint64_t first, uint64_t last, std::vector<rainbow::Result>& results,
+                                                       const std::atomic<bool>& keepRunning);
+        SearchFunction searchRange; // searchWith instantiated for the hash, charset and length
+
+        // Returns the index of the target with this digest, or -1
+        int64_t find(const unsigned char* digest) const;
+
+        template<unsigned PASSWDLENGTH, class Hash, class Charset>
+        size_t searchWith(uint64_t first, uint64_t last, std::vector<rainbow::Result>& results,
+                          const std::atomic<bool>& keepRunning);
+
+    public:
+        // Throws std::invalid_argument if passwordLength is not supported by the charset
+        BruteForcer(const std::vector<rainbow::Digest>& targets, unsigned passwordLength,
+                    rainbow::HashAlgorithm hash = rainbow::SHA256, rainbow::CharsetKind charset = rainbow::ALNUM);
+
+        // Number of candidates of passwordLength chars of the charset, charsetSize(charset)^passwordLength
+        static uint64_t keyspaceSize(unsigned passwordLength, rainbow::CharsetKind charset);
+
+        // Searches the candidates [first, last) and fills in the result of every target found.
+        // Returns the number of targets found.
+        size_t search(uint64_t first, uint64_t last, std::vector<rainbow::Result>& results,
+                      const std::atomic<bool>& keepRunning) {
+            return (this->*searchRange)(first, last, results, keepRunning);
+        }
+
+        // True once every target was found: the rest of the keyspace can be skipped
+        bool done() const { return remaining.load() == 0; }
+
+        // Candidates hashed and checked per second by one thread, measured for about seconds
+        static double measureRate(unsigned passwordLength, rainbow::HashAlgorithm hash, rainbow::CharsetKind charset,
+                                  double seconds);
+};
+
+#endif // BRUTEFORCER_HPP
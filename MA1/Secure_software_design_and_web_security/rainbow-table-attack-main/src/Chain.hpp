@@ -0,0 +1,55 @@
+#ifndef CHAIN_HPP
+#define CHAIN_HPP
+
+#include <cstdint>
+#include <cstddef>
+
+// Raw-buffer counterparts of the chain primitives of RainbowTable, for the
+// cracking engines that work on arrays of digests instead of strings.
+
+static const unsigned DIGESTSIZE = 32;
+static const unsigned HEXDIGESTSIZE = 2 * DIGESTSIZE;
+
+// Same reduction as RainbowTable::reduction, applied to a hex digest, onto the symbols of Charset (see Charset.hpp)
+template<unsigned PASSWDLENGTH, class Charset>
+inline void reduceHex(const char* hash, const int position, char* reduced) {
+    for (unsigned i = 0; i < PASSWDLENGTH; i++) {
+        int index = (((hash[i] ^ position) + hash[i + 3] + hash[i + 5] + hash[i + 7] + hash[i + 9] + hash[i + 17] + position) % Charset::SIZE);
+        reduced[i] = Charset::symbol(index);
+    }
+}
+
+// Writes the 2 * size hex characters of digest
+inline void digestToHex(const unsigned char* digest, char* hex, unsigned size = DIGESTSIZE) {
+    static const char dec2hex[16+1] = "0123456789abcdef";
+    for (unsigned i = 0; i < size; i++) {
+        hex[2*i]     = dec2hex[(digest[i] >> 4) & 15];
+        hex[2*i + 1] = dec2hex[ digest[i]       & 15];
+    }
+}
+
+// Decodes a digest of size bytes into the first bytes of digest (DIGESTSIZE bytes, the others are set to 0).
+// Returns false if hex is not exactly 2 * size hexadecimal characters.
+// Branchless, so that the compiler vectorizes both loops.
+inline bool hexToDigest(const char* hex, size_t length, unsigned char* digest, unsigned size = DIGESTSIZE) {
+    if (length != 2 * size || size > DIGESTSIZE) {
+        return false;
+    }
+    unsigned char values[HEXDIGESTSIZE] = {0};
+    unsigned char invalid = 0;
+    for (unsigned i = 0; i < 2 * size; i++) {
+        unsigned char c = hex[i];
+        unsigned char digit = c - '0';
+        unsigned char letter = (c | 0x20) - 'a'; // either case
+        unsigned char isDigit = digit < 10;
+        unsigned char isLetter = letter < 6;
+        values[i] = isDigit ? digit : letter + 10;
+        invalid |= !(isDigit | isLetter);
+    }
+    for (unsigned i = 0; i < DIGESTSIZE; i++) {
+        digest[i] = (values[2*i] << 4) | values[2*i + 1];
+    }
+    return invalid == 0;
+}
+
+#endif // CHAIN_HPP
@@ -0,0 +1,137 @@
+#ifndef CHARSET_HPP
+#define CHARSET_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <stdexcept>
+#include <type_traits>
+
+#include "Rainbow.hpp"
+#include "../utils/6bits-encoder.hpp"
+
+/**
+ * Password charsets, as compile-time parameters of the engines.
+ * <p>
+ * SYMBOLS is the alphabet of the reduction, in order: a reduced character is
+ * SYMBOLS[x % SIZE]. In table files, a password is packed BITS bits per
+ * character, the first character in the lowest bits, a character being stored
+ * as its position in CODES (SYMBOLS by default). BITS is the fewest bits that
+ * hold SIZE codes, so MAXLENGTH characters fit in 64 bits. The alnum preset
+ * keeps the historical 6-bit code order, so its tables are unchanged.
+ */
+
+inline constexpr char lowercaseSymbols[] = "abcdefghijklmnopqrstuvwxyz";
+inline constexpr char digitsSymbols[] = "0123456789";
+inline constexpr char alnumSymbols[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+inline constexpr char alnumCodes[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+inline constexpr char printableSymbols[] = " !\"#$%&'()*+,-./0123456789:;<=>?@ABCDEFGHIJKLMNOPQRSTUVWXYZ[\\]^_`abcdefghijklmnopqrstuvwxyz{|}~";
+
+// Longest password of any charset: the reduction of the last char reads the hex digest up to
+// CHARSETMAXLENGTH + 16, within the 32 hex chars of the shortest digests
+static constexpr unsigned CHARSETMAXLENGTH = 12;
+
+template<rainbow::CharsetKind CHARSETKIND, const char* SYMBOLS, const char* CODES = SYMBOLS>
+struct Charset {
+    private:
+        static constexpr unsigned countChars(const char* string) {
+            unsigned n = 0;
+            while (string[n] != '\0') {
+                n++;
+            }
+            return n;
+        }
+
+        static constexpr unsigned bitWidth(unsigned value) {
+            unsigned bits = 0;
+            while ((1u << bits) < value) {
+                bits++;
+            }
+            return bits;
+        }
+
+        // Code of every char, SIZE for those that are not in the charset
+        static constexpr std::array<uint8_t, 256> codeTable() {
+            std::array<uint8_t, 256> table{};
+            for (unsigned c = 0; c < 256; c++) {
+                table[c] = countChars(CODES);
+            }
+            for (unsigned i = 0; CODES[i] != '\0'; i++) {
+                table[static_cast<unsigned char>(CODES[i])] = i;
+            }
+            return table;
+        }
+
+        static constexpr std::array<uint8_t, 256> CODEOF = codeTable();
+
+    public:
+        static constexpr rainbow::CharsetKind KIND = CHARSETKIND;
+        static constexpr unsigned SIZE = countChars(SYMBOLS);
+        static constexpr unsigned BITS = bitWidth(SIZE);
+        static constexpr unsigned MAXLENGTH = 64 / BITS < CHARSETMAXLENGTH ? 64 / BITS : CHARSETMAXLENGTH;
+        static constexpr uint64_t MASK = (uint64_t(1) << BITS) - 1;
+
+        static_assert(countChars(CODES) == SIZE, "CODES must hold the same chars as SYMBOLS");
+
+        static constexpr char symbol(unsigned index) { return SYMBOLS[index]; }
+
+        static constexpr bool contains(char c) { return CODEOF[static_cast<unsigned char>(c)] < SIZE; }
+
+        // Packs the length chars of password, which must all be in the charset
+        static constexpr uint64_t encode(const char* password, unsigned length) {
+            uint64_t encoded = 0;
+            for (unsigned i = 0; i < length; i++) {
+                encoded |= uint64_t(CODEOF[static_cast<unsigned char>(password[i])]) << (BITS * i);
+            }
+            return encoded;
+        }
+
+        static constexpr void decode(uint64_t encoded, unsigned length, char* password) {
+            for (unsigned i = 0; i < length; i++) {
+                password[i] = CODES[(encoded >> (BITS * i)) & MASK];
+            }
+        }
+
+        // Packs count passwords of length chars, the k-th one at passwords + k * stride. The alnum codes are the ones
+        // of the 6-bit encoder, whose batch variant maps and packs 8 chars at once.
+        static void encodeBatch(const char* passwords, size_t stride, unsigned length, unsigned count, uint64_t* encoded) {
+            if constexpr (KIND == rainbow::ALNUM) {
+                encodeStringsToUint64(passwords, stride, length, count, encoded);
+            } else {
+                for (unsigned k = 0; k < count; k++) {
+                    encoded[k] = encode(passwords + k * stride, length);
+                }
+            }
+        }
+
+        static void decodeBatch(const uint64_t* encoded, unsigned count, unsigned length, char* passwords, size_t stride) {
+            if constexpr (KIND == rainbow::ALNUM) {
+                decodeUint64ToStrings(encoded, count, length, passwords, stride);
+            } else {
+                for (unsigned k = 0; k < count; k++) {
+                    decode(encoded[k], length, passwords + k * stride);
+                }
+            }
+        }
+};
+
+using LowercaseCharset = Charset<rainbow::LOWERCASE, lowercaseSymbols>;
+using DigitsCharset = Charset<rainbow::DIGITS, digitsSymbols>;
+using AlnumCharset = Charset<rainbow::ALNUM, alnumSymbols, alnumCodes>;
+using PrintableCharset = Charset<rainbow::PRINTABLE, printableSymbols>;
+
+// Calls function(std::integral_constant<unsigned, length>()), so that a length known at run time selects a
+// template instantiation. Throws std::invalid_argument if length is not in [1, MAXLENGTH].
+template<unsigned MAXLENGTH, unsigned LENGTH = 1, class Function>
+auto dispatchLength(unsigned length, Function&& function) {
+    if (length == LENGTH) {
+        return function(std::integral_constant<unsigned, LENGTH>());
+    }
+    if constexpr (LENGTH < MAXLENGTH) {
+        return dispatchLength<MAXLENGTH, LENGTH + 1>(length, function);
+    } else {
+        throw std::invalid_argument("Unsupported password length: " + std::to_string(length));
+    }
+}
+
+#endif // CHARSET_HPP
@@ -0,0 +1,120 @@
+#include "CoverageSampler.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <vector>
+#include <thread>
+#include <random>
+#include <stdexcept>
+
+#include "HashPolicy.hpp"
+#include "Charset.hpp"
+#include "Timer.hpp"
+#include "Trace.hpp"
+
+// Draws the passwords of block and writes their digests
+template<class Hash, class Charset>
+static void drawBlock(unsigned passwordLength, uint64_t seed, uint64_t block, rainbow::Digest* digests) {
+    TRACE_ZONE("draw samples");
+    std::seed_seq sequence{static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32),
+                           static_cast<uint32_t>(block), static_cast<uint32_t>(block >> 32)};
+    std::mt19937_64 generator(sequence);
+
+    char passwords[SAMPLEBLOCK][rainbow::MAXPASSWORDLENGTH];
+    for (uint64_t k = 0; k < SAMPLEBLOCK; k++) {
+        for (unsigned i = 0; i < passwordLength; i++) {
+            passwords[k][i] = Charset::symbol(generator() % Charset::SIZE);
+        }
+    }
+    unsigned char hashed[SAMPLEBLOCK * Hash::DIGESTSIZE];
+    Hash::hashBatch(&passwords[0][0], rainbow::MAXPASSWORDLENGTH, passwordLength, SAMPLEBLOCK, hashed);
+    for (uint64_t k = 0; k < SAMPLEBLOCK; k++) {
+        digests[k] = rainbow::Digest{};
+        std::memcpy(digests[k].bytes, hashed + k * Hash::DIGESTSIZE, Hash::DIGESTSIZE);
+    }
+}
+
+template<class Hash>
+static void drawBlock(const rainbow::TableView& table, uint64_t seed, uint64_t block, rainbow::Digest* digests) {
+    switch (table.charset) {
+        case rainbow::LOWERCASE: return drawBlock<Hash, LowercaseCharset>(table.passwordLength, seed, block, digests);
+        case rainbow::DIGITS: return drawBlock<Hash, DigitsCharset>(table.passwordLength, seed, block, digests);
+        case rainbow::ALNUM: return drawBlock<Hash, AlnumCharset>(table.passwordLength, seed, block, digests);
+        case rainbow::PRINTABLE: return drawBlock<Hash, PrintableCharset>(table.passwordLength, seed, block, digests);
+    }
+    throw std::invalid_argument("Unknown charset");
+}
+
+static void drawBlock(const rainbow::TableView& table, uint64_t seed, uint64_t block, rainbow::Digest* digests) {
+    switch (table.hash) {
+        case rainbow::SHA256: return drawBlock<Sha256Policy>(table, seed, block, digests);
+        case rainbow::SHA1: return drawBlock<Sha1Policy>(table, seed, block, digests);
+        case rainbow::MD5: return drawBlock<Md5Policy>(table, seed, block, digests);
+        case rainbow::NTLM: return drawBlock<NtlmPolicy>(table, seed, block, digests);
+    }
+    throw std::invalid_argument("Unknown hash algorithm");
+}
+
+CoverageSample sampleCoverage(const rainbow::TableView& table, uint64_t seed, uint64_t nbSamples, unsigned nbThreads,
+                              double seconds, const std::atomic<bool>& keepRunning) {
+    if (table.passwordLength < rainbow::MINPASSWORDLENGTH || table.passwordLength > rainbow::charsetMaxLength(table.charset)) {
+        throw std::invalid_argument("Unsupported password length: " + std::to_string(table.passwordLength));
+    }
+
+    const uint64_t nbBlocks = (nbSamples + SAMPLEBLOCK - 1) / SAMPLEBLOCK;
+    std::atomic<uint64_t> nextBlock(0);
+    std::vector<CoverageSample> samples(nbThreads);
+    Timer timer;
+    timer.start();
+
+    // A block is only counted once it is cracked through: the last ones may overrun the time budget
+    std::vector<std::thread> threads;
+    for (unsigned i = 0; i < nbThreads; i++) {
+        threads.emplace_back([&, i]() {
+            rainbow::Digest digests[SAMPLEBLOCK];
+            rainbow::Result results[SAMPLEBLOCK];
+            CoverageSample& sample = samples[i];
+            uint64_t block;
+            while (keepRunning.load() && timer.elapsedTime() < seconds && (block = nextBlock++) < nbBlocks) {
+                Timer busy;
+                busy.start();
+                drawBlock(table, seed, block, digests);
+                rainbow::CrackStatistics statistics;
+                const size_t nbCracked = rainbow::crack(table, rainbow::Span<const rainbow::Digest>(digests, SAMPLEBLOCK),
+                                                        rainbow::Span<rainbow::Result>(results, SAMPLEBLOCK),
+                                                        keepRunning, &statistics);
+                if (!keepRunning.load()) {
+                    break;
+                }
+                sample.nbSamples += SAMPLEBLOCK;
+                sample.nbCracked += nbCracked;
+                sample.busyTime += busy.elapsedTime();
+                sample.statistics += statistics;
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    CoverageSample total;
+    for (const CoverageSample& sample : samples) {
+        total.nbSamples += sample.nbSamples;
+        total.nbCracked += sample.nbCracked;
+        total.busyTime += sample.busyTime;
+        total.statistics += sample.statistics;
+    }
+    return total;
+}
+
+std::pair<double, double> wilsonInterval(uint64_t successes, uint64_t trials, double z) {
+    if (trials == 0) {
+        return {0.0, 1.0};
+    }
+    const double n = trials;
+    const double p = successes / n;
+    const double center = (p + z * z / (2 * n)) / (1 + z * z / n);
+    const double margin = z / (1 + z * z / n) * std::sqrt(p * (1 - p) / n + z * z / (4 * n * n));
+    return {std::max(0.0, center - margin), std::min(1.0, center + margin)};
+}
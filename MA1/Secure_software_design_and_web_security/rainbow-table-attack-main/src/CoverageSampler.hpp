@@ -0,0 +1,37 @@
+#ifndef COVERAGESAMPLER_HPP
+#define COVERAGESAMPLER_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <utility>
+
+#include "Rainbow.hpp"
+
+/**
+ * Measures the coverage of a table by cracking random passwords.
+ * <p>
+ * The passwords are drawn by blocks of SAMPLEBLOCK, block b from a generator
+ * seeded with (seed, b). The samples of a seed are the same whatever the
+ * number of threads, and a run stopped early by its time budget holds the
+ * first blocks of a longer run.
+ */
+
+// Passwords drawn and cracked at once by a thread
+static const uint64_t SAMPLEBLOCK = 64;
+
+struct CoverageSample {
+    uint64_t nbSamples = 0;
+    uint64_t nbCracked = 0;
+    double busyTime = 0;                 // seconds spent cracking, added up over the threads
+    rainbow::CrackStatistics statistics; // work done to crack the samples
+};
+
+// Cracks against table up to nbSamples random passwords of its length and charset (rounded up to whole blocks),
+// with nbThreads threads, until seconds have elapsed or keepRunning is cleared
+CoverageSample sampleCoverage(const rainbow::TableView& table, uint64_t seed, uint64_t nbSamples, unsigned nbThreads,
+                              double seconds, const std::atomic<bool>& keepRunning);
+
+// Wilson score interval of the proportion of successes out of trials, z standard deviations wide
+std::pair<double, double> wilsonInterval(uint64_t successes, uint64_t trials, double z);
+
+#endif // COVERAGESAMPLER_HPP
@@ -0,0 +1,120 @@
+#ifndef DAEMONPROTOCOL_HPP
+#define DAEMONPROTOCOL_HPP
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/socket.h>
+
+/**
+ * Framed protocol spoken by crack_daemon.out over its Unix-domain socket.
+ * <p>
+ * Every frame is a uint32_t payload size, a uint8_t frame type and the payload.
+ * Integers are in host byte order, both ends being on the same machine.
+ * <ul>
+ *  <li>SUBMIT (client): uint32_t request id, uint32_t count, count 32-byte SHA-256 digests,</li>
+ *  <li>CANCEL (client): uint32_t request id,</li>
+ *  <li>RESULT (daemon): uint32_t request id, uint32_t index of the digest in its request, the password,
+ *  sent as soon as the table that cracked it has been searched. The digests are searched by tasks of
+ *  64, walked in lockstep: the RESULT frames of a task and a table are sent together,</li>
+ *  <li>DONE (daemon): uint32_t request id, uint32_t number of hashes cracked, uint8_t 1 if the request
+ *  was cancelled, sent once every hash of the request has been processed,</li>
+ *  <li>ERROR (daemon): an error message, for malformed frames and for a SUBMIT whose request id is
+ *  still in progress on the connection (the id can be reused once its DONE frame is received). A frame
+ *  larger than MAXFRAMESIZE is answered with an ERROR frame, and the connection is closed.</li>
+ * </ul>
+ * Clients split larger hash lists in several SUBMIT frames of at most MAXSUBMITDIGESTS digests.
+ */
+namespace protocol {
+
+enum FrameType : uint8_t {
+    SUBMIT = 1,
+    CANCEL = 2,
+    RESULT = 3,
+    DONE = 4,
+    ERROR = 5
+};
+
+// Larger frames are rejected (about 2 million digests per request)
+static const uint32_t MAXFRAMESIZE = 64 << 20;
+
+// Digests a client puts in a SUBMIT frame, well within MAXFRAMESIZE
+static const uint32_t MAXSUBMITDIGESTS = 1 << 20;
+
+inline bool readAll(int fd, void* data, size_t size) {
+    char* current = static_cast<char*>(data);
+    while (size > 0) {
+        ssize_t nbRead = read(fd, current, size);
+        if (nbRead < 0 && errno == EINTR) {
+            continue;
+        }
+        if (nbRead <= 0) {
+            return false;
+        }
+        current += nbRead;
+        size -= nbRead;
+    }
+    return true;
+}
+
+inline bool writeAll(int fd, const void* data, size_t size) {
+    const char* current = static_cast<const char*>(data);
+    while (size > 0) {
+        // MSG_NOSIGNAL: a peer that went away is an error, not a SIGPIPE
+        ssize_t nbWritten = send(fd, current, size, MSG_NOSIGNAL);
+        if (nbWritten < 0 && errno == EINTR) {
+            continue;
+        }
+        if (nbWritten <= 0) {
+            return false;
+        }
+        current += nbWritten;
+        size -= nbWritten;
+    }
+    return true;
+}
+
+// Returns false when the connection is closed or the frame is too large. In the latter case, tooLarge is
+// set when given, and the payload is left unread.
+inline bool readFrame(int fd, uint8_t& type, std::vector<char>& payload, bool* tooLarge = nullptr) {
+    uint32_t size;
+    if (!readAll(fd, &size, sizeof(size)) || !readAll(fd, &type, sizeof(type))) {
+        return false;
+    }
+    if (size > MAXFRAMESIZE) {
+        if (tooLarge != nullptr) {
+            *tooLarge = true;
+        }
+        return false;
+    }
+    payload.resize(size);
+    return readAll(fd, payload.data(), size);
+}
+
+inline bool writeFrame(int fd, uint8_t type, const std::vector<char>& payload) {
+    uint32_t size = payload.size();
+    char header[sizeof(size) + sizeof(type)];
+    std::memcpy(header, &size, sizeof(size));
+    header[sizeof(size)] = type;
+    return writeAll(fd, header, sizeof(header)) && writeAll(fd, payload.data(), payload.size());
+}
+
+inline void putUint32(std::vector<char>& payload, uint32_t value) {
+    const char* bytes = reinterpret_cast<const char*>(&value);
+    payload.insert(payload.end(), bytes, bytes + sizeof(value));
+}
+
+// Returns false if payload is too short
+inline bool getUint32(const std::vector<char>& payload, size_t offset, uint32_t& value) {
+    if (offset + sizeof(value) > payload.size()) {
+        return false;
+    }
+    std::memcpy(&value, payload.data() + offset, sizeof(value));
+    return true;
+}
+
+} // namespace protocol
+
+#endif // DAEMONPROTOCOL_HPP
@@ -0,0 +1,139 @@
+#include "GenerationTelemetry.hpp"
+
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <stdexcept>
+#include <ctime>
+#include <unistd.h>
+
+// Formats a number of seconds as HH:MM:SS
+static std::string formatDuration(double seconds) {
+    const uint64_t total = static_cast<uint64_t>(std::max(0.0, seconds));
+    std::ostringstream stream;
+    stream << std::setfill('0') << std::setw(2) << total / 3600 << ":" << std::setw(2) << total / 60 % 60 << ":"
+           << std::setw(2) << total % 60;
+    return stream.str();
+}
+
+GenerationTelemetry::GenerationTelemetry(unsigned nbThreads, uint64_t totalChains, double interval, const std::string& metricsPath)
+    : totalChains{totalChains}, interval{interval}, counters{new ThreadCounters[nbThreads]}, nbThreads{nbThreads},
+      terminal{isatty(STDOUT_FILENO) != 0} {
+    if (!metricsPath.empty()) {
+        metrics.open(metricsPath, std::ios::app);
+        if (!metrics.is_open()) {
+            throw std::runtime_error("Metrics file could not be opened: " + metricsPath);
+        }
+    }
+}
+
+GenerationTelemetry::~GenerationTelemetry() {
+    stop();
+}
+
+void GenerationTelemetry::start() {
+    startTime = std::chrono::steady_clock::now();
+    previous = Snapshot();
+    previous.threadChains.assign(nbThreads, 0);
+    stopping = false;
+    if (interval > 0) {
+        reporter = std::thread(&GenerationTelemetry::run, this);
+    }
+}
+
+void GenerationTelemetry::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stopping) {
+            return;
+        }
+        stopping = true;
+    }
+    wakeUp.notify_one();
+    if (reporter.joinable()) {
+        reporter.join();
+    }
+    report(snapshot(), true);
+}
+
+void GenerationTelemetry::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!wakeUp.wait_for(lock, std::chrono::duration<double>(interval), [this]() { return stopping; })) {
+        lock.unlock();
+        report(snapshot(), false);
+        lock.lock();
+    }
+}
+
+GenerationTelemetry::Snapshot GenerationTelemetry::snapshot() const {
+    Snapshot now;
+    now.elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    now.threadChains.resize(nbThreads);
+    for (unsigned i = 0; i < nbThreads; i++) {
+        now.threadChains[i] = counters[i].chains.load(std::memory_order_relaxed);
+        now.chains += now.threadChains[i];
+        now.hashes += counters[i].hashes.load(std::memory_order_relaxed);
+        now.collisions += counters[i].collisions.load(std::memory_order_relaxed);
+    }
+    return now;
+}
+
+void GenerationTelemetry::report(const Snapshot& now, bool final) {
+    // Rates over the last interval, or over the whole run for the final report
+    const Snapshot& base = final ? Snapshot() : previous;
+    const double seconds = now.elapsed - base.elapsed;
+    const double chainRate = seconds > 0 ? (now.chains - base.chains) / seconds : 0;
+    const double hashRate = seconds > 0 ? (now.hashes - base.hashes) / seconds : 0;
+    const double averageRate = now.elapsed > 0 ? now.chains / now.elapsed : 0;
+    const double eta = averageRate > 0 && now.chains < totalChains ? (totalChains - now.chains) / averageRate : 0;
+    const double progress = totalChains > 0 ? 100.0 * now.chains / totalChains : 100.0;
+
+    // Imbalance: how far the slowest thread is behind the fastest one, relative to the mean
+    const auto range = std::minmax_element(now.threadChains.begin(), now.threadChains.end());
+    const double mean = static_cast<double>(now.chains) / nbThreads;
+    const double imbalance = mean > 0 ? 100.0 * (*range.second - *range.first) / mean : 0;
+
+    const std::time_t wallTime = std::time(nullptr);
+    std::tm localTime;
+    localtime_r(&wallTime, &localTime);
+
+    std::ostringstream line;
+    line << "[" << std::put_time(&localTime, "%H:%M:%S") << "] " << std::fixed << std::setprecision(2) << progress << "% | "
+         << std::setprecision(0) << chainRate << " chains/s | " << hashRate << " hashes/s | "
+         << (final ? "elapsed " + formatDuration(now.elapsed) : "ETA " + formatDuration(eta)) << " | imbalance "
+         << std::setprecision(1) << imbalance << "%";
+    if (now.collisions > 0) {
+        line << " | " << now.collisions << " collisions";
+    }
+    // A terminal shows one line updated in place, a log gets one line per report
+    if (terminal) {
+        std::cout << "\r" << line.str() << "\033[K" << (final ? "\n" : "") << std::flush;
+    } else {
+        std::cout << line.str() << std::endl;
+    }
+
+    if (metrics.is_open()) {
+        metrics << std::fixed << std::setprecision(3) << "{\"time\": " << wallTime << ", \"phase\": \""
+                << (final ? "generated" : "generating") << "\", \"elapsed\": " << now.elapsed << ", \"chains\": " << now.chains
+                << ", \"total_chains\": " << totalChains << ", \"hashes\": " << now.hashes << ", \"collisions\": " << now.collisions
+                << ", \"chains_per_second\": " << chainRate << ", \"hashes_per_second\": " << hashRate << ", \"eta\": " << eta
+                << ", \"imbalance\": " << imbalance / 100 << ", \"thread_chains\": [";
+        for (unsigned i = 0; i < nbThreads; i++) {
+            metrics << (i == 0 ? "" : ", ") << now.threadChains[i];
+        }
+        metrics << "]}" << std::endl;
+    }
+    previous = now;
+}
+
+void GenerationTelemetry::record(const std::string& phase) {
+    if (!metrics.is_open()) {
+        return;
+    }
+    const Snapshot now = snapshot();
+    metrics << std::fixed << std::setprecision(3) << "{\"time\": " << std::time(nullptr) << ", \"phase\": \"" << phase
+            << "\", \"elapsed\": " << now.elapsed << ", \"chains\": " << now.chains << ", \"total_chains\": " << totalChains
+            << ", \"hashes\": " << now.hashes << ", \"collisions\": " << now.collisions
+            << ", \"stored_chains\": " << now.chains - now.collisions << "}" << std::endl;
+}
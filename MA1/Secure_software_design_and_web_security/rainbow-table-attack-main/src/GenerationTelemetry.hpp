@@ -0,0 +1,92 @@
+#ifndef GENERATIONTELEMETRY_HPP
+#define GENERATIONTELEMETRY_HPP
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <fstream>
+#include <cstdint>
+#include <chrono>
+
+/**
+ * Progress and throughput of a table generation.
+ * <p>
+ * Every worker adds what it did to its own counters, which sit on their own
+ * cache line, so the workers never share a line nor take a lock. One reporter
+ * thread reads all the counters every interval seconds and prints the
+ * aggregate chains/s, hashes/s, the ETA and the imbalance between the
+ * threads. It can also append the same figures as one JSON object per line to
+ * a metrics file, so a long run can be followed from outside.
+ */
+class GenerationTelemetry {
+    public:
+        // Counters of one worker, written by it only
+        struct alignas(64) ThreadCounters {
+            std::atomic<uint64_t> chains{0};
+            std::atomic<uint64_t> hashes{0};
+            std::atomic<uint64_t> collisions{0};
+
+            void add(uint64_t nbChains, uint64_t nbHashes) {
+                chains.store(chains.load(std::memory_order_relaxed) + nbChains, std::memory_order_relaxed);
+                hashes.store(hashes.load(std::memory_order_relaxed) + nbHashes, std::memory_order_relaxed);
+            }
+        };
+
+    private:
+        struct Snapshot {
+            double elapsed = 0;
+            uint64_t chains = 0;
+            uint64_t hashes = 0;
+            uint64_t collisions = 0;
+            std::vector<uint64_t> threadChains;
+        };
+
+        uint64_t totalChains;
+        double interval;
+        std::unique_ptr<ThreadCounters[]> counters;
+        unsigned nbThreads;
+        std::ofstream metrics;
+        bool terminal;
+
+        std::chrono::steady_clock::time_point startTime;
+        Snapshot previous;
+        std::thread reporter;
+        std::mutex mutex;
+        std::condition_variable wakeUp;
+        bool stopping = true; // No reporter is running
+
+        Snapshot snapshot() const;
+        void report(const Snapshot& now, bool final);
+        void run();
+
+    public:
+        // totalChains is the number of chains to generate, interval the number of seconds between two reports
+        // (0 for the final report only) and metricsPath the file the JSON lines are appended to (none if empty)
+        GenerationTelemetry(unsigned nbThreads, uint64_t totalChains, double interval, const std::string& metricsPath);
+        ~GenerationTelemetry();
+
+        GenerationTelemetry(const GenerationTelemetry&) = delete;
+        GenerationTelemetry& operator=(const GenerationTelemetry&) = delete;
+
+        ThreadCounters& thread(unsigned index) { return counters[index]; }
+
+        // Starts the reporter thread
+        void start();
+
+        // Stops the reporter thread and prints the final report
+        void stop();
+
+        // Counts the chains dropped because their tail is already in the table (known once the table is sorted)
+        void addCollisions(uint64_t nbCollisions) {
+            counters[0].collisions.fetch_add(nbCollisions, std::memory_order_relaxed);
+        }
+
+        // Appends the final figures to the metrics file, with the given phase (after sorting and saving)
+        void record(const std::string& phase);
+};
+
+#endif // GENERATIONTELEMETRY_HPP
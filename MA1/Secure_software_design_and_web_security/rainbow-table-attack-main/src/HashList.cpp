@@ -0,0 +1,90 @@
+#include "HashList.hpp"
+
+#include <stdexcept>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "Trace.hpp"
+
+
+HashList::HashList(const std::string& path, unsigned digestSize) : digestSize{digestSize} {
+    TRACE_ZONE("read hashes");
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Could not open the hash file " + path);
+    }
+    struct stat status;
+    if (fstat(fd, &status) != 0) {
+        close(fd);
+        throw std::runtime_error("Could not read the hash file " + path);
+    }
+
+    const size_t size = status.st_size;
+    if (size == 0) {
+        close(fd);
+        return;
+    }
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        throw std::runtime_error("Could not map the hash file " + path);
+    }
+    madvise(mapping, size, MADV_SEQUENTIAL);
+
+    parse(static_cast<const char*>(mapping), size);
+    munmap(mapping, size);
+}
+
+void HashList::parse(const char* data, size_t size) {
+    // A line is at least a hash and a newline, which bounds the number of digests
+    size_t capacity = 16;
+    while (capacity < 2 * (size / (2 * digestSize + 1) + 1)) {
+        capacity *= 2;
+    }
+    // slots hold the index of a digest plus one, 0 for an empty slot
+    std::vector<uint32_t> slots(capacity, 0);
+    const size_t mask = capacity - 1;
+
+    const char* line = data;
+    const char* end = data + size;
+    while (line < end) {
+        const char* newline = static_cast<const char*>(std::memchr(line, '\n', end - line));
+        const char* lineEnd = newline != nullptr ? newline : end;
+        size_t length = lineEnd - line;
+        if (length > 0 && line[length - 1] == '\r') {
+            length--;
+        }
+
+        rainbow::Digest digest;
+        if (!hexToDigest(line, length, digest.bytes, digestSize)) {
+            lineDigests.push_back(INVALID);
+        } else {
+            // digests are uniformly distributed, their first bytes are a good hash
+            uint64_t hash;
+            std::memcpy(&hash, digest.bytes, sizeof(hash));
+            size_t slot = hash & mask;
+            while (slots[slot] != 0
+                   && std::memcmp(uniqueDigests[slots[slot] - 1].bytes, digest.bytes, DIGESTSIZE) != 0) {
+                slot = (slot + 1) & mask;
+            }
+            if (slots[slot] == 0) {
+                uniqueDigests.push_back(digest);
+                slots[slot] = uniqueDigests.size();
+            }
+            lineDigests.push_back(slots[slot] - 1);
+        }
+
+        line = lineEnd + 1;
+    }
+}
+
+size_t HashList::nbDuplicates() const {
+    size_t nbValid = 0;
+    for (uint32_t digest : lineDigests) {
+        nbValid += digest != INVALID;
+    }
+    return nbValid - uniqueDigests.size();
+}
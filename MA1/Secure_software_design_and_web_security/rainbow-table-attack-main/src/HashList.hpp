@@ -0,0 +1,44 @@
+#ifndef HASHLIST_HPP
+#define HASHLIST_HPP
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "Rainbow.hpp"
+
+/**
+ * A file of hex hashes, one per line, ingested as binary digests.
+ * <p>
+ * The file is mapped and parsed in one sequential pass. Each distinct hash
+ * is kept once, as a binary digest (an open-addressing hash set spots the
+ * duplicates), and each line only keeps the index of its digest, so the
+ * results computed per digest can be written back in the order of the file.
+ */
+class HashList {
+    public:
+        // Index of the lines that are not a well-formed hash
+        static constexpr uint32_t INVALID = UINT32_MAX;
+
+    private:
+        std::vector<rainbow::Digest> uniqueDigests;
+        std::vector<uint32_t> lineDigests;
+        unsigned digestSize;
+
+        void parse(const char* data, size_t size);
+
+    public:
+        // Reads hashes of digestSize bytes (32 for SHA-256, 20 for SHA-1, 16 for MD5 and NTLM), the lines
+        // of another length are invalid. Throws std::runtime_error if the file cannot be read
+        explicit HashList(const std::string& path, unsigned digestSize = DIGESTSIZE);
+
+        // The distinct digests, in order of first appearance
+        const std::vector<rainbow::Digest>& digests() const { return uniqueDigests; }
+
+        // For each line, the index of its digest in digests(), or INVALID
+        const std::vector<uint32_t>& lines() const { return lineDigests; }
+
+        size_t nbDuplicates() const;
+};
+
+#endif // HASHLIST_HPP
@@ -0,0 +1,82 @@
+#ifndef HASHPOLICY_HPP
+#define HASHPOLICY_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+#include "Rainbow.hpp"
+#include "../utils/sha256-lanes.hpp"
+#include "../utils/sha1-lanes.hpp"
+#include "../utils/md5-lanes.hpp"
+#include "../utils/md4-lanes.hpp"
+
+/**
+ * Hash functions the tables can be built for, as compile-time policies.
+ * <p>
+ * The engines take the policy as a template parameter, so the digest size and
+ * the kernel are known when they are compiled: there is no per-hash dispatch
+ * in the chain walks. Each policy hashes a batch of messages of the same
+ * length with its multi-lane kernel and writes DIGESTSIZE bytes per message.
+ */
+
+// Hashes count messages stored every stride bytes with a kernel of LANES lanes. The last group of
+// lanes is padded by repeating the last message.
+template<unsigned LANES, unsigned SIZE, void (*HASHLANES)(const char* const*, size_t, unsigned char*)>
+inline void hashLanesBatch(const char* messages, size_t stride, size_t length, size_t count, unsigned char* digests)
+{
+    const char* lanes[LANES];
+    unsigned char out[LANES * SIZE];
+
+    for (size_t first = 0; first < count; first += LANES) {
+        size_t n = (count - first < LANES) ? count - first : LANES;
+        for (unsigned l = 0; l < LANES; l++)
+            lanes[l] = messages + stride * (first + (l < n ? l : n - 1));
+
+        if (n == LANES) {
+            HASHLANES(lanes, length, digests + SIZE * first);
+        } else {
+            HASHLANES(lanes, length, out);
+            std::memcpy(digests + SIZE * first, out, SIZE * n);
+        }
+    }
+}
+
+struct Sha256Policy {
+    static constexpr rainbow::HashAlgorithm ALGORITHM = rainbow::SHA256;
+    static constexpr unsigned DIGESTSIZE = 32;
+
+    static void hashBatch(const char* messages, size_t stride, size_t length, size_t count, unsigned char* digests) {
+        sha256Batch(messages, stride, length, count, digests);
+    }
+};
+
+struct Sha1Policy {
+    static constexpr rainbow::HashAlgorithm ALGORITHM = rainbow::SHA1;
+    static constexpr unsigned DIGESTSIZE = 20;
+
+    static void hashBatch(const char* messages, size_t stride, size_t length, size_t count, unsigned char* digests) {
+        hashLanesBatch<SHA1_LANES, DIGESTSIZE, sha1lanes::hashLanes>(messages, stride, length, count, digests);
+    }
+};
+
+struct Md5Policy {
+    static constexpr rainbow::HashAlgorithm ALGORITHM = rainbow::MD5;
+    static constexpr unsigned DIGESTSIZE = 16;
+
+    static void hashBatch(const char* messages, size_t stride, size_t length, size_t count, unsigned char* digests) {
+        hashLanesBatch<MD5_LANES, DIGESTSIZE, md5lanes::hashLanes>(messages, stride, length, count, digests);
+    }
+};
+
+// NTLM is MD4 over the UTF-16LE encoding of the password
+struct NtlmPolicy {
+    static constexpr rainbow::HashAlgorithm ALGORITHM = rainbow::NTLM;
+    static constexpr unsigned DIGESTSIZE = 16;
+
+    static void hashBatch(const char* messages, size_t stride, size_t length, size_t count, unsigned char* digests) {
+        hashLanesBatch<MD4_LANES, DIGESTSIZE, md4lanes::hashLanes<true>>(messages, stride, length, count, digests);
+    }
+};
+
+#endif // HASHPOLICY_HPP
@@ -0,0 +1,177 @@
+#include "HugePages.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <unistd.h>
+
+static const size_t HUGEPAGESIZE_2MB = size_t(1) << 21;
+static const size_t HUGEPAGESIZE_1GB = size_t(1) << 30;
+
+// log2 of the page size in the flags of mmap, as linux/mman.h defines MAP_HUGE_2MB and MAP_HUGE_1GB
+static const int HUGEPAGEFLAG_2MB = 21 << MAP_HUGE_SHIFT;
+static const int HUGEPAGEFLAG_1GB = 30 << MAP_HUGE_SHIFT;
+
+bool parseHugePages(const std::string& name, HugePages& hugePages) {
+    for (HugePages candidate : {HUGEPAGES_OFF, HUGEPAGES_THP, HUGEPAGES_2MB, HUGEPAGES_1GB}) {
+        if (name == hugePagesName(candidate)) {
+            hugePages = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* hugePagesName(HugePages hugePages) {
+    switch (hugePages) {
+        case HUGEPAGES_OFF: return "off";
+        case HUGEPAGES_THP: return "thp";
+        case HUGEPAGES_2MB: return "2m";
+        case HUGEPAGES_1GB: return "1g";
+    }
+    return "unknown";
+}
+
+static size_t roundUp(size_t size, size_t pageSize) {
+    return (size + pageSize - 1) / pageSize * pageSize;
+}
+
+// Maps size bytes of hugetlbfs pages, nullptr if none are reserved
+static void* mapHugetlb(size_t size, size_t pageSize, int pageFlag) {
+    void* mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | pageFlag, -1, 0);
+    return mapping == MAP_FAILED ? nullptr : mapping;
+}
+
+// Maps size bytes aligned on 2 MiB, so that the kernel can back all of them with transparent huge pages
+static void* mapAligned(size_t size) {
+    const size_t extended = size + HUGEPAGESIZE_2MB;
+    void* mapping = mmap(nullptr, extended, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (mapping == MAP_FAILED) {
+        return nullptr;
+    }
+    const uintptr_t address = reinterpret_cast<uintptr_t>(mapping);
+    const uintptr_t aligned = roundUp(address, HUGEPAGESIZE_2MB);
+    if (aligned > address) {
+        munmap(mapping, aligned - address);
+    }
+    const uintptr_t end = address + extended;
+    if (end > aligned + size) {
+        munmap(reinterpret_cast<void*>(aligned + size), end - (aligned + size));
+    }
+    return reinterpret_cast<void*>(aligned);
+}
+
+PageRegion::PageRegion(size_t size, HugePages hugePages) : requestedSize{size}, requested{hugePages} {
+    if (size == 0) {
+        return;
+    }
+    if (hugePages == HUGEPAGES_1GB) {
+        mappedSize = roundUp(size, HUGEPAGESIZE_1GB);
+        if ((mapping = mapHugetlb(mappedSize, HUGEPAGESIZE_1GB, HUGEPAGEFLAG_1GB)) != nullptr) {
+            obtained = HUGEPAGES_1GB;
+            return;
+        }
+    }
+    if (hugePages >= HUGEPAGES_2MB) {
+        mappedSize = roundUp(size, HUGEPAGESIZE_2MB);
+        if ((mapping = mapHugetlb(mappedSize, HUGEPAGESIZE_2MB, HUGEPAGEFLAG_2MB)) != nullptr) {
+            obtained = HUGEPAGES_2MB;
+            return;
+        }
+    }
+    if (hugePages >= HUGEPAGES_THP) {
+        mappedSize = roundUp(size, HUGEPAGESIZE_2MB);
+        if ((mapping = mapAligned(mappedSize)) == nullptr) {
+            throw std::runtime_error("Could not map " + std::to_string(size) + " bytes");
+        }
+        // Refused when transparent huge pages are disabled ("never" in /sys/kernel/mm/transparent_hugepage/enabled)
+        obtained = madvise(mapping, mappedSize, MADV_HUGEPAGE) == 0 ? HUGEPAGES_THP : HUGEPAGES_OFF;
+        return;
+    }
+    mappedSize = size;
+    mapping = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (mapping == MAP_FAILED) {
+        mapping = nullptr;
+        throw std::runtime_error("Could not map " + std::to_string(size) + " bytes");
+    }
+}
+
+void PageRegion::release() {
+    if (mapping != nullptr) {
+        munmap(mapping, mappedSize);
+        mapping = nullptr;
+    }
+}
+
+PageRegion::PageRegion(PageRegion&& other) noexcept
+    : mapping{other.mapping}, mappedSize{other.mappedSize}, requestedSize{other.requestedSize}, requested{other.requested},
+      obtained{other.obtained} {
+    other.mapping = nullptr;
+}
+
+PageRegion& PageRegion::operator=(PageRegion&& other) noexcept {
+    if (this != &other) {
+        release();
+        mapping = other.mapping;
+        mappedSize = other.mappedSize;
+        requestedSize = other.requestedSize;
+        requested = other.requested;
+        obtained = other.obtained;
+        other.mapping = nullptr;
+    }
+    return *this;
+}
+
+// Bytes of the mapping that starts at address backed by transparent huge pages, 0 if /proc/self/smaps cannot be read
+static size_t anonHugePages(const void* address) {
+    std::ifstream smaps("/proc/self/smaps");
+    std::string line;
+    bool inMapping = false;
+    while (std::getline(smaps, line)) {
+        unsigned long start;
+        unsigned long end;
+        if (std::sscanf(line.c_str(), "%lx-%lx ", &start, &end) == 2) {
+            inMapping = start <= reinterpret_cast<uintptr_t>(address) && reinterpret_cast<uintptr_t>(address) < end;
+            continue;
+        }
+        size_t kiloBytes;
+        if (inMapping && std::sscanf(line.c_str(), "AnonHugePages: %zu kB", &kiloBytes) == 1) {
+            return kiloBytes * 1024;
+        }
+    }
+    return 0;
+}
+
+std::string PageRegion::describe() const {
+    std::ostringstream stream;
+    switch (obtained) {
+        case HUGEPAGES_OFF:
+            stream << sysconf(_SC_PAGESIZE) / 1024 << " KiB pages";
+            break;
+        case HUGEPAGES_THP: {
+            const size_t huge = std::min(anonHugePages(mapping), mappedSize);
+            stream << "2 MiB transparent huge pages on " << huge / HUGEPAGESIZE_2MB << " of " << mappedSize / HUGEPAGESIZE_2MB
+                   << " blocks, " << sysconf(_SC_PAGESIZE) / 1024 << " KiB pages elsewhere";
+            break;
+        }
+        case HUGEPAGES_2MB:
+            stream << "2 MiB hugetlbfs pages";
+            break;
+        case HUGEPAGES_1GB:
+            stream << "1 GiB hugetlbfs pages";
+            break;
+    }
+    if (obtained != requested) {
+        stream << "; " << hugePagesName(requested) << " requested, ";
+        if (requested >= HUGEPAGES_2MB) {
+            stream << "see /proc/sys/vm/nr_hugepages";
+        } else {
+            stream << "transparent huge pages disabled";
+        }
+    }
+    return stream.str();
+}
@@ -0,0 +1,67 @@
+#ifndef HUGEPAGES_HPP
+#define HUGEPAGES_HPP
+
+#include <string>
+#include <cstddef>
+
+/**
+ * Anonymous memory backed by huge pages, for the tables probed at random.
+ * <p>
+ * With 4 KiB pages, nearly every probe of a table of several GB misses the
+ * TLB. A 2 MiB page covers 512 times more of the table per TLB entry, a 1 GiB
+ * page 262144 times more. Pages of hugetlbfs (MAP_HUGETLB) are only there if
+ * the administrator reserved them (/proc/sys/vm/nr_hugepages, or the
+ * hugepages= boot parameter for 1 GiB pages). Transparent huge pages are
+ * asked for with madvise(MADV_HUGEPAGE) and given by the kernel when it finds
+ * free 2 MiB blocks. Each kind falls back to the next smaller one: 1 GiB, then
+ * 2 MiB hugetlbfs pages, then transparent huge pages, then normal pages.
+ */
+
+enum HugePages {
+    HUGEPAGES_OFF,  // normal pages
+    HUGEPAGES_THP,  // transparent huge pages
+    HUGEPAGES_2MB,  // 2 MiB hugetlbfs pages
+    HUGEPAGES_1GB   // 1 GiB hugetlbfs pages
+};
+
+// Names as given on the command line: off, thp, 2m and 1g
+bool parseHugePages(const std::string& name, HugePages& hugePages);
+
+const char* hugePagesName(HugePages hugePages);
+
+class PageRegion {
+    private:
+        void* mapping = nullptr;
+        size_t mappedSize = 0;
+        size_t requestedSize = 0;
+        HugePages requested = HUGEPAGES_OFF;
+        HugePages obtained = HUGEPAGES_OFF;
+
+        void release();
+
+    public:
+        PageRegion() {}
+
+        // Maps at least size bytes, left untouched: the pages are allocated, on the node of the thread, when first
+        // written. Throws std::runtime_error if not even normal pages can be mapped.
+        PageRegion(size_t size, HugePages hugePages);
+        ~PageRegion() { release(); }
+
+        PageRegion(const PageRegion&) = delete;
+        PageRegion& operator=(const PageRegion&) = delete;
+
+        PageRegion(PageRegion&& other) noexcept;
+        PageRegion& operator=(PageRegion&& other) noexcept;
+
+        void* data() const { return mapping; }
+        size_t size() const { return requestedSize; }
+
+        // The kind of pages the region was mapped with, after the fallbacks
+        HugePages pages() const { return obtained; }
+
+        // The pages obtained, for example "2 MiB hugetlbfs pages; 1g requested, see ...". For transparent huge pages, how much
+        // of the region they back so far, read from /proc/self/smaps: call it once the region has been written.
+        std::string describe() const;
+};
+
+#endif // HUGEPAGES_HPP
@@ -0,0 +1,79 @@
+#ifndef INSTANTIATE_HPP
+#define INSTANTIATE_HPP
+
+#include <stdexcept>
+#include <type_traits>
+
+#include "HashPolicy.hpp"
+#include "Charset.hpp"
+
+// Explicit instantiations of an engine template<unsigned PASSWDLENGTH, class Hash, class Charset> for every
+// combination the executables dispatch to: each hash policy, with every length from 1 to the MAXLENGTH of
+// each charset (12 for lowercase and digits, 10 for alnum, 9 for printable). Used at the end of the .cpp
+// that defines the engine, as INSTANTIATE_ENGINE(BatchCracker).
+
+#define INSTANTIATE_LENGTHS_9(ENGINE, HASH, CHARSET) \
+    template class ENGINE<1, HASH, CHARSET>; \
+    template class ENGINE<2, HASH, CHARSET>; \
+    template class ENGINE<3, HASH, CHARSET>; \
+    template class ENGINE<4, HASH, CHARSET>; \
+    template class ENGINE<5, HASH, CHARSET>; \
+    template class ENGINE<6, HASH, CHARSET>; \
+    template class ENGINE<7, HASH, CHARSET>; \
+    template class ENGINE<8, HASH, CHARSET>; \
+    template class ENGINE<9, HASH, CHARSET>;
+
+#define INSTANTIATE_LENGTHS_10(ENGINE, HASH, CHARSET) \
+    INSTANTIATE_LENGTHS_9(ENGINE, HASH, CHARSET) \
+    template class ENGINE<10, HASH, CHARSET>;
+
+#define INSTANTIATE_LENGTHS_12(ENGINE, HASH, CHARSET) \
+    INSTANTIATE_LENGTHS_10(ENGINE, HASH, CHARSET) \
+    template class ENGINE<11, HASH, CHARSET>; \
+    template class ENGINE<12, HASH, CHARSET>;
+
+#define INSTANTIATE_CHARSETS(ENGINE, HASH) \
+    INSTANTIATE_LENGTHS_12(ENGINE, HASH, LowercaseCharset) \
+    INSTANTIATE_LENGTHS_12(ENGINE, HASH, DigitsCharset) \
+    INSTANTIATE_LENGTHS_10(ENGINE, HASH, AlnumCharset) \
+    INSTANTIATE_LENGTHS_9(ENGINE, HASH, PrintableCharset)
+
+#define INSTANTIATE_ENGINE(ENGINE) \
+    INSTANTIATE_CHARSETS(ENGINE, Sha256Policy) \
+    INSTANTIATE_CHARSETS(ENGINE, Sha1Policy) \
+    INSTANTIATE_CHARSETS(ENGINE, Md5Policy) \
+    INSTANTIATE_CHARSETS(ENGINE, NtlmPolicy)
+
+// Runtime counterpart of INSTANTIATE_ENGINE: calls function(std::integral_constant<unsigned, L>(), Hash(), Charset())
+// with the instantiation of the hash, charset and password length L known at run time, and returns its result.
+// Throws std::invalid_argument if the length is not supported by the charset.
+template<class Function>
+auto dispatchEngine(rainbow::HashAlgorithm hash, rainbow::CharsetKind charset, unsigned length, Function&& function) {
+    auto withHash = [&](auto policy) {
+        auto withCharset = [&](auto charsetPolicy) {
+            return dispatchLength<decltype(charsetPolicy)::MAXLENGTH>(length, [&](auto passwordLength) {
+                return function(passwordLength, policy, charsetPolicy);
+            });
+        };
+        switch (charset) {
+            case rainbow::LOWERCASE: return withCharset(LowercaseCharset());
+            case rainbow::DIGITS: return withCharset(DigitsCharset());
+            case rainbow::ALNUM: return withCharset(AlnumCharset());
+            case rainbow::PRINTABLE: return withCharset(PrintableCharset());
+        }
+        throw std::invalid_argument("Unknown charset");
+    };
+    switch (hash) {
+        case rainbow::SHA256: return withHash(Sha256Policy());
+        case rainbow::SHA1: return withHash(Sha1Policy());
+        case rainbow::MD5: return withHash(Md5Policy());
+        case rainbow::NTLM: return withHash(NtlmPolicy());
+    }
+    throw std::invalid_argument("Unknown hash algorithm");
+}
+
+static_assert(LowercaseCharset::MAXLENGTH == 12 && DigitsCharset::MAXLENGTH == 12
+              && AlnumCharset::MAXLENGTH == 10 && PrintableCharset::MAXLENGTH == 9,
+              "INSTANTIATE_CHARSETS must follow the MAXLENGTH of the charsets");
+
+#endif // INSTANTIATE_HPP
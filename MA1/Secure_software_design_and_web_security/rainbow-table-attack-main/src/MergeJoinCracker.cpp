@@ -0,0 +1,235 @@
+#include "MergeJoinCracker.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <thread>
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+
+#include "BatchCracker.hpp"
+#include "Timer.hpp"
+#include "Instantiate.hpp"
+#include "Trace.hpp"
+
+
+template<unsigned PASSWDLENGTH, class Hash, class Charset>
+static void walkBatch(int chainLength, const rainbow::Digest* digests, size_t first, unsigned count,
+                      MergeJoinCracker::Lookup* lookups) {
+    using Cracker = BatchCracker<PASSWDLENGTH, Hash, Charset>;
+    static_assert(Cracker::BATCHSIZE == MergeJoinCracker::BATCHSIZE, "a batch of the merge join is a batch of the engine");
+
+    Cracker cracker(chainLength);
+    typename Cracker::Target targets[Cracker::BATCHSIZE];
+    typename Cracker::Target* batch[Cracker::BATCHSIZE];
+    for (unsigned k = 0; k < count; k++) {
+        std::memcpy(targets[k].digest, digests[first + k].bytes, DIGESTSIZE);
+        batch[k] = &targets[k];
+    }
+
+    const size_t nbColumns = chainLength + 1;
+    for (int column = chainLength; 0 <= column; column--) {
+        const uint64_t* endpoints = cracker.walkColumn(batch, count, column);
+        for (unsigned k = 0; k < count; k++) {
+            lookups[(first + k) * nbColumns + column] = {endpoints[k], static_cast<uint32_t>(first + k), column};
+        }
+    }
+}
+
+template<unsigned PASSWDLENGTH, class Hash, class Charset>
+static void verifyBatch(int chainLength, int column, const rainbow::Digest* const* digests, const uint64_t* heads,
+                        unsigned count, rainbow::Result* found) {
+    using Cracker = BatchCracker<PASSWDLENGTH, Hash, Charset>;
+
+    Cracker cracker(chainLength);
+    typename Cracker::Target targets[Cracker::BATCHSIZE];
+    typename Cracker::Target* batch[Cracker::BATCHSIZE] = {}; // GCC cannot tell that count > 0
+    bool verified[Cracker::BATCHSIZE];
+    for (unsigned j = 0; j < count; j++) {
+        std::memcpy(targets[j].digest, digests[j]->bytes, DIGESTSIZE);
+        batch[j] = &targets[j];
+    }
+
+    cracker.verify(batch, heads, count, column, verified);
+    for (unsigned j = 0; j < count; j++) {
+        found[j].length = verified[j] ? PASSWDLENGTH : 0;
+        if (verified[j]) {
+            std::memcpy(found[j].password, targets[j].password, PASSWDLENGTH);
+        }
+    }
+}
+
+MergeJoinCracker::MergeJoinCracker(const std::string& tableFilename, unsigned passwordLength, int chainLength,
+                                   unsigned nbThreads, rainbow::HashAlgorithm hash, rainbow::CharsetKind charset)
+    : tableFilename{tableFilename}, chainLength{chainLength}, nbThreads{nbThreads} {
+    if (passwordLength < rainbow::MINPASSWORDLENGTH || passwordLength > rainbow::charsetMaxLength(charset)) {
+        throw std::invalid_argument("Unsupported password length: " + std::to_string(passwordLength)
+                                    + " (" + rainbow::charsetName(charset) + ")");
+    }
+    dispatchEngine(hash, charset, passwordLength, [this](auto length, auto policy, auto charsetPolicy) {
+        walk = walkBatch<decltype(length)::value, decltype(policy), decltype(charsetPolicy)>;
+        verify = verifyBatch<decltype(length)::value, decltype(policy), decltype(charsetPolicy)>;
+    });
+}
+
+void MergeJoinCracker::crack(const std::vector<rainbow::Digest>& digests, std::vector<rainbow::Result>& results,
+                             const std::atomic<bool>& keepRunning) {
+    for (rainbow::Result& result : results) {
+        result.length = 0;
+    }
+
+    Timer timer;
+    timer.start();
+
+    std::vector<Lookup> lookups;
+    computeEndpoints(digests, lookups, keepRunning);
+    if (!keepRunning.load()) {
+        std::cout << "Interrupted while computing the endpoints." << std::endl;
+        return;
+    }
+    {
+        TRACE_ZONE("sort endpoints");
+        std::sort(lookups.begin(), lookups.end(), [](const Lookup& a, const Lookup& b) {
+            return a.endpoint < b.endpoint;
+        });
+    }
+    std::cout << "Computed and sorted " << lookups.size() << " endpoints in " << timer.elapsedTime() << " seconds." << std::endl;
+    timer.reset();
+    timer.start();
+
+    std::vector<Candidate> candidates;
+    joinTable(lookups, candidates, keepRunning);
+    std::vector<Lookup>().swap(lookups);
+    std::cout << "Joined table in " << timer.elapsedTime() << " seconds: " << candidates.size() << " candidates." << std::endl;
+    timer.reset();
+    timer.start();
+
+    std::vector<std::atomic<bool>> cracked(digests.size());
+    verifyCandidates(digests, candidates, cracked, results, keepRunning);
+    std::cout << "Verified candidates in " << timer.elapsedTime() << " seconds." << std::endl;
+}
+
+void MergeJoinCracker::computeEndpoints(const std::vector<rainbow::Digest>& digests, std::vector<Lookup>& lookups,
+                                        const std::atomic<bool>& keepRunning) {
+    TRACE_ZONE("compute endpoints");
+    lookups.resize(digests.size() * (chainLength + 1));
+
+    std::atomic<size_t> nextBatch(0);
+    auto worker = [&]() {
+        size_t first;
+        while (keepRunning.load() && (first = nextBatch.fetch_add(BATCHSIZE)) < digests.size()) {
+            TRACE_ZONE("endpoints batch");
+            unsigned count = std::min<size_t>(BATCHSIZE, digests.size() - first);
+            walk(chainLength, digests.data(), first, count, lookups.data());
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned i = 0; i < nbThreads; i++) {
+        threads.emplace_back(worker);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    // the batches no worker reached are still {0, 0, 0}: none of the lookups can be trusted
+    if (!keepRunning.load()) {
+        lookups.clear();
+    }
+}
+
+void MergeJoinCracker::joinTable(const std::vector<Lookup>& lookups, std::vector<Candidate>& candidates,
+                                 const std::atomic<bool>& keepRunning) {
+    TRACE_ZONE("join table");
+    std::ifstream file(tableFilename, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Could not open file");
+    }
+
+    std::vector<std::pair<uint64_t, uint64_t>> chunk(READSIZE);
+    size_t next = 0;
+    uint64_t previousTail = 0;
+
+    while (next < lookups.size() && keepRunning.load()) {
+        file.read(reinterpret_cast<char*>(chunk.data()), READSIZE * sizeof(chunk[0]));
+        size_t nbEntries = file.gcount() / sizeof(chunk[0]);
+        if (nbEntries == 0) {
+            break;
+        }
+
+        for (size_t e = 0; e < nbEntries && next < lookups.size(); e++) {
+            const uint64_t tail = chunk[e].second;
+            if (tail < previousTail) {
+                throw std::runtime_error("Rainbow table is not sorted by tails");
+            }
+            previousTail = tail;
+
+            while (next < lookups.size() && lookups[next].endpoint < tail) {
+                next++;
+            }
+            // several lookups can share an endpoint, and the table may still hold duplicated tails
+            for (size_t l = next; l < lookups.size() && lookups[l].endpoint == tail; l++) {
+                candidates.push_back({chunk[e].first, lookups[l].target, lookups[l].column});
+            }
+        }
+    }
+}
+
+void MergeJoinCracker::verifyCandidates(const std::vector<rainbow::Digest>& digests, std::vector<Candidate>& candidates,
+                                        std::vector<std::atomic<bool>>& cracked, std::vector<rainbow::Result>& results,
+                                        const std::atomic<bool>& keepRunning) {
+    TRACE_ZONE("verify candidates");
+
+    // Cheapest columns first, and candidates of a same column are verified in lockstep
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+        return a.column > b.column;
+    });
+
+    std::vector<size_t> batches;
+    for (size_t c = 0; c < candidates.size(); c++) {
+        if (batches.empty() || candidates[c].column != candidates[batches.back()].column
+            || c - batches.back() == BATCHSIZE) {
+            batches.push_back(c);
+        }
+    }
+    batches.push_back(candidates.size());
+
+    std::atomic<size_t> nextBatch(0);
+    auto worker = [&]() {
+        const rainbow::Digest* batch[BATCHSIZE];
+        uint64_t heads[BATCHSIZE];
+        uint32_t owners[BATCHSIZE];
+        rainbow::Result found[BATCHSIZE];
+        size_t b;
+        while (keepRunning.load() && (b = nextBatch.fetch_add(1)) + 1 < batches.size()) {
+            unsigned count = 0;
+            for (size_t c = batches[b]; c < batches[b + 1]; c++) {
+                if (cracked[candidates[c].target].load()) {
+                    continue;
+                }
+                batch[count] = &digests[candidates[c].target];
+                heads[count] = candidates[c].head;
+                owners[count++] = candidates[c].target;
+            }
+            if (count == 0) {
+                continue;
+            }
+
+            verify(chainLength, candidates[batches[b]].column, batch, heads, count, found);
+            for (unsigned j = 0; j < count; j++) {
+                // a target may be verified by two threads at once, only the first one writes it
+                if (found[j].length > 0 && !cracked[owners[j]].exchange(true)) {
+                    std::cout << "Password cracked." << std::endl;
+                    results[owners[j]] = found[j];
+                }
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned i = 0; i < nbThreads; i++) {
+        threads.emplace_back(worker);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
@@ -0,0 +1,78 @@
+#ifndef MERGEJOINCRACKER_HPP
+#define MERGEJOINCRACKER_HPP
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <cstdint>
+
+#include "Rainbow.hpp"
+
+/**
+ * Lookup engine for tables that do not fit in memory.
+ * <p>
+ * The endpoints of the online chains of every target and every column are
+ * computed first and sorted, keeping a reference to their target and column.
+ * The table file, sorted by tails, is then read once sequentially and
+ * merge-joined against them, and only the matching chains are regenerated.
+ * <p>
+ * The hash, the charset and the password length are given at run time: only the
+ * walks and the regenerations of a batch go through the instantiation of the
+ * batch engine picked on construction, the sorts and the join are shared.
+ */
+class MergeJoinCracker {
+    public:
+        // Number of table entries read at once
+        static const size_t READSIZE = 1 << 20;
+
+        // Number of targets walked, or candidates verified, at once
+        static const unsigned BATCHSIZE = 64;
+
+        struct Lookup {
+            uint64_t endpoint;
+            uint32_t target;
+            int32_t column;
+        };
+
+        struct Candidate {
+            uint64_t head;
+            uint32_t target;
+            int32_t column;
+        };
+
+    private:
+        // Writes the lookups of the count (<= BATCHSIZE) targets from first, for every column, at
+        // lookups[target * (chainLength + 1) + column]
+        using WalkFunction = void (*)(int chainLength, const rainbow::Digest* digests, size_t first, unsigned count,
+                                      Lookup* lookups);
+        // Regenerates the chains of the count (<= BATCHSIZE) heads up to column and checks them against
+        // digests[j], the target of heads[j]. found[j].length is set and the password filled in on success.
+        using VerifyFunction = void (*)(int chainLength, int column, const rainbow::Digest* const* digests,
+                                        const uint64_t* heads, unsigned count, rainbow::Result* found);
+
+        std::string tableFilename;
+        int chainLength;
+        unsigned nbThreads;
+        WalkFunction walk;
+        VerifyFunction verify;
+
+        void computeEndpoints(const std::vector<rainbow::Digest>& digests, std::vector<Lookup>& lookups,
+                              const std::atomic<bool>& keepRunning);
+
+        void joinTable(const std::vector<Lookup>& lookups, std::vector<Candidate>& candidates, const std::atomic<bool>& keepRunning);
+
+        void verifyCandidates(const std::vector<rainbow::Digest>& digests, std::vector<Candidate>& candidates,
+                              std::vector<std::atomic<bool>>& cracked, std::vector<rainbow::Result>& results,
+                              const std::atomic<bool>& keepRunning);
+
+    public:
+        // Throws std::invalid_argument if passwordLength is not supported by the charset
+        MergeJoinCracker(const std::string& tableFilename, unsigned passwordLength, int chainLength, unsigned nbThreads,
+                         rainbow::HashAlgorithm hash = rainbow::SHA256, rainbow::CharsetKind charset = rainbow::ALNUM);
+
+        // Cracks every digest, writing its result at the same index of results
+        void crack(const std::vector<rainbow::Digest>& digests, std::vector<rainbow::Result>& results,
+                   const std::atomic<bool>& keepRunning);
+};
+
+#endif // MERGEJOINCRACKER_HPP
@@ -0,0 +1,133 @@
+#include "Numa.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <algorithm>
+#include <cstdio>
+#include <sched.h>
+
+bool parseAffinity(const std::string& name, Affinity& affinity) {
+    for (Affinity candidate : {AFFINITY_NONE, AFFINITY_NODE, AFFINITY_CORE}) {
+        if (name == affinityName(candidate)) {
+            affinity = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* affinityName(Affinity affinity) {
+    switch (affinity) {
+        case AFFINITY_NONE: return "none";
+        case AFFINITY_NODE: return "node";
+        case AFFINITY_CORE: return "core";
+    }
+    return "unknown";
+}
+
+// Parses a CPU list of sysfs, such as "0-7,16-23"
+static std::vector<int> parseCpuList(const std::string& list) {
+    std::vector<int> cpus;
+    std::istringstream stream(list);
+    std::string range;
+    while (std::getline(stream, range, ',')) {
+        int first;
+        int last;
+        const int nbParsed = std::sscanf(range.c_str(), "%d-%d", &first, &last);
+        if (nbParsed == 1) {
+            last = first;
+        } else if (nbParsed != 2) {
+            continue;
+        }
+        for (int cpu = first; cpu <= last; cpu++) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+ThreadPlacement::ThreadPlacement(Affinity affinity) : affinity{affinity} {
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            CPU_SET(cpu, &allowed);
+        }
+    }
+
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator("/sys/devices/system/node", ec)) {
+        const std::string name = entry.path().filename().string();
+        unsigned id;
+        if (name.compare(0, 4, "node") != 0 || std::sscanf(name.c_str() + 4, "%u", &id) != 1) {
+            continue;
+        }
+        std::ifstream file(entry.path() / "cpulist");
+        std::string list;
+        std::getline(file, list);
+        NumaNode node{id, {}};
+        for (int cpu : parseCpuList(list)) {
+            if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed)) {
+                node.cpus.push_back(cpu);
+            }
+        }
+        if (!node.cpus.empty()) {
+            numaNodes.push_back(node);
+        }
+    }
+    if (numaNodes.empty()) {
+        NumaNode node{0, {}};
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if (CPU_ISSET(cpu, &allowed)) {
+                node.cpus.push_back(cpu);
+            }
+        }
+        numaNodes.push_back(node);
+    }
+    std::sort(numaNodes.begin(), numaNodes.end(), [](const NumaNode& a, const NumaNode& b) { return a.id < b.id; });
+
+    for (unsigned n = 0; n < numaNodes.size(); n++) {
+        for (int cpu : numaNodes[n].cpus) {
+            cpus.push_back(cpu);
+            cpuNodes.push_back(n);
+        }
+    }
+}
+
+unsigned ThreadPlacement::pin(unsigned index) const {
+    const unsigned node = nodeOf(index);
+    if (affinity == AFFINITY_NODE) {
+        pinNode(node);
+    } else if (affinity == AFFINITY_CORE) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpus[index % cpus.size()], &set);
+        sched_setaffinity(0, sizeof(set), &set);
+    }
+    return node;
+}
+
+void ThreadPlacement::pinNode(unsigned node) const {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : numaNodes[node].cpus) {
+        CPU_SET(cpu, &set);
+    }
+    sched_setaffinity(0, sizeof(set), &set);
+}
+
+std::string ThreadPlacement::describe() const {
+    std::ostringstream stream;
+    stream << numaNodes.size() << " NUMA node" << (numaNodes.size() > 1 ? "s" : "") << " (";
+    for (size_t n = 0; n < numaNodes.size(); n++) {
+        stream << (n == 0 ? "" : ", ") << "node " << numaNodes[n].id << ": " << numaNodes[n].cpus.size() << " CPUs";
+    }
+    stream << "), workers ";
+    switch (affinity) {
+        case AFFINITY_NONE: stream << "not pinned"; break;
+        case AFFINITY_NODE: stream << "pinned to a node"; break;
+        case AFFINITY_CORE: stream << "pinned to a CPU"; break;
+    }
+    return stream.str();
+}
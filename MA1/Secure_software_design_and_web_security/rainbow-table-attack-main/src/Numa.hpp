@@ -0,0 +1,61 @@
+#ifndef NUMA_HPP
+#define NUMA_HPP
+
+#include <string>
+#include <vector>
+
+/**
+ * NUMA topology and thread pinning, read from /sys/devices/system/node.
+ * <p>
+ * Linux places a page on the node of the thread that first writes it. A
+ * thread pinned to a node that first-touches its own data keeps it in local
+ * memory. A host without NUMA, or whose sysfs cannot be read, is one node
+ * holding every CPU the process may run on.
+ */
+
+// How worker threads are pinned
+enum Affinity {
+    AFFINITY_NONE, // left to the scheduler
+    AFFINITY_NODE, // each worker to the CPUs of one node
+    AFFINITY_CORE  // each worker to one CPU
+};
+
+bool parseAffinity(const std::string& name, Affinity& affinity);
+
+const char* affinityName(Affinity affinity);
+
+struct NumaNode {
+    unsigned id;
+    std::vector<int> cpus; // the CPUs of the node the process may run on
+};
+
+class ThreadPlacement {
+    private:
+        Affinity affinity;
+        std::vector<NumaNode> numaNodes;
+        std::vector<unsigned> cpuNodes; // index in numaNodes of every CPU, CPUs in node order
+        std::vector<int> cpus;
+
+    public:
+        explicit ThreadPlacement(Affinity affinity);
+
+        Affinity getAffinity() const { return affinity; }
+
+        // The nodes with at least one CPU the process may run on, at least one
+        const std::vector<NumaNode>& nodes() const { return numaNodes; }
+
+        // Index in nodes() of the index-th worker: consecutive workers fill a node before the next one
+        unsigned nodeOf(unsigned index) const { return cpuNodes[index % cpuNodes.size()]; }
+
+        // Pins the calling thread as the index-th worker, and returns nodeOf(index). A pinning refused by the
+        // kernel (a cpuset for instance) leaves the thread where it is.
+        unsigned pin(unsigned index) const;
+
+        // Pins the calling thread to the CPUs of nodes()[node], whatever the affinity
+        void pinNode(unsigned node) const;
+
+        // For example "2 NUMA nodes (node 0: 8 CPUs, node 1: 8 CPUs), workers pinned to a node"
+        std::string describe() const;
+};
+
+#endif // NUMA_HPP
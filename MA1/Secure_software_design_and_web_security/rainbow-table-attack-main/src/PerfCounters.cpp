@@ -0,0 +1,215 @@
+#include "PerfCounters.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <iomanip>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static const char* const EVENTNAMES[NBPERFEVENTS] = {
+    "task-clock", "cycles", "instructions", "LLC-misses", "branch-misses", "dTLB-misses"
+};
+
+// Events that could not be opened on some thread, and the error of the first one
+static std::atomic<unsigned> unavailableEvents(0);
+static std::atomic<int> firstError(0);
+
+static std::atomic<unsigned> nextThreadIndex(0);
+
+// The counters of the calling thread, opened on its first scope and closed when it exits
+class ThreadCounters {
+    private:
+        int fds[NBPERFEVENTS];
+
+        static int open(PerfEvent event) {
+            perf_event_attr attributes;
+            std::memset(&attributes, 0, sizeof(attributes));
+            attributes.size = sizeof(attributes);
+            attributes.exclude_kernel = 1;
+            attributes.exclude_hv = 1;
+            attributes.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            switch (event) {
+                case PERF_TASKCLOCK:
+                    attributes.type = PERF_TYPE_SOFTWARE;
+                    attributes.config = PERF_COUNT_SW_TASK_CLOCK;
+                    break;
+                case PERF_CYCLES:
+                    attributes.type = PERF_TYPE_HARDWARE;
+                    attributes.config = PERF_COUNT_HW_CPU_CYCLES;
+                    break;
+                case PERF_INSTRUCTIONS:
+                    attributes.type = PERF_TYPE_HARDWARE;
+                    attributes.config = PERF_COUNT_HW_INSTRUCTIONS;
+                    break;
+                case PERF_LLCMISSES:
+                    attributes.type = PERF_TYPE_HARDWARE;
+                    attributes.config = PERF_COUNT_HW_CACHE_MISSES;
+                    break;
+                case PERF_BRANCHMISSES:
+                    attributes.type = PERF_TYPE_HARDWARE;
+                    attributes.config = PERF_COUNT_HW_BRANCH_MISSES;
+                    break;
+                case PERF_DTLBMISSES:
+                    attributes.type = PERF_TYPE_HW_CACHE;
+                    attributes.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                                        | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+                    break;
+                default:
+                    return -1;
+            }
+            // This thread, on any CPU
+            const int fd = syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0);
+            if (fd < 0) {
+                unavailableEvents |= 1u << event;
+                int none = 0;
+                firstError.compare_exchange_strong(none, errno);
+            }
+            return fd;
+        }
+
+    public:
+        const unsigned index = nextThreadIndex++;
+
+        ThreadCounters() {
+            for (int e = 0; e < NBPERFEVENTS; e++) {
+                fds[e] = open(static_cast<PerfEvent>(e));
+            }
+        }
+
+        ~ThreadCounters() {
+            for (int fd : fds) {
+                if (fd >= 0) {
+                    close(fd);
+                }
+            }
+        }
+
+        // Current values, scaled up when the kernel multiplexed the counters
+        void read(PerfSample& sample) const {
+            for (int e = 0; e < NBPERFEVENTS; e++) {
+                uint64_t values[3]; // value, time enabled, time running
+                if (fds[e] < 0 || ::read(fds[e], values, sizeof(values)) != sizeof(values)) {
+                    sample.values[e] = 0;
+                    continue;
+                }
+                sample.values[e] = values[2] > 0 ? values[0] * (static_cast<double>(values[1]) / values[2]) : 0;
+            }
+        }
+};
+
+static ThreadCounters& threadCounters() {
+    thread_local ThreadCounters counters;
+    return counters;
+}
+
+PerfScope::PerfScope(PerfProfile* profile, const char* phase) : profile{profile}, phase{phase} {
+    if (profile != nullptr && profile->isEnabled()) {
+        threadCounters().read(start);
+    }
+}
+
+PerfScope::~PerfScope() {
+    if (profile == nullptr || !profile->isEnabled()) {
+        return;
+    }
+    PerfSample end;
+    threadCounters().read(end);
+    for (int e = 0; e < NBPERFEVENTS; e++) {
+        end.values[e] -= start.values[e];
+    }
+    end.hashes = hashes;
+    end.probes = probes;
+    profile->add(phase, end);
+}
+
+void PerfProfile::add(const char* phase, const PerfSample& sample) {
+    const unsigned thread = threadCounters().index;
+    std::lock_guard<std::mutex> lock(mutex);
+    for (Phase& known : phases) {
+        if (known.name == phase) {
+            known.threads[thread] += sample;
+            return;
+        }
+    }
+    phases.push_back({phase, {{thread, sample}}});
+}
+
+// Prints the ratios of sample that its counters allow
+static void printSample(std::ostream& stream, const PerfSample& sample, unsigned available) {
+    auto has = [&](PerfEvent event) { return (available & (1u << event)) != 0; };
+    const double* values = sample.values;
+    const char* separator = "";
+    auto next = [&]() -> std::ostream& {
+        stream << separator;
+        separator = ", ";
+        return stream;
+    };
+
+    stream << std::setprecision(3);
+    if (has(PERF_TASKCLOCK)) {
+        next() << values[PERF_TASKCLOCK] / 1e9 << " s of CPU";
+        if (sample.hashes > 0 && values[PERF_TASKCLOCK] > 0) {
+            stream << " (" << sample.hashes / (values[PERF_TASKCLOCK] / 1e9) << " hashes/s)";
+        }
+    }
+    if (has(PERF_CYCLES) && has(PERF_INSTRUCTIONS) && values[PERF_CYCLES] > 0) {
+        next() << "IPC " << values[PERF_INSTRUCTIONS] / values[PERF_CYCLES];
+    }
+    for (PerfEvent event : {PERF_CYCLES, PERF_LLCMISSES, PERF_BRANCHMISSES, PERF_DTLBMISSES}) {
+        if (!has(event)) {
+            continue;
+        }
+        next() << values[event] << " " << EVENTNAMES[event];
+        if (sample.hashes > 0 && sample.probes > 0) {
+            stream << " (" << values[event] / sample.hashes << "/hash, " << values[event] / sample.probes << "/probe)";
+        } else if (sample.hashes > 0) {
+            stream << " (" << values[event] / sample.hashes << "/hash)";
+        } else if (sample.probes > 0) {
+            stream << " (" << values[event] / sample.probes << "/probe)";
+        }
+    }
+}
+
+void PerfProfile::print(std::ostream& stream) const {
+    if (!enabled) {
+        return;
+    }
+    const unsigned unavailable = unavailableEvents.load();
+    const unsigned available = ((1u << NBPERFEVENTS) - 1) & ~unavailable;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    const std::streamsize precision = stream.precision();
+    stream << "Performance counters:" << std::endl;
+    if (unavailable != 0) {
+        stream << "  not available on this host (" << std::strerror(firstError.load()) << "):";
+        for (int e = 0; e < NBPERFEVENTS; e++) {
+            if (unavailable & (1u << e)) {
+                stream << " " << EVENTNAMES[e];
+            }
+        }
+        stream << std::endl << "  (check /proc/sys/kernel/perf_event_paranoid, or the PMU of the virtual machine)" << std::endl;
+    }
+    for (const Phase& phase : phases) {
+        PerfSample total;
+        for (const auto& thread : phase.threads) {
+            total += thread.second;
+        }
+        stream << "  " << phase.name;
+        if (total.hashes > 0 || total.probes > 0) {
+            stream << " (" << total.hashes << " hashes, " << total.probes << " probes)";
+        }
+        stream << ": ";
+        printSample(stream, total, available);
+        stream << std::endl;
+        if (phase.threads.size() > 1) {
+            for (const auto& thread : phase.threads) {
+                stream << "    thread " << thread.first << ": ";
+                printSample(stream, thread.second, available);
+                stream << std::endl;
+            }
+        }
+    }
+    stream.precision(precision);
+}
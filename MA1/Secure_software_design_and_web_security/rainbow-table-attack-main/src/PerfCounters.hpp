@@ -0,0 +1,98 @@
+#ifndef PERFCOUNTERS_HPP
+#define PERFCOUNTERS_HPP
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <cstdint>
+
+/**
+ * Hardware performance counters of the phases of a run, read with Linux perf_event_open.
+ * <p>
+ * A PerfScope counts the cycles, instructions, last-level cache misses,
+ * branch misses and dTLB misses of the calling thread from its construction
+ * to its destruction. It adds them to a phase of a PerfProfile, with the
+ * hashes and table probes done meanwhile. The profile prints, per phase and
+ * per thread, the IPC and the misses per hash and per probe: a hash-bound run
+ * has a high IPC and few misses per probe, a probe-bound one stalls on LLC and
+ * dTLB misses.
+ * <p>
+ * The counters the kernel refuses (perf_event_paranoid, containers, virtual
+ * machines without a PMU) are left out of the summary. The task clock, a
+ * software counter, is nearly always there.
+ */
+
+enum PerfEvent {
+    PERF_TASKCLOCK,
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_LLCMISSES,
+    PERF_BRANCHMISSES,
+    PERF_DTLBMISSES,
+    NBPERFEVENTS
+};
+
+struct PerfSample {
+    double values[NBPERFEVENTS] = {};
+    uint64_t hashes = 0;
+    uint64_t probes = 0;
+
+    PerfSample& operator+=(const PerfSample& other) {
+        for (int e = 0; e < NBPERFEVENTS; e++) {
+            values[e] += other.values[e];
+        }
+        hashes += other.hashes;
+        probes += other.probes;
+        return *this;
+    }
+};
+
+class PerfProfile {
+    private:
+        struct Phase {
+            std::string name;
+            std::map<unsigned, PerfSample> threads;
+        };
+
+        bool enabled;
+        mutable std::mutex mutex;
+        std::vector<Phase> phases; // in the order they were first recorded
+
+    public:
+        explicit PerfProfile(bool enabled) : enabled{enabled} {}
+
+        bool isEnabled() const { return enabled; }
+
+        // Adds sample to phase, for the calling thread
+        void add(const char* phase, const PerfSample& sample);
+
+        // Prints the counters of every phase, for all threads and for each of them
+        void print(std::ostream& stream) const;
+};
+
+class PerfScope {
+    private:
+        PerfProfile* profile;
+        const char* phase;
+        PerfSample start;
+        uint64_t hashes = 0;
+        uint64_t probes = 0;
+
+    public:
+        // Does nothing if profile is null or disabled
+        PerfScope(PerfProfile* profile, const char* phase);
+        ~PerfScope();
+
+        PerfScope(const PerfScope&) = delete;
+        PerfScope& operator=(const PerfScope&) = delete;
+
+        // Counts work done in the scope, the misses are reported per hash and per probe
+        void addWork(uint64_t nbHashes, uint64_t nbProbes) {
+            hashes += nbHashes;
+            probes += nbProbes;
+        }
+};
+
+#endif // PERFCOUNTERS_HPP
@@ -0,0 +1,328 @@
+#include "Potfile.hpp"
+
+#include <stdexcept>
+#include <cstring>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static const char POTFILE_MAGIC[8] = {'R', 'T', 'P', 'O', 'T', '0', '1', '\0'};
+static const uint64_t POTFILE_INITIAL_CAPACITY = 1024;
+static const size_t POTFILE_READSIZE = 1 << 20;
+
+// Lock on the log, shared (LOCK_SH) or exclusive (LOCK_EX) between processes (flock), held by this thread (mutex)
+class Potfile::FileLock {
+    std::lock_guard<std::mutex> guard;
+    int fd;
+
+    public:
+        explicit FileLock(Potfile& potfile, int operation = LOCK_EX) : guard{potfile.mutex}, fd{potfile.logFd} {
+            if (flock(fd, operation) != 0) {
+                throw std::runtime_error("Could not lock the potfile");
+            }
+        }
+
+        ~FileLock() {
+            flock(fd, LOCK_UN);
+        }
+};
+
+Potfile::Potfile(const std::string& path)
+    : logPath{path}, indexPath{path + ".idx"}, logFd{-1}, indexFd{-1}, indexInode{0},
+      header{nullptr}, slots{nullptr}, mappedSize{0} {
+    logFd = open(logPath.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (logFd < 0) {
+        throw std::runtime_error("Could not open the potfile " + logPath);
+    }
+
+    FileLock lock(*this);
+    openIndex();
+    sync();
+}
+
+Potfile::~Potfile() {
+    closeIndex();
+    if (logFd >= 0) {
+        close(logFd);
+    }
+}
+
+bool Potfile::find(const unsigned char* digest, std::string& password) {
+    {
+        // Readers only share the lock: the index is up to date unless another process replaced it
+        FileLock lock(*this, LOCK_SH);
+        if (!header->replaced) {
+            return lookup(digest, password);
+        }
+    }
+    FileLock lock(*this);
+    sync();
+    return lookup(digest, password);
+}
+
+bool Potfile::lookup(const unsigned char* digest, std::string& password) {
+    const Slot* slot = findSlot(digest);
+    if (!slot->used) {
+        return false;
+    }
+    password.assign(slot->password, slot->length);
+    return true;
+}
+
+void Potfile::add(const unsigned char* digest, const char* password, size_t length) {
+    FileLock lock(*this);
+    sync();
+
+    if (findSlot(digest)->used) {
+        return;
+    }
+
+    // sync indexed every complete line: what is left past logSize is the fragment of a writer that crashed
+    // mid-line, cut it off or the new line would be glued to it
+    struct stat st;
+    if (fstat(logFd, &st) != 0
+        || (static_cast<uint64_t>(st.st_size) > header->logSize && ftruncate(logFd, header->logSize) != 0)) {
+        throw std::runtime_error("Could not truncate the potfile " + logPath);
+    }
+
+    // One write per line: with O_APPEND, lines of concurrent writers never interleave
+    std::string line(HEXDIGESTSIZE, ' ');
+    digestToHex(digest, &line[0]);
+    line += ':';
+    line.append(password, length);
+    line += '\n';
+    if (write(logFd, line.data(), line.size()) != static_cast<ssize_t>(line.size()) || fstat(logFd, &st) != 0) {
+        throw std::runtime_error("Could not append to the potfile " + logPath);
+    }
+
+    insert(digest, password, length, st.st_size);
+}
+
+size_t Potfile::size() {
+    FileLock lock(*this);
+    sync();
+    return header->count;
+}
+
+void Potfile::openIndex() {
+    indexFd = open(indexPath.c_str(), O_RDWR | O_CREAT, 0644);
+    if (indexFd < 0) {
+        throw std::runtime_error("Could not open the potfile index " + indexPath);
+    }
+
+    struct stat st;
+    if (fstat(indexFd, &st) != 0) {
+        close(indexFd);
+        indexFd = -1;
+        throw std::runtime_error("Could not read the potfile index " + indexPath);
+    }
+
+    Header onDisk;
+    bool valid = static_cast<size_t>(st.st_size) >= sizeof(Header)
+        && pread(indexFd, &onDisk, sizeof(Header), 0) == sizeof(Header)
+        && std::memcmp(onDisk.magic, POTFILE_MAGIC, sizeof(POTFILE_MAGIC)) == 0
+        && static_cast<uint64_t>(st.st_size) == sizeof(Header) + onDisk.capacity * sizeof(Slot);
+
+    if (!valid) {
+        // missing or damaged: start from an empty index, the log is replayed into it
+        close(indexFd);
+        indexFd = -1;
+        createIndex(indexPath + ".tmp", POTFILE_INITIAL_CAPACITY);
+        if (rename((indexPath + ".tmp").c_str(), indexPath.c_str()) != 0) {
+            throw std::runtime_error("Could not replace the potfile index " + indexPath);
+        }
+        indexFd = open(indexPath.c_str(), O_RDWR, 0644);
+        if (indexFd < 0) {
+            throw std::runtime_error("Could not open the potfile index " + indexPath);
+        }
+        if (fstat(indexFd, &st) != 0) {
+            close(indexFd);
+            indexFd = -1;
+            throw std::runtime_error("Could not read the potfile index " + indexPath);
+        }
+    }
+
+    mappedSize = st.st_size;
+    void* mapping = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, indexFd, 0);
+    if (mapping == MAP_FAILED) {
+        close(indexFd);
+        indexFd = -1;
+        throw std::runtime_error("Could not map the potfile index " + indexPath);
+    }
+    header = static_cast<Header*>(mapping);
+    slots = reinterpret_cast<Slot*>(static_cast<char*>(mapping) + sizeof(Header));
+    indexInode = st.st_ino;
+}
+
+void Potfile::closeIndex() {
+    if (header != nullptr) {
+        munmap(header, mappedSize);
+        header = nullptr;
+        slots = nullptr;
+    }
+    if (indexFd >= 0) {
+        close(indexFd);
+        indexFd = -1;
+    }
+}
+
+void Potfile::createIndex(const std::string& path, uint64_t capacity) {
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Could not create the potfile index " + path);
+    }
+
+    Header empty{};
+    std::memcpy(empty.magic, POTFILE_MAGIC, sizeof(POTFILE_MAGIC));
+    empty.capacity = capacity;
+
+    // ftruncate zero-fills the slots
+    if (ftruncate(fd, sizeof(Header) + capacity * sizeof(Slot)) != 0
+        || pwrite(fd, &empty, sizeof(Header), 0) != sizeof(Header)) {
+        close(fd);
+        throw std::runtime_error("Could not create the potfile index " + path);
+    }
+    close(fd);
+}
+
+void Potfile::sync() {
+    struct stat st;
+    if (stat(indexPath.c_str(), &st) != 0 || st.st_ino != indexInode) {
+        closeIndex();
+        openIndex();
+    }
+
+    if (fstat(logFd, &st) != 0) {
+        throw std::runtime_error("Could not read the potfile " + logPath);
+    }
+    const uint64_t logEnd = st.st_size;
+    if (header->logSize > logEnd) {
+        // the log was truncated behind our back: index it again from scratch
+        header->replaced = 1;
+        closeIndex();
+        unlink(indexPath.c_str());
+        openIndex();
+    }
+    if (header->logSize < logEnd) {
+        replayLog(header->logSize, logEnd);
+    }
+}
+
+void Potfile::replayLog(uint64_t from, uint64_t to) {
+    std::vector<char> buffer(POTFILE_READSIZE);
+    std::string pending;
+    uint64_t offset = from;
+    unsigned char digest[DIGESTSIZE];
+
+    while (offset < to) {
+        size_t toRead = std::min<uint64_t>(buffer.size(), to - offset);
+        ssize_t nbRead = pread(logFd, buffer.data(), toRead, offset);
+        if (nbRead <= 0) {
+            break;
+        }
+        offset += nbRead;
+        pending.append(buffer.data(), nbRead);
+
+        size_t start = 0;
+        size_t end;
+        while ((end = pending.find('\n', start)) != std::string::npos) {
+            // logSize of the line is the offset right after its '\n'
+            const uint64_t lineEnd = offset - (pending.size() - end - 1);
+            const char* line = pending.data() + start;
+            size_t length = end - start;
+            if (length > HEXDIGESTSIZE && line[HEXDIGESTSIZE] == ':' && hexToDigest(line, HEXDIGESTSIZE, digest)) {
+                insert(digest, line + HEXDIGESTSIZE + 1, length - HEXDIGESTSIZE - 1, lineEnd);
+            } else {
+                header->logSize = lineEnd;
+            }
+            start = end + 1;
+        }
+        pending.erase(0, start);
+    }
+    // an unterminated last line is a write in progress or a crash: it is read again next time
+}
+
+Potfile::Slot* Potfile::findSlot(const unsigned char* digest) {
+    // digests are uniformly distributed, their first bytes are a good enough hash
+    uint64_t h;
+    std::memcpy(&h, digest, sizeof(h));
+    const uint64_t mask = header->capacity - 1;
+
+    for (h &= mask; slots[h].used && std::memcmp(slots[h].digest, digest, DIGESTSIZE) != 0; h = (h + 1) & mask) {}
+    return &slots[h];
+}
+
+void Potfile::insert(const unsigned char* digest, const char* password, size_t length, uint64_t logSize) {
+    if (length <= MAXPASSWORDSIZE) {
+        if (2 * (header->count + 1) > header->capacity) {
+            grow();
+        }
+        Slot* slot = findSlot(digest);
+        if (!slot->used) {
+            std::memcpy(slot->digest, digest, DIGESTSIZE);
+            std::memcpy(slot->password, password, length);
+            slot->length = length;
+            slot->used = 1;
+            header->count++;
+        }
+    }
+    header->logSize = logSize;
+}
+
+void Potfile::grow() {
+    // Build the bigger index aside, then replace the old one: other processes notice the
+    // new inode and remap it
+    const std::string tmpPath = indexPath + ".tmp";
+    const uint64_t oldCapacity = header->capacity;
+    createIndex(tmpPath, 2 * oldCapacity);
+
+    // The old index stays in use until the new one is mapped
+    const int fd = open(tmpPath.c_str(), O_RDWR);
+    if (fd < 0) {
+        throw std::runtime_error("Could not grow the potfile index " + indexPath);
+    }
+    const size_t size = sizeof(Header) + 2 * oldCapacity * sizeof(Slot);
+    void* mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED) {
+        close(fd);
+        throw std::runtime_error("Could not grow the potfile index " + indexPath);
+    }
+
+    Slot* oldSlots = slots;
+    Header* oldHeader = header;
+    size_t oldSize = mappedSize;
+    int oldFd = indexFd;
+
+    indexFd = fd;
+    mappedSize = size;
+    header = static_cast<Header*>(mapping);
+    slots = reinterpret_cast<Slot*>(static_cast<char*>(mapping) + sizeof(Header));
+
+    for (uint64_t i = 0; i < oldCapacity; i++) {
+        if (oldSlots[i].used) {
+            *findSlot(oldSlots[i].digest) = oldSlots[i];
+        }
+    }
+    header->count = oldHeader->count;
+    header->logSize = oldHeader->logSize;
+
+    struct stat st;
+    if (rename(tmpPath.c_str(), indexPath.c_str()) != 0 || fstat(indexFd, &st) != 0) {
+        // the old index is still the one on disk: keep using it
+        closeIndex();
+        header = oldHeader;
+        slots = oldSlots;
+        mappedSize = oldSize;
+        indexFd = oldFd;
+        throw std::runtime_error("Could not replace the potfile index " + indexPath);
+    }
+    indexInode = st.st_ino;
+
+    // the readers mapping the old index remap the new one on their next lookup
+    oldHeader->replaced = 1;
+    munmap(oldHeader, oldSize);
+    close(oldFd);
+}
@@ -0,0 +1,87 @@
+#ifndef POTFILE_HPP
+#define POTFILE_HPP
+
+#include <string>
+#include <mutex>
+#include <cstdint>
+#include <sys/types.h>
+
+#include "Chain.hpp"
+
+/**
+ * Persistent cache of the passwords already cracked, shared by every run.
+ * <p>
+ * The passwords are kept in an append-only log of "hash:password" lines (the
+ * source of truth), and in an index file next to it: an open-addressing hash
+ * table keyed by the binary digest, mapped in memory, so that a lookup costs
+ * O(1). Both files are only modified under an exclusive lock on the log, and
+ * read under a shared one, so several cracking processes can share the same
+ * potfile. When it is opened and before each add, the index catches up with
+ * the lines appended to the log since it was last updated. An index replaced
+ * by another process growing it is marked as such, and remapped by the next
+ * access.
+ */
+class Potfile {
+    public:
+        static const unsigned MAXPASSWORDSIZE = 30;
+
+    private:
+        struct Header {
+            char magic[8];
+            uint64_t capacity; // number of slots, a power of 2
+            uint64_t count;    // number of used slots
+            uint64_t logSize;  // bytes of the log already in the index
+            uint64_t replaced; // 1 once another index file took its place
+            uint64_t reserved[3];
+        };
+
+        struct Slot {
+            unsigned char digest[DIGESTSIZE];
+            uint8_t used;
+            uint8_t length;
+            char password[MAXPASSWORDSIZE];
+        };
+
+        std::string logPath;
+        std::string indexPath;
+        int logFd;
+        int indexFd;
+        ino_t indexInode;
+        Header* header;
+        Slot* slots;
+        size_t mappedSize;
+        std::mutex mutex;
+
+        class FileLock;
+
+        void openIndex();
+        void closeIndex();
+        void createIndex(const std::string& path, uint64_t capacity);
+
+        // Remaps the index if it was replaced and indexes the end of the log
+        void sync();
+        void replayLog(uint64_t from, uint64_t to);
+
+        Slot* findSlot(const unsigned char* digest);
+        bool lookup(const unsigned char* digest, std::string& password);
+        void insert(const unsigned char* digest, const char* password, size_t length, uint64_t logSize);
+        void grow();
+
+    public:
+        // Opens (or creates) the log at path and its index at path + ".idx"
+        explicit Potfile(const std::string& path);
+        ~Potfile();
+
+        Potfile(const Potfile&) = delete;
+        Potfile& operator=(const Potfile&) = delete;
+
+        // Returns true and sets password if digest was already cracked
+        bool find(const unsigned char* digest, std::string& password);
+
+        // Records a cracked password, visible to every process sharing the potfile
+        void add(const unsigned char* digest, const char* password, size_t length);
+
+        size_t size();
+};
+
+#endif // POTFILE_HPP
@@ -0,0 +1,439 @@
+#include "Rainbow.hpp"
+
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+#include <utility>
+#include <cstdio>
+#include <filesystem>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "BatchCracker.hpp"
+#include "SerialCracker.hpp"
+#include "Instantiate.hpp"
+#include "HashPolicy.hpp"
+#include "Charset.hpp"
+#include "Trace.hpp"
+
+namespace rainbow {
+
+static void checkPasswordLength(unsigned passwordLength, CharsetKind charset) {
+    if (passwordLength < MINPASSWORDLENGTH || passwordLength > charsetMaxLength(charset)) {
+        throw std::invalid_argument("Unsupported password length: " + std::to_string(passwordLength)
+                                    + " (" + charsetName(charset) + ")");
+    }
+}
+
+const char* hashName(HashAlgorithm hash) {
+    switch (hash) {
+        case SHA256: return "sha256";
+        case SHA1: return "sha1";
+        case MD5: return "md5";
+        case NTLM: return "ntlm";
+    }
+    throw std::invalid_argument("Unknown hash algorithm");
+}
+
+unsigned hashDigestSize(HashAlgorithm hash) {
+    switch (hash) {
+        case SHA256: return Sha256Policy::DIGESTSIZE;
+        case SHA1: return Sha1Policy::DIGESTSIZE;
+        case MD5: return Md5Policy::DIGESTSIZE;
+        case NTLM: return NtlmPolicy::DIGESTSIZE;
+    }
+    throw std::invalid_argument("Unknown hash algorithm");
+}
+
+bool parseHashName(const std::string& name, HashAlgorithm& hash) {
+    for (HashAlgorithm candidate : {SHA256, SHA1, MD5, NTLM}) {
+        if (name == hashName(candidate)) {
+            hash = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* charsetName(CharsetKind charset) {
+    switch (charset) {
+        case LOWERCASE: return "lowercase";
+        case DIGITS: return "digits";
+        case ALNUM: return "alnum";
+        case PRINTABLE: return "printable";
+    }
+    throw std::invalid_argument("Unknown charset");
+}
+
+unsigned charsetSize(CharsetKind charset) {
+    switch (charset) {
+        case LOWERCASE: return LowercaseCharset::SIZE;
+        case DIGITS: return DigitsCharset::SIZE;
+        case ALNUM: return AlnumCharset::SIZE;
+        case PRINTABLE: return PrintableCharset::SIZE;
+    }
+    throw std::invalid_argument("Unknown charset");
+}
+
+unsigned charsetMaxLength(CharsetKind charset) {
+    switch (charset) {
+        case LOWERCASE: return LowercaseCharset::MAXLENGTH;
+        case DIGITS: return DigitsCharset::MAXLENGTH;
+        case ALNUM: return AlnumCharset::MAXLENGTH;
+        case PRINTABLE: return PrintableCharset::MAXLENGTH;
+    }
+    throw std::invalid_argument("Unknown charset");
+}
+
+bool parseCharsetName(const std::string& name, CharsetKind& charset) {
+    for (CharsetKind candidate : {LOWERCASE, DIGITS, ALNUM, PRINTABLE}) {
+        if (name == charsetName(candidate)) {
+            charset = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+char charsetSymbol(CharsetKind charset, unsigned index) {
+    switch (charset) {
+        case LOWERCASE: return LowercaseCharset::symbol(index);
+        case DIGITS: return DigitsCharset::symbol(index);
+        case ALNUM: return AlnumCharset::symbol(index);
+        case PRINTABLE: return PrintableCharset::symbol(index);
+    }
+    throw std::invalid_argument("Unknown charset");
+}
+
+uint64_t encodePassword(const char* password, unsigned length, CharsetKind charset) {
+    switch (charset) {
+        case LOWERCASE: return LowercaseCharset::encode(password, length);
+        case DIGITS: return DigitsCharset::encode(password, length);
+        case ALNUM: return AlnumCharset::encode(password, length);
+        case PRINTABLE: return PrintableCharset::encode(password, length);
+    }
+    throw std::invalid_argument("Unknown charset");
+}
+
+MappedTable::MappedTable(const std::string& path, unsigned passwordLength, int chainLength, HashAlgorithm hash,
+                         CharsetKind charset)
+    : mapping{nullptr}, mappedSize{0} {
+    TRACE_ZONE("map table");
+    checkPasswordLength(passwordLength, charset);
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Could not open the table " + path);
+    }
+    struct stat status;
+    if (fstat(fd, &status) != 0 || status.st_size % sizeof(Entry) != 0) {
+        close(fd);
+        throw std::runtime_error("Not a table file: " + path);
+    }
+
+    mappedSize = status.st_size;
+    if (mappedSize > 0) {
+        mapping = mmap(nullptr, mappedSize, PROT_READ, MAP_SHARED, fd, 0);
+        if (mapping == MAP_FAILED) {
+            close(fd);
+            throw std::runtime_error("Could not map the table " + path);
+        }
+        // the lookups are random accesses all over the table: start reading it in now
+        madvise(mapping, mappedSize, MADV_WILLNEED);
+    }
+    close(fd);
+
+    tableView.entries = Span<const Entry>(static_cast<const Entry*>(mapping), mappedSize / sizeof(Entry));
+    tableView.passwordLength = passwordLength;
+    tableView.chainLength = chainLength;
+    tableView.hash = hash;
+    tableView.charset = charset;
+}
+
+MappedTable::~MappedTable() {
+    if (mapping != nullptr) {
+        munmap(mapping, mappedSize);
+    }
+}
+
+MappedTable::MappedTable(MappedTable&& other) noexcept
+    : mapping{std::exchange(other.mapping, nullptr)}, mappedSize{std::exchange(other.mappedSize, 0)},
+      tableView{other.tableView} {
+    other.tableView.entries = Span<const Entry>();
+}
+
+MappedTable& MappedTable::operator=(MappedTable&& other) noexcept {
+    if (this != &other) {
+        if (mapping != nullptr) {
+            munmap(mapping, mappedSize);
+        }
+        mapping = std::exchange(other.mapping, nullptr);
+        mappedSize = std::exchange(other.mappedSize, 0);
+        tableView = other.tableView;
+        other.tableView.entries = Span<const Entry>();
+    }
+    return *this;
+}
+
+template<unsigned PASSWDLENGTH, class Hash, class Charset>
+static size_t crackWith(const TableView& table, Span<const Digest> digests, Span<Result> results,
+                        const std::atomic<bool>& keepRunning, CrackStatistics* statistics) {
+    using Cracker = BatchCracker<PASSWDLENGTH, Hash, Charset>;
+    using Target = typename Cracker::Target;
+
+    Cracker cracker(table.entries.data(), table.entries.size(), table.chainLength);
+    Target targets[Cracker::BATCHSIZE];
+    Target* batch[Cracker::BATCHSIZE];
+    bool cracked[Cracker::BATCHSIZE];
+    size_t nbCracked = 0;
+
+    for (size_t first = 0; first < digests.size() && keepRunning.load(); first += Cracker::BATCHSIZE) {
+        TRACE_ZONE("crack batch");
+        unsigned count = std::min<size_t>(Cracker::BATCHSIZE, digests.size() - first);
+        for (unsigned k = 0; k < count; k++) {
+            std::memcpy(targets[k].digest, digests[first + k].bytes, DIGESTSIZE);
+            targets[k].idx = first + k;
+            batch[k] = &targets[k];
+        }
+
+        nbCracked += cracker.crackBatch(batch, count, cracked, keepRunning);
+        for (unsigned k = 0; k < count; k++) {
+            Result& result = results[first + k];
+            result.length = cracked[k] ? PASSWDLENGTH : 0;
+            if (cracked[k]) {
+                std::memcpy(result.password, targets[k].password, PASSWDLENGTH);
+            }
+        }
+    }
+
+    if (statistics != nullptr) {
+        *statistics += cracker.statistics();
+    }
+    return nbCracked;
+}
+
+template<unsigned PASSWDLENGTH, class Hash, class Charset>
+static size_t crackSerialWith(const TableView& table, Span<const Digest> digests, Span<Result> results,
+                              const std::atomic<bool>& keepRunning, CrackStatistics* statistics) {
+    SerialCracker<PASSWDLENGTH, Hash, Charset> cracker(table.entries.data(), table.entries.size(), table.chainLength);
+    size_t nbCracked = 0;
+    for (size_t idx = 0; idx < digests.size() && keepRunning.load(); idx++) {
+        if (cracker.crack(digests[idx].bytes, results[idx].password, keepRunning)) {
+            results[idx].length = PASSWDLENGTH;
+            nbCracked++;
+        }
+    }
+
+    if (statistics != nullptr) {
+        *statistics += cracker.statistics();
+    }
+    return nbCracked;
+}
+
+template<unsigned PASSWDLENGTH, class Hash, class Charset>
+static size_t crackColumnWith(const TableView& table, int column, Span<const Digest> digests, Span<Result> results,
+                              CrackStatistics* statistics) {
+    using Cracker = BatchCracker<PASSWDLENGTH, Hash, Charset>;
+    using Target = typename Cracker::Target;
+
+    Cracker cracker(table.entries.data(), table.entries.size(), table.chainLength);
+    Target targets[Cracker::BATCHSIZE];
+    Target* batch[Cracker::BATCHSIZE];
+    bool cracked[Cracker::BATCHSIZE];
+    size_t nbCracked = 0;
+
+    for (size_t first = 0; first < digests.size(); first += Cracker::BATCHSIZE) {
+        unsigned count = std::min<size_t>(Cracker::BATCHSIZE, digests.size() - first);
+        for (unsigned k = 0; k < count; k++) {
+            std::memcpy(targets[k].digest, digests[first + k].bytes, DIGESTSIZE);
+            targets[k].idx = first + k;
+            batch[k] = &targets[k];
+        }
+
+        nbCracked += cracker.crackColumn(batch, count, column, cracked);
+        for (unsigned k = 0; k < count; k++) {
+            if (cracked[k]) {
+                results[first + k].length = PASSWDLENGTH;
+                std::memcpy(results[first + k].password, targets[k].password, PASSWDLENGTH);
+            }
+        }
+    }
+
+    if (statistics != nullptr) {
+        *statistics += cracker.statistics();
+    }
+    return nbCracked;
+}
+
+// Checks the sizes and clears results before a crack of table
+static void startCrack(const TableView& table, Span<const Digest> digests, Span<Result> results) {
+    if (digests.size() != results.size()) {
+        throw std::invalid_argument("digests and results must have the same size");
+    }
+    checkPasswordLength(table.passwordLength, table.charset);
+    for (Result& result : results) {
+        result.length = 0;
+    }
+}
+
+size_t crack(const TableView& table, Span<const Digest> digests, Span<Result> results,
+             const std::atomic<bool>& keepRunning, CrackStatistics* statistics) {
+    startCrack(table, digests, results);
+    return dispatchEngine(table.hash, table.charset, table.passwordLength, [&](auto length, auto hash, auto charset) {
+        return crackWith<decltype(length)::value, decltype(hash), decltype(charset)>(table, digests, results,
+                                                                                    keepRunning, statistics);
+    });
+}
+
+size_t crackSerial(const TableView& table, Span<const Digest> digests, Span<Result> results,
+                   const std::atomic<bool>& keepRunning, CrackStatistics* statistics) {
+    startCrack(table, digests, results);
+    return dispatchEngine(table.hash, table.charset, table.passwordLength, [&](auto length, auto hash, auto charset) {
+        return crackSerialWith<decltype(length)::value, decltype(hash), decltype(charset)>(table, digests, results,
+                                                                                          keepRunning, statistics);
+    });
+}
+
+size_t crackColumn(const TableView& table, int column, Span<const Digest> digests, Span<Result> results,
+                   CrackStatistics* statistics) {
+    startCrack(table, digests, results);
+    if (column < 0 || column > table.chainLength) {
+        throw std::invalid_argument("No column " + std::to_string(column) + " in chains of " + std::to_string(table.chainLength)
+                                    + " reductions");
+    }
+    return dispatchEngine(table.hash, table.charset, table.passwordLength, [&](auto length, auto hash, auto charset) {
+        return crackColumnWith<decltype(length)::value, decltype(hash), decltype(charset)>(table, column, digests, results,
+                                                                                          statistics);
+    });
+}
+
+size_t crack(Span<const TableView> tables, Span<const Digest> digests, Span<Result> results,
+             const std::atomic<bool>& keepRunning, CrackStatistics* statistics) {
+    if (digests.size() != results.size()) {
+        throw std::invalid_argument("digests and results must have the same size");
+    }
+    for (size_t i = 1; i < tables.size(); i++) {
+        if (tables[i].hash != tables[0].hash) {
+            throw std::invalid_argument("The tables must all be of the same hash: table " + std::to_string(i) + " is "
+                                        + hashName(tables[i].hash) + ", table 0 is " + hashName(tables[0].hash));
+        }
+    }
+    for (Result& result : results) {
+        result.length = 0;
+    }
+
+    // Small chunks, so that the pending digests of a chunk fit on the stack
+    static const size_t CHUNKSIZE = 64;
+    Digest pending[CHUNKSIZE];
+    Result found[CHUNKSIZE];
+    size_t slots[CHUNKSIZE];
+    size_t nbCracked = 0;
+
+    for (size_t first = 0; first < digests.size(); first += CHUNKSIZE) {
+        const size_t count = std::min(CHUNKSIZE, digests.size() - first);
+        for (const TableView& table : tables) {
+            if (!keepRunning.load()) {
+                return nbCracked;
+            }
+            size_t nbPending = 0;
+            for (size_t k = first; k < first + count; k++) {
+                if (results[k].length == 0) {
+                    pending[nbPending] = digests[k];
+                    slots[nbPending++] = k;
+                }
+            }
+            if (nbPending == 0) {
+                break;
+            }
+            nbCracked += crack(table, Span<const Digest>(pending, nbPending), Span<Result>(found, nbPending), keepRunning,
+                                statistics);
+            for (size_t j = 0; j < nbPending; j++) {
+                if (found[j].length > 0) {
+                    results[slots[j]] = found[j];
+                }
+            }
+        }
+    }
+    return nbCracked;
+}
+
+// Parses the name of a table file, rainbowTable-[<hash>-][<charset>-]<length>-<chain length>-...
+static bool parseTableName(const std::string& name, HashAlgorithm& hash, CharsetKind& charset, unsigned& length,
+                           int& chainLength) {
+    static const std::string prefix = "rainbowTable-";
+    if (name.compare(0, prefix.size(), prefix) != 0) {
+        return false;
+    }
+    size_t position = prefix.size();
+    size_t dash = name.find('-', position);
+    hash = SHA256;
+    if (dash != std::string::npos && parseHashName(name.substr(position, dash - position), hash)) {
+        position = dash + 1;
+        dash = name.find('-', position);
+    }
+    charset = ALNUM;
+    if (dash != std::string::npos && parseCharsetName(name.substr(position, dash - position), charset)) {
+        position = dash + 1;
+    }
+    int nbParsed = 0;
+    return std::sscanf(name.c_str() + position, "%u-%d-%n", &length, &chainLength, &nbParsed) == 2 && nbParsed > 0;
+}
+
+std::vector<MappedTable> openTables(const std::string& directory, unsigned passwordLength, int chainLength,
+                                    HashAlgorithm hash, CharsetKind charset) {
+    TRACE_ZONE("open tables");
+    std::error_code ec;
+    std::filesystem::directory_iterator it(directory, ec);
+    if (ec) {
+        throw std::runtime_error("Could not read the table directory " + directory);
+    }
+
+    std::vector<MappedTable> tables;
+    for (const auto& entry : it) {
+        const std::string name = entry.path().filename().string();
+        HashAlgorithm tableHash;
+        CharsetKind tableCharset;
+        unsigned length;
+        int nbReduction;
+        if (!parseTableName(name, tableHash, tableCharset, length, nbReduction)
+            || entry.path().extension() != ".bin" || !entry.is_regular_file() || tableHash != hash || tableCharset != charset) {
+            continue;
+        }
+        if (length < MINPASSWORDLENGTH || length > charsetMaxLength(charset)
+            || (passwordLength != 0 && length != passwordLength) || (chainLength != 0 && nbReduction != chainLength)) {
+            continue;
+        }
+        tables.emplace_back(entry.path().string(), length, nbReduction, tableHash, tableCharset);
+    }
+
+    std::sort(tables.begin(), tables.end(), [](const MappedTable& a, const MappedTable& b) {
+        return a.view().chainLength < b.view().chainLength;
+    });
+    return tables;
+}
+
+template<unsigned PASSWDLENGTH, class Hash, class Charset>
+static void generateWith(int chainLength, Span<const uint64_t> heads, Span<uint64_t> tails) {
+    using Cracker = BatchCracker<PASSWDLENGTH, Hash, Charset>;
+
+    Cracker cracker(chainLength);
+    for (size_t first = 0; first < heads.size(); first += Cracker::BATCHSIZE) {
+        unsigned count = std::min<size_t>(Cracker::BATCHSIZE, heads.size() - first);
+        cracker.generateChains(heads.data() + first, count, tails.data() + first);
+    }
+}
+
+void generateChains(unsigned passwordLength, int chainLength, Span<const uint64_t> heads, Span<uint64_t> tails,
+                    HashAlgorithm hash, CharsetKind charset) {
+    if (heads.size() != tails.size()) {
+        throw std::invalid_argument("heads and tails must have the same size");
+    }
+    checkPasswordLength(passwordLength, charset);
+    dispatchEngine(hash, charset, passwordLength, [&](auto length, auto policy, auto charsetPolicy) {
+        generateWith<decltype(length)::value, decltype(policy), decltype(charsetPolicy)>(chainLength, heads, tails);
+    });
+}
+
+} // namespace rainbow
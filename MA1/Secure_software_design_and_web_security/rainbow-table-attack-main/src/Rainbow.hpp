@@ -0,0 +1,195 @@
+#ifndef RAINBOW_HPP
+#define RAINBOW_HPP
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+#include "Chain.hpp"
+
+/**
+ * Public API of librainbow, to crack hashes and generate chains in-process.
+ * <p>
+ * Tables are opened with MappedTable (the file is mapped, not read), or viewed
+ * from memory with TableView. The batch functions take caller-provided input
+ * and output buffers and do not allocate: their working buffers are on the
+ * stack. They can be called from several threads at once on the same table.
+ */
+namespace rainbow {
+
+static const unsigned MINPASSWORDLENGTH = 1;
+static const unsigned MAXPASSWORDLENGTH = 12; // the maximum of each charset is given by charsetMaxLength
+
+// Hash function a table was generated for
+enum HashAlgorithm {
+    SHA256,
+    SHA1,
+    MD5,
+    NTLM
+};
+
+// Name of the algorithm, as in table file names and on the command line ("sha256", "sha1", "md5", "ntlm")
+const char* hashName(HashAlgorithm hash);
+
+// Size in bytes of the digests of the algorithm
+unsigned hashDigestSize(HashAlgorithm hash);
+
+// Sets hash to the algorithm of this name and returns true, or returns false if the name is unknown
+bool parseHashName(const std::string& name, HashAlgorithm& hash);
+
+// Charset of the passwords of a table
+enum CharsetKind {
+    LOWERCASE, // a-z
+    DIGITS,    // 0-9
+    ALNUM,     // a-z, A-Z and 0-9
+    PRINTABLE  // printable ASCII, space included
+};
+
+// Name of the charset, as in table file names and on the command line ("lowercase", "digits", "alnum", "printable")
+const char* charsetName(CharsetKind charset);
+
+// Number of chars of the charset
+unsigned charsetSize(CharsetKind charset);
+
+// Longest password of the charset that a table can hold
+unsigned charsetMaxLength(CharsetKind charset);
+
+// Sets charset to the charset of this name and returns true, or returns false if the name is unknown
+bool parseCharsetName(const std::string& name, CharsetKind& charset);
+
+// Char of the charset at index (< charsetSize), in the order of the reduction
+char charsetSymbol(CharsetKind charset, unsigned index);
+
+// Packs the length chars of password, which must all be in the charset, as table files store them
+uint64_t encodePassword(const char* password, unsigned length, CharsetKind charset = ALNUM);
+
+// (head, tail) of a chain, 6-bit encoded, as stored in table files
+using Entry = std::pair<uint64_t, uint64_t>;
+
+// Digests shorter than SHA-256 use the first bytes, the others are 0
+struct Digest {
+    unsigned char bytes[DIGESTSIZE];
+};
+
+struct Result {
+    uint8_t length; // 0 if the digest was not cracked
+    char password[MAXPASSWORDLENGTH];
+};
+
+// Non-owning view of a contiguous array (std::span is C++20)
+template<class T>
+class Span {
+    private:
+        T* first;
+        size_t count;
+
+    public:
+        Span() : first{nullptr}, count{0} {}
+
+        Span(T* data, size_t size) : first{data}, count{size} {}
+
+        template<class U>
+        Span(std::vector<U>& vector) : first{vector.data()}, count{vector.size()} {}
+
+        template<class U>
+        Span(const std::vector<U>& vector) : first{vector.data()}, count{vector.size()} {}
+
+        T* data() const { return first; }
+        size_t size() const { return count; }
+        bool empty() const { return count == 0; }
+        T& operator[](size_t idx) const { return first[idx]; }
+        T* begin() const { return first; }
+        T* end() const { return first + count; }
+
+        Span subspan(size_t offset, size_t size) const { return Span(first + offset, size); }
+};
+
+// A table in memory, sorted by tails, with the parameters it was generated with
+struct TableView {
+    Span<const Entry> entries;
+    unsigned passwordLength;
+    int chainLength;
+    HashAlgorithm hash = SHA256;
+    CharsetKind charset = ALNUM;
+};
+
+// A table file mapped read-only in memory
+class MappedTable {
+    private:
+        void* mapping;
+        size_t mappedSize;
+        TableView tableView;
+
+    public:
+        // Throws std::runtime_error if the file cannot be mapped or is not a table file,
+        // std::invalid_argument if passwordLength is not supported by the charset
+        MappedTable(const std::string& path, unsigned passwordLength, int chainLength, HashAlgorithm hash = SHA256,
+                    CharsetKind charset = ALNUM);
+        ~MappedTable();
+
+        MappedTable(const MappedTable&) = delete;
+        MappedTable& operator=(const MappedTable&) = delete;
+
+        MappedTable(MappedTable&& other) noexcept;
+        MappedTable& operator=(MappedTable&& other) noexcept;
+
+        const TableView& view() const { return tableView; }
+        size_t size() const { return tableView.entries.size(); }
+};
+
+// Maps every table of hash and charset in directory named like generate_table names them
+// (rainbowTable-[<hash>-][<charset>-]<length>-<chain length>-...bin, the hash omitted for SHA-256 and the charset
+// for alnum), keeping those of passwordLength and chainLength only when they are not 0. The tables with the shortest
+// chains, the cheapest to search, come first. Throws std::runtime_error if the directory cannot be read.
+std::vector<MappedTable> openTables(const std::string& directory, unsigned passwordLength = 0, int chainLength = 0,
+                                    HashAlgorithm hash = SHA256, CharsetKind charset = ALNUM);
+
+// Work done by crack, added up over the calls that are given the same statistics
+struct CrackStatistics {
+    uint64_t lookups = 0;     // endpoints searched in a table, one per digest and column walked
+    uint64_t alarms = 0;      // endpoints found in a table, whose chain was regenerated
+    uint64_t falseAlarms = 0; // alarms whose chain did not hold the password
+    uint64_t hashes = 0;      // hashes computed, by the walks and the regenerations
+
+    CrackStatistics& operator+=(const CrackStatistics& other) {
+        lookups += other.lookups;
+        alarms += other.alarms;
+        falseAlarms += other.falseAlarms;
+        hashes += other.hashes;
+        return *this;
+    }
+};
+
+// Cracks every digest against table, results[i] being the result of digests[i], until keepRunning
+// is cleared. digests and results must have the same size. Returns the number of digests cracked.
+// The work done is added to statistics, when given.
+size_t crack(const TableView& table, Span<const Digest> digests, Span<Result> results,
+             const std::atomic<bool>& keepRunning, CrackStatistics* statistics = nullptr);
+
+// Same as crack, with the serial engine: one digest at a time, one column after the other, with the scalar hash.
+// Slower than crack, it is the reference crack is checked against.
+size_t crackSerial(const TableView& table, Span<const Digest> digests, Span<Result> results,
+                   const std::atomic<bool>& keepRunning, CrackStatistics* statistics = nullptr);
+
+// Walks every digest from column to the end of the chains and checks the matching chains, without trying the other
+// columns: for callers that sweep the columns themselves, cheapest first, across all their digests. results[i] is the
+// result of digests[i]. Returns the number of digests cracked. The work done is added to statistics, when given.
+size_t crackColumn(const TableView& table, int column, Span<const Digest> digests, Span<Result> results,
+                   CrackStatistics* statistics = nullptr);
+
+// Cracks every digest against each table in turn, skipping the digests cracked by a previous table,
+// so that tables of several password lengths can be searched at once. results[i] is the result of digests[i].
+// The tables must all be of the same hash, and may be of different charsets: throws std::invalid_argument otherwise.
+size_t crack(Span<const TableView> tables, Span<const Digest> digests, Span<Result> results,
+             const std::atomic<bool>& keepRunning, CrackStatistics* statistics = nullptr);
+
+// Writes in tails[i] the encoded tail of the chain of the encoded head heads[i].
+// heads and tails must have the same size.
+void generateChains(unsigned passwordLength, int chainLength, Span<const uint64_t> heads, Span<uint64_t> tails,
+                    HashAlgorithm hash = SHA256, CharsetKind charset = ALNUM);
+
+} // namespace rainbow
+
+#endif // RAINBOW_HPP
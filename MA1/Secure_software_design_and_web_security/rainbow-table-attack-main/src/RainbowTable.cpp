@@ -1,7 +1,8 @@
 #include "RainbowTable.hpp"
 #include "../utils/passwd-utils.hpp"
-#include "../utils/6bits-encoder.hpp"
 #include "../utils/sha256.h"
+#include "Rainbow.hpp"
+#include "Trace.hpp"
 
 std::atomic<bool> stopFlag(false);
 
@@ -10,139 +11,130 @@ void signalHandler(int signum) {
 }
 
 
-template<unsigned PASSWDLENGTH>
-void RainbowTable<PASSWDLENGTH>::generate() {
+void RainbowTable::generate() {
     timer.start();
 
     const unsigned int nbThreads = std::thread::hardware_concurrency();
 
-    std::cout << "number of threads : " << nbThreads << std::endl;
-
-    std::vector<std::thread> threads;
-    threads.reserve(nbThreads);
-
-    unsigned int maxDataSizePerThread = maxEntries / nbThreads;
+    std::cout << "number of threads : " << nbThreads << ", " << placement.describe() << std::endl;
 
+    // Consecutive workers share a node, and parallel_for gives each worker a contiguous part of the table: the
+    // chains a worker writes first land in its local memory, but for the few a worker steals at the end
+    ThreadPool pool(nbThreads, true, [this](unsigned index) { placement.pin(index); });
 
     // Register signal handler
     std::signal(SIGINT, signalHandler);
 
 
-    for (unsigned int i = 0; i < nbThreads; i++) {
-        unsigned int startIdx = i * maxDataSizePerThread;
-        unsigned int endIdx = (i == nbThreads - 1) ? maxEntries : startIdx + maxDataSizePerThread;
-        threads.emplace_back(std::thread(RainbowTable::generateRainbowTable, this, maxDataSizePerThread, startIdx, endIdx));
-    }
+    telemetry.reset(new GenerationTelemetry(nbThreads, maxEntries, settings.reportInterval, settings.metricsPath));
+    telemetry->start();
 
-    for(long unsigned int i = 0 ; i < threads.size() ; i++){
-		threads[i].join();
-	}
+    pool.parallel_for(0, std::max(maxEntries, 0), CHAINSPERTASK, [this](size_t startIdx, size_t endIdx) {
+        generateRainbowTable(this, ThreadPool::worker_index(), startIdx, endIdx);
+    });
+    telemetry->stop();
 
-    std::cout << "\nCreated rainbow table in " << timer.elapsedTime() << " seconds" << std::endl;
+    std::cout << "Created rainbow table in " << timer.elapsedTime() << " seconds (" << region.describe() << ")" << std::endl;
     timer.reset();
     timer.start();
 
     std::cout << "Sorting table..." << std::endl;
-    sortTable();
+    sortTable(pool);
     std::cout << "Table sorted in " << timer.elapsedTime() << " seconds" << std::endl;
 
     timer.reset();
     timer.start();
 
     saveTabletoFile();
+    telemetry->record(stopFlag ? "incomplete" : "saved");
 }
 
-template<unsigned PASSWDLENGTH>
-void RainbowTable<PASSWDLENGTH>::generateRainbowTable(void* instance, unsigned int maxDataSize, unsigned int startIdx, unsigned int endIdx) {
+void RainbowTable::generateRainbowTable(void* instance, unsigned int threadIdx, unsigned int startIdx, unsigned int endIdx) {
     RainbowTable* rainbowTable = static_cast<RainbowTable*>(instance);
+    GenerationTelemetry::ThreadCounters& counters = rainbowTable->telemetry->thread(threadIdx);
+    PerfScope perfCounters(rainbowTable->settings.profile, "generate");
 
-    StaticString<HASHSIZE> hash;
-
-    StaticString<PASSWDLENGTH+1> tail;
-    StaticString<PASSWDLENGTH+1> head;
-
-    // Assignment needed to avoid getting random
-    // values from memory that raise exceptions
-    tail = rainbowTable->generate_passwd(PASSWDLENGTH);
+    // Chains are generated GENERATIONBATCH at a time by librainbow
+    uint64_t heads[GENERATIONBATCH];
+    uint64_t tails[GENERATIONBATCH];
+    char password[rainbow::MAXPASSWORDLENGTH];
 
-    int lastDisplayedProgress = 0;
-    double totalTime = 0.0;
-    int progressCount = 0;
-    float progress;
-    Timer progressTimer;
-    progressTimer.start();
-
-    for (unsigned int idx = startIdx; idx < endIdx; idx++) {
+    for (unsigned int idx = startIdx; idx < endIdx; idx += GENERATIONBATCH) {
         if (stopFlag) {
             break;
         }
+        TRACE_ZONE("generate batch");
 
-        head = rainbowTable->generate_passwd(PASSWDLENGTH);
-        rainbowTable->generateChain(head, tail, hash);
-        rainbowTable->table[idx] = std::make_pair(encodeStringToUint64(head.c_str()), encodeStringToUint64(tail.c_str()));
-        
-        progress = ((float)(idx - startIdx) / (float)(endIdx - startIdx)) * 100;
-
-        if (progress - lastDisplayedProgress >= 1.0) {
-            progressTimer.stop();
-            double elapsed = progressTimer.elapsedTime();
-            totalTime += elapsed;
-            progressCount++;
-            double averageTime = totalTime / progressCount;
-
-            // Get current time of day
-            auto now = std::chrono::system_clock::now();
-            auto now_time_t = std::chrono::system_clock::to_time_t(now);
-            auto now_tm = *std::localtime(&now_time_t);
-
-            std::cout << "\r[" <<std::put_time(&now_tm, "%H:%M:%S") << "]" 
-                    << "Progress: " << std::fixed << std::setprecision(2) << progress 
-                    << "%, Average Time per 1%: " << averageTime << " seconds. " << std::flush;
-
-            lastDisplayedProgress = progress;
-            progressTimer.reset();
-            progressTimer.start();
+        const unsigned int count = std::min(GENERATIONBATCH, endIdx - idx);
+        for (unsigned int k = 0; k < count; k++) {
+            rainbowTable->generate_passwd(password);
+            heads[k] = rainbow::encodePassword(password, rainbowTable->passwordLength, rainbowTable->charset);
+        }
+        rainbow::generateChains(rainbowTable->passwordLength, rainbowTable->chainLength, rainbow::Span<const uint64_t>(heads, count),
+                                rainbow::Span<uint64_t>(tails, count), rainbowTable->hash, rainbowTable->charset);
+        for (unsigned int k = 0; k < count; k++) {
+            rainbowTable->table[idx + k] = std::make_pair(heads[k], tails[k]);
         }
-    }
-}
 
-template<unsigned PASSWDLENGTH>
-void RainbowTable<PASSWDLENGTH>::generateChain(const StaticString<PASSWDLENGTH+1> &head, StaticString<PASSWDLENGTH+1> &tail, StaticString<HASHSIZE> &hash) {
-    hash = sha256(head.c_str());
-    for (int i=0; i < chainLength; i++) {
-        reduction(hash, i, tail);
-        hash = sha256(tail.c_str());
+        // A chain is chainLength + 1 hashes
+        counters.add(count, static_cast<uint64_t>(count) * (rainbowTable->chainLength + 1));
+        perfCounters.addWork(static_cast<uint64_t>(count) * (rainbowTable->chainLength + 1), 0);
     }
-    reduction(hash, chainLength, tail);
 }
 
-template<unsigned PASSWDLENGTH>
-void RainbowTable<PASSWDLENGTH>::reduction(const StaticString<HASHSIZE> &hash, const int position, StaticString<PASSWDLENGTH+1> &reduced) {
-    int index = 0;
+void RainbowTable::sortTable(ThreadPool& pool) {
+    TRACE_ZONE("sort table");
+    PerfScope perfCounters(settings.profile, "sort");
+    auto byTail = [](const std::pair<uint64_t, uint64_t>& a, const std::pair<uint64_t, uint64_t>& b) {
+        return a.second < b.second;
+    };
 
-    for (unsigned i = 0; i < PASSWDLENGTH; i++) {
-        index = static_cast<int>((((hash[i] ^ position) + hash[i + 3] + hash[i + 5] + hash[i + 7] + hash[i + 9] + hash[i + 17] + position) % 62));
-        reduced[i] = charset[index];
+    // One run per worker, on the part of the table it generated
+    const size_t nbRuns = pool.size();
+    std::vector<size_t> bounds(nbRuns + 1);
+    for (size_t run = 0; run <= nbRuns; run++) {
+        bounds[run] = table.size() * run / nbRuns;
     }
-}
-
-template<unsigned PASSWDLENGTH>
-void RainbowTable<PASSWDLENGTH>::sortTable() {
-    std::sort(table.begin(), table.end(), [](const std::pair<uint64_t, uint64_t>& a, const std::pair<uint64_t, uint64_t>& b) {
-        return a.second < b.second;
+    pool.parallel_for(0, nbRuns, 1, [&](size_t first, size_t last) {
+        for (size_t run = first; run < last; run++) {
+            std::sort(table.begin() + bounds[run], table.begin() + bounds[run + 1], byTail);
+        }
     });
+
+    // Runs [run, run + width) and [run + width, run + 2 * width) are merged, for width = 1, 2, 4...
+    for (size_t width = 1; width < nbRuns; width *= 2) {
+        pool.parallel_for(0, (nbRuns + 2 * width - 1) / (2 * width), 1, [&](size_t first, size_t last) {
+            for (size_t pair = first; pair < last; pair++) {
+                const size_t run = 2 * width * pair;
+                if (run + width < nbRuns) {
+                    std::inplace_merge(table.begin() + bounds[run], table.begin() + bounds[run + width],
+                                       table.begin() + bounds[std::min(run + 2 * width, nbRuns)], byTail);
+                }
+            }
+        });
+    }
 }
 
-template<unsigned PASSWDLENGTH>
-void RainbowTable<PASSWDLENGTH>::saveTabletoFile() {
+void RainbowTable::saveTabletoFile() {
+    TRACE_ZONE("save table");
+    PerfScope perfCounters(settings.profile, "save");
     // Format fileSizeGB to 4 decimal places
     std::ostringstream fileSizeStream;
     fileSizeStream << std::fixed << std::setprecision(3) << fileSizeGB;
     std::string fileSizeStr = fileSizeStream.str();
 
-    std::string filename = "output/rainbowTable-" + std::to_string(PASSWDLENGTH) + "-" + std::to_string(chainLength) + "-" + fileSizeStr + ".bin";
+    // SHA-256 alnum tables keep their historical name, the others are prefixed with the name of their hash
+    // and of their charset
+    std::string prefix = "output/rainbowTable-";
+    if (hash != rainbow::SHA256) {
+        prefix += std::string(rainbow::hashName(hash)) + "-";
+    }
+    if (charset != rainbow::ALNUM) {
+        prefix += std::string(rainbow::charsetName(charset)) + "-";
+    }
+    std::string filename = prefix + std::to_string(passwordLength) + "-" + std::to_string(chainLength) + "-" + fileSizeStr + ".bin";
     if(stopFlag) {
-        filename = "output/rainbowTable-" + std::to_string(PASSWDLENGTH) + "-" + std::to_string(chainLength) + "-" + fileSizeStr + "-incomplete.bin";
+        filename = prefix + std::to_string(passwordLength) + "-" + std::to_string(chainLength) + "-" + fileSizeStr + "-incomplete.bin";
     }
 
     timer.reset();
@@ -170,22 +162,12 @@ void RainbowTable<PASSWDLENGTH>::saveTabletoFile() {
 
     std::cout << "data stored in " << timer.elapsedTime() << " seconds" << std::endl;
     std::cout << "Number of head/tail: " << table.size() - collision << " | collisions: " << collision << std::endl;
+    telemetry->addCollisions(collision);
 }
 
-template<unsigned PASSWDLENGTH>
-std::string RainbowTable<PASSWDLENGTH>::generate_passwd(int length)
+void RainbowTable::generate_passwd(char* password)
 {
-	char str[length + 1];
-	for(int i = 0; i < length; i++)
-		str[i] = charset[rainbow::random(0, charsetSize - 1)];
-	str[length] = '\0';
-
-	return std::string(str);
+	const int size = rainbow::charsetSize(charset);
+	for(unsigned i = 0; i < passwordLength; i++)
+		password[i] = rainbow::charsetSymbol(charset, rainbow::random(0, size - 1));
 }
-
-
-template class RainbowTable<6>;
-template class RainbowTable<7>;
-template class RainbowTable<8>;
-template class RainbowTable<9>;
-template class RainbowTable<10>;
@@ -11,45 +11,81 @@
 #include <csignal>
 #include <execution>
 #include <stdexcept>
+#include <memory>
 
 #include "./Timer.hpp"
+#include "GenerationTelemetry.hpp"
+#include "PerfCounters.hpp"
+#include "Numa.hpp"
+#include "HugePages.hpp"
+#include "../misc/threadpool.hpp"
 #include "../utils/staticstring.hpp"
+#include "Rainbow.hpp"
 
 
-static const std::string charset = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
-static const int charsetSize = charset.size();
-
 static const unsigned HASHSIZE = 65;
 const size_t bytesPerGB = 1e9;
 
-template<unsigned PASSWDLENGTH>
+// How a table is generated, besides its size and its chain length
+struct GenerationSettings {
+    double reportInterval = 5.0;       // seconds between two progress reports
+    std::string metricsPath;           // file the reports are appended to as JSON lines, none if empty
+    PerfProfile* profile = nullptr;    // hardware counters of the phases, none if null
+    Affinity affinity = AFFINITY_NODE; // how the generation threads are pinned
+    HugePages hugePages = HUGEPAGES_OFF; // pages backing the table while it is generated and sorted
+};
+
+// A table being generated. The hash, the charset and the password length are given at run time: librainbow
+// generates the chains, the sort and the save do not depend on them.
 class RainbowTable{
     private:
+        unsigned passwordLength;
+        rainbow::HashAlgorithm hash;
+        rainbow::CharsetKind charset;
         float fileSizeGB;
         int chainLength;
-        std::vector<std::pair<uint64_t, uint64_t>> table;
+        // Each page is placed on the node of the thread that generates its chains
+        PageRegion region;
+        rainbow::Span<std::pair<uint64_t, uint64_t>> table;
         Timer timer;
         int maxEntries;
+        GenerationSettings settings;
+        ThreadPlacement placement;
+        std::unique_ptr<GenerationTelemetry> telemetry;
+
+        // Number of chains generated at once by a thread
+        static constexpr unsigned int GENERATIONBATCH = 64;
+        // Number of chains a worker takes from the table at once
+        static constexpr unsigned int CHAINSPERTASK = 1 << 14;
     public:
-        RainbowTable(float fileSizeGB, int chainLength) : fileSizeGB{fileSizeGB}, chainLength{chainLength} {
+        // Throws std::invalid_argument if passwordLength is not supported by the charset
+        RainbowTable(unsigned passwordLength, rainbow::HashAlgorithm hash, rainbow::CharsetKind charset, float fileSizeGB,
+                     int chainLength, const GenerationSettings& settings = GenerationSettings())
+            : passwordLength{passwordLength}, hash{hash}, charset{charset}, fileSizeGB{fileSizeGB}, chainLength{chainLength},
+              settings{settings}, placement{settings.affinity} {
+            if (passwordLength < rainbow::MINPASSWORDLENGTH || passwordLength > rainbow::charsetMaxLength(charset)) {
+                throw std::invalid_argument("Unsupported password length: " + std::to_string(passwordLength)
+                                            + " (" + rainbow::charsetName(charset) + ")");
+            }
             maxEntries = (fileSizeGB * bytesPerGB) / (2*sizeof(uint64_t));
             std::cout << "Generating rainbow table with " << maxEntries << " entries" << std::endl;
-            table.resize(maxEntries);
+            // Not touched here: the pages are only allocated when the generation threads write them
+            region = PageRegion(std::max(maxEntries, 0) * sizeof(table[0]), settings.hugePages);
+            table = rainbow::Span<std::pair<uint64_t, uint64_t>>(static_cast<std::pair<uint64_t, uint64_t>*>(region.data()),
+                                                                 std::max(maxEntries, 0));
         }
 
         void generate();
 
-        static void generateRainbowTable(void* instance, unsigned int maxDataSize, unsigned int startIdx, unsigned int endIdx);
-        
-        void generateChain(const StaticString<PASSWDLENGTH+1> &head, StaticString<PASSWDLENGTH+1> &tail, StaticString<HASHSIZE> &hash);
-
-        void reduction(const StaticString<HASHSIZE> &hash, const int position, StaticString<PASSWDLENGTH+1> &reduced);
+        static void generateRainbowTable(void* instance, unsigned int threadIdx, unsigned int startIdx, unsigned int endIdx);
 
-        void sortTable();
+        // Sorts runs of the table on the workers of pool, then merges them pairwise
+        void sortTable(ThreadPool& pool);
 
         void saveTabletoFile();
 
-        std::string generate_passwd(int length);
+        // Writes passwordLength random symbols of the charset to password
+        void generate_passwd(char* password);
 };
 
 #endif // RAINBOWTABLE_HPPzz
\ No newline at end of file
@@ -0,0 +1,64 @@
+#include "SerialCracker.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include "Instantiate.hpp"
+#include "Trace.hpp"
+
+
+template<unsigned PASSWDLENGTH, class Hash, class Charset>
+void SerialCracker<PASSWDLENGTH, Hash, Charset>::hashReduced() {
+    Hash::hashBatch(reduced, PASSWDLENGTH, PASSWDLENGTH, 1, digest);
+    digestToHex(digest, hash, Hash::DIGESTSIZE);
+}
+
+template<unsigned PASSWDLENGTH, class Hash, class Charset>
+void SerialCracker<PASSWDLENGTH, Hash, Charset>::regenerate(uint64_t head, int column) {
+    Charset::decode(head, PASSWDLENGTH, reduced);
+    for (int i = 0; i < column; i++) {
+        hashReduced();
+        reduceHex<PASSWDLENGTH, Charset>(hash, i, reduced);
+    }
+    counters.hashes += column + 1;
+}
+
+template<unsigned PASSWDLENGTH, class Hash, class Charset>
+bool SerialCracker<PASSWDLENGTH, Hash, Charset>::crack(const unsigned char* target, char* password,
+                                                       const std::atomic<bool>& keepRunning) {
+    TRACE_ZONE("crack hash (serial)");
+    const unsigned hexSize = 2 * Hash::DIGESTSIZE;
+    digestToHex(target, targetHash, Hash::DIGESTSIZE);
+
+    for (int column = chainLength; 0 <= column && keepRunning.load(); column--) {
+        std::memcpy(hash, targetHash, hexSize);
+        for (int i = column; i < chainLength; i++) {
+            reduceHex<PASSWDLENGTH, Charset>(hash, i, reduced);
+            hashReduced();
+        }
+        reduceHex<PASSWDLENGTH, Charset>(hash, chainLength, reduced);
+        counters.lookups++;
+        counters.hashes += chainLength - column;
+
+        const uint64_t endpoint = Charset::encode(reduced, PASSWDLENGTH);
+        const Entry* match = std::lower_bound(entries, entries + nbEntries, endpoint, [](const Entry& entry, uint64_t value) {
+            return entry.second < value;
+        });
+        if (match == entries + nbEntries || match->second != endpoint) {
+            continue;
+        }
+
+        counters.alarms++;
+        regenerate(match->first, column);
+        Hash::hashBatch(reduced, PASSWDLENGTH, PASSWDLENGTH, 1, digest);
+        if (std::memcmp(digest, target, Hash::DIGESTSIZE) == 0) {
+            std::memcpy(password, reduced, PASSWDLENGTH);
+            return true;
+        }
+        counters.falseAlarms++;
+    }
+    return false;
+}
+
+
+INSTANTIATE_ENGINE(SerialCracker)
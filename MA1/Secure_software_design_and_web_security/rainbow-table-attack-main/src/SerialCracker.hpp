@@ -0,0 +1,57 @@
+#ifndef SERIALCRACKER_HPP
+#define SERIALCRACKER_HPP
+
+#include <atomic>
+#include <cstdint>
+
+#include "Chain.hpp"
+#include "HashPolicy.hpp"
+#include "Charset.hpp"
+
+/**
+ * Lookup engine that cracks one target hash at a time.
+ * <p>
+ * For each column, from the last one down to column 0, the online chain of the
+ * target is walked to its end with the scalar hash, its endpoint searched in the
+ * table, and the chain of a matching entry regenerated from its head. Nothing is
+ * batched nor interleaved: it is the reference the batch engine is measured and
+ * checked against. Its buffers are members, a crack does not allocate.
+ */
+template<unsigned PASSWDLENGTH, class Hash = Sha256Policy, class Charset = AlnumCharset>
+class SerialCracker {
+    static_assert(1 <= PASSWDLENGTH && PASSWDLENGTH <= Charset::MAXLENGTH, "unsupported password length");
+
+    public:
+        using Entry = std::pair<uint64_t, uint64_t>;
+
+    private:
+        const Entry* entries;
+        size_t nbEntries;
+        int chainLength;
+
+        char targetHash[HEXDIGESTSIZE]; // hex digest of the target
+        char hash[HEXDIGESTSIZE];
+        char reduced[PASSWDLENGTH];
+        unsigned char digest[Hash::DIGESTSIZE];
+
+        rainbow::CrackStatistics counters;
+
+        // Hex digest of reduced, written to hash
+        void hashReduced();
+
+        // Walks the chain of the encoded head up to column, leaving the password found there in reduced
+        void regenerate(uint64_t head, int column);
+
+    public:
+        SerialCracker(const Entry* entries, size_t nbEntries, int chainLength)
+            : entries{entries}, nbEntries{nbEntries}, chainLength{chainLength} {}
+
+        // Cracks the digest (its first Hash::DIGESTSIZE bytes), from the last column down to column 0, until it is
+        // found or keepRunning is cleared. Returns true and fills in the PASSWDLENGTH chars of password if found.
+        bool crack(const unsigned char* target, char* password, const std::atomic<bool>& keepRunning);
+
+        // Work done since construction
+        const rainbow::CrackStatistics& statistics() const { return counters; }
+};
+
+#endif // SERIALCRACKER_HPP
@@ -0,0 +1,156 @@
+#include "TablePlanner.hpp"
+
+#include <cmath>
+#include <vector>
+#include <thread>
+#include <random>
+#include <algorithm>
+
+#include "Timer.hpp"
+
+double tableCoverage(double keyspace, double storedChains, int chainLength) {
+    // The chains of a file do not merge: each column holds storedChains distinct passwords
+    return -std::expm1((chainLength + 1) * std::log1p(-std::min(1.0, storedChains / keyspace)));
+}
+
+TableEstimate estimateTables(double keyspace, const TableSetting& setting) {
+    const double m = setting.nbChains;
+    const int t = setting.chainLength;
+
+    // Distinct passwords of each column, up to the tails, of the chains of one table and of all the tables
+    double column = m;
+    double allColumn = setting.nbTables * m;
+    double allMissed = 1.0;
+    for (int c = 0; c <= t; c++) {
+        allMissed *= 1.0 - std::min(1.0, allColumn / keyspace);
+        column = keyspace * -std::expm1(-column / keyspace);
+        allColumn = keyspace * -std::expm1(-allColumn / keyspace);
+    }
+    const double stored = std::min(column, m);
+
+    // Probability that a password is in a given column of a table, and that it is in the table
+    const double hit = std::min(1.0, stored / keyspace);
+    const double coverage = tableCoverage(keyspace, stored, t);
+
+    // Hashes to look up a hash in one table, from the last column to the first: the walk to the tail, then
+    // the chain regenerated from its head when the tail is in the table, whether it holds the password or not
+    double notFound = 1.0;
+    double tableHashes = 0.0;
+    double tableAlarms = 0.0;
+    for (int k = t; k >= 0; k--) {
+        const double merge = -std::expm1((t + 1 - k) * std::log1p(-hit)); // the walk runs into a stored chain
+        tableHashes += notFound * ((t - k) + (merge + hit) * (k + 1));
+        tableAlarms += notFound * merge;
+        notFound *= 1.0 - hit;
+    }
+
+    // The tables are searched in turn, until the hash is cracked
+    TableEstimate estimate;
+    estimate.crackHashes = 0.0;
+    estimate.falseAlarms = 0.0;
+    double missed = 1.0;
+    for (unsigned i = 0; i < setting.nbTables; i++) {
+        estimate.crackHashes += missed * tableHashes;
+        estimate.falseAlarms += missed * tableAlarms;
+        missed *= 1.0 - coverage;
+    }
+    // Tables of the same chain length share their reduction functions, so their chains can merge: the tables
+    // together cover no more than all their chains in a single table that keeps the merged chains
+    estimate.coverage = std::min(1.0 - missed, 1.0 - allMissed);
+    estimate.mergeRate = m > 0 ? 1.0 - stored / m : 0.0;
+    estimate.storedChains = stored;
+    estimate.generationHashes = setting.nbTables * m * (t + 1);
+    return estimate;
+}
+
+// Chains walked by the calibrations: long enough for the hashes to dominate the lookups
+static const int CALIBRATIONCHAINLENGTH = 100;
+static const size_t CALIBRATIONCHAINS = 1024;
+
+// Count random encoded passwords: each char is a code below charsetSize, packed as in the table files
+static std::vector<uint64_t> randomHeads(size_t count, unsigned passwordLength, rainbow::CharsetKind charset,
+                                         std::mt19937_64& generator) {
+    const unsigned size = rainbow::charsetSize(charset);
+    unsigned bits = 0;
+    while ((1u << bits) < size) {
+        bits++;
+    }
+    std::vector<uint64_t> heads(count, 0);
+    for (uint64_t& head : heads) {
+        for (unsigned i = 0; i < passwordLength; i++) {
+            head |= (generator() % size) << (bits * i);
+        }
+    }
+    return heads;
+}
+
+double measureGenerationRate(unsigned passwordLength, rainbow::HashAlgorithm hash, rainbow::CharsetKind charset,
+                             unsigned nbThreads, double seconds) {
+    std::vector<double> rates(nbThreads, 0.0);
+    std::vector<std::thread> threads;
+    for (unsigned i = 0; i < nbThreads; i++) {
+        threads.emplace_back([&, i]() {
+            std::mt19937_64 generator(i);
+            std::vector<uint64_t> heads = randomHeads(CALIBRATIONCHAINS, passwordLength, charset, generator);
+            std::vector<uint64_t> tails(CALIBRATIONCHAINS);
+            double nbHashes = 0;
+            Timer timer;
+            timer.start();
+            do {
+                rainbow::generateChains(passwordLength, CALIBRATIONCHAINLENGTH, heads, tails, hash, charset);
+                heads.swap(tails);
+                nbHashes += CALIBRATIONCHAINS * (CALIBRATIONCHAINLENGTH + 1.0);
+            } while (timer.elapsedTime() < seconds);
+            rates[i] = nbHashes / timer.elapsedTime();
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    double rate = 0.0;
+    for (double threadRate : rates) {
+        rate += threadRate;
+    }
+    return rate;
+}
+
+double measureCrackRate(unsigned passwordLength, rainbow::HashAlgorithm hash, rainbow::CharsetKind charset,
+                        double seconds) {
+    // A table small enough for the walks to rarely run into its chains, so that every hash is walked
+    // through all the columns; it stays in cache, which makes the lookups cheaper than in a large table
+    std::mt19937_64 generator(0);
+    const double keyspace = std::pow(static_cast<double>(rainbow::charsetSize(charset)), passwordLength);
+    const size_t nbChains = std::clamp<size_t>(keyspace / (16.0 * (CALIBRATIONCHAINLENGTH + 1)), 1, CALIBRATIONCHAINS);
+    std::vector<uint64_t> heads = randomHeads(nbChains, passwordLength, charset, generator);
+    std::vector<uint64_t> tails(nbChains);
+    rainbow::generateChains(passwordLength, CALIBRATIONCHAINLENGTH, heads, tails, hash, charset);
+    std::vector<rainbow::Entry> entries(nbChains);
+    for (size_t i = 0; i < nbChains; i++) {
+        entries[i] = {heads[i], tails[i]};
+    }
+    std::sort(entries.begin(), entries.end(), [](const rainbow::Entry& a, const rainbow::Entry& b) {
+        return a.second < b.second;
+    });
+    const rainbow::TableView table{rainbow::Span<const rainbow::Entry>(entries), passwordLength,
+                                   CALIBRATIONCHAINLENGTH, hash, charset};
+
+    // Random digests, almost surely of no password of the keyspace
+    std::vector<rainbow::Digest> digests(64);
+    for (auto& digest : digests) {
+        for (unsigned char& byte : digest.bytes) {
+            byte = static_cast<unsigned char>(generator());
+        }
+    }
+    std::vector<rainbow::Result> results(digests.size());
+    const std::atomic<bool> keepRunning(true);
+
+    const double walkHashes = CALIBRATIONCHAINLENGTH * (CALIBRATIONCHAINLENGTH + 1.0) / 2;
+    double nbHashes = 0;
+    Timer timer;
+    timer.start();
+    do {
+        rainbow::crack(table, digests, results, keepRunning);
+        nbHashes += digests.size() * walkHashes;
+    } while (timer.elapsedTime() < seconds);
+    return nbHashes / timer.elapsedTime();
+}
@@ -0,0 +1,50 @@
+#ifndef TABLEPLANNER_HPP
+#define TABLEPLANNER_HPP
+
+#include <cstdint>
+
+#include "Rainbow.hpp"
+
+/**
+ * Expected behaviour of tables before generating them.
+ * <p>
+ * The estimates follow the classical model of rainbow chains: a column of
+ * m_c distinct passwords maps to N(1 - exp(-m_c / N)) distinct passwords in
+ * the next column, N being the keyspace. generate_table.out drops the chains
+ * whose tail merged with another chain, so the chains left in a file do not
+ * overlap and each column holds as many distinct passwords as there are
+ * chains. The throughputs come from a short calibration on the local
+ * machine, with the engines of librainbow.
+ */
+
+// Parameters of a set of tables of the same length and chain length
+struct TableSetting {
+    double nbChains;    // chains generated per table (file size in bytes / 16)
+    int chainLength;    // number of reductions, as given to generate_table.out
+    unsigned nbTables;
+};
+
+struct TableEstimate {
+    double coverage;         // probability that a password of the keyspace is in one of the tables
+    double mergeRate;        // fraction of the generated chains dropped because their tail merged with another one
+    double storedChains;     // chains left in each table file
+    double generationHashes; // hashes to generate all the tables
+    double crackHashes;      // expected hashes to look up one hash in the tables, cracked or not
+    double falseAlarms;      // expected false alarms (chains regenerated in vain) per hash looked up
+};
+
+// Probability that a password of the keyspace is in a table file of storedChains chains of chainLength reductions
+double tableCoverage(double keyspace, double storedChains, int chainLength);
+
+// Estimates nbTables tables of the setting, generated by generate_table.out with a keyspace of keyspace passwords
+TableEstimate estimateTables(double keyspace, const TableSetting& setting);
+
+// Hashes per second of nbThreads threads generating chains, measured for about seconds
+double measureGenerationRate(unsigned passwordLength, rainbow::HashAlgorithm hash, rainbow::CharsetKind charset,
+                             unsigned nbThreads, double seconds);
+
+// Hashes per second of a thread looking up hashes that are not in a table, measured for about seconds
+double measureCrackRate(unsigned passwordLength, rainbow::HashAlgorithm hash, rainbow::CharsetKind charset,
+                        double seconds);
+
+#endif // TABLEPLANNER_HPP
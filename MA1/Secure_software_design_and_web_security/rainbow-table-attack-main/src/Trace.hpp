@@ -0,0 +1,157 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+/**
+ * Scoped trace zones, exported in the trace_event JSON format of Chrome
+ * (chrome://tracing, or https://ui.perfetto.dev).
+ * <p>
+ * TRACE_ZONE("name") records the time spent from there to the end of the
+ * enclosing block, on the calling thread. Each thread writes its zones to its
+ * own ring buffer, without locks: a buffer keeps the last RINGSIZE zones of
+ * its thread. TRACE_EXPORT("program") writes all the buffers to the file named
+ * by the RAINBOW_TRACE_FILE environment variable, or to program.trace.json.
+ * <p>
+ * The zones are only compiled with RAINBOW_TRACE defined (make TRACE=1),
+ * otherwise both macros expand to nothing. Zone names must be string literals.
+ */
+
+#ifdef RAINBOW_TRACE
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+namespace trace {
+
+// Zones kept per thread, the oldest ones are overwritten
+static constexpr size_t RINGSIZE = 1 << 16;
+
+struct Event {
+    const char* name;
+    uint64_t start;    // nanoseconds since the first zone of the process
+    uint64_t duration; // nanoseconds
+};
+
+// The ring buffer of one thread, only written by it
+struct ThreadBuffer {
+    unsigned tid;
+    std::atomic<uint64_t> count{0};
+    Event events[RINGSIZE];
+
+    void push(const Event& event) {
+        const uint64_t n = count.load(std::memory_order_relaxed);
+        events[n & (RINGSIZE - 1)] = event;
+        count.store(n + 1, std::memory_order_release);
+    }
+};
+
+class Registry {
+    private:
+        std::mutex mutex;
+        std::vector<std::unique_ptr<ThreadBuffer>> buffers; // kept after their thread exits
+        const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+    public:
+        static Registry& instance() {
+            static Registry registry;
+            return registry;
+        }
+
+        uint64_t now() const {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+        }
+
+        // The buffer of the calling thread, registered on its first zone
+        ThreadBuffer& local() {
+            thread_local ThreadBuffer* buffer = nullptr;
+            if (buffer == nullptr) {
+                std::lock_guard<std::mutex> lock(mutex);
+                buffers.emplace_back(new ThreadBuffer);
+                buffer = buffers.back().get();
+                buffer->tid = buffers.size() - 1;
+            }
+            return *buffer;
+        }
+
+        // Writes the zones recorded so far, returns the number of zones lost to the ring buffers
+        uint64_t write(std::ostream& stream) {
+            std::lock_guard<std::mutex> lock(mutex);
+            const long pid = getpid();
+            uint64_t lost = 0;
+            bool first = true;
+            stream << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+            for (const auto& buffer : buffers) {
+                stream << (first ? "\n" : ",\n") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": " << pid
+                       << ", \"tid\": " << buffer->tid << ", \"args\": {\"name\": \"thread " << buffer->tid << "\"}}";
+                first = false;
+                const uint64_t count = buffer->count.load(std::memory_order_acquire);
+                const uint64_t oldest = count > RINGSIZE ? count - RINGSIZE : 0;
+                lost += oldest;
+                for (uint64_t n = oldest; n < count; n++) {
+                    const Event& event = buffer->events[n & (RINGSIZE - 1)];
+                    stream << ",\n{\"name\": \"" << event.name << "\", \"cat\": \"rainbow\", \"ph\": \"X\", \"ts\": "
+                           << event.start / 1000.0 << ", \"dur\": " << event.duration / 1000.0 << ", \"pid\": " << pid
+                           << ", \"tid\": " << buffer->tid << "}";
+                }
+            }
+            stream << "\n]}\n";
+            return lost;
+        }
+};
+
+class Zone {
+    private:
+        const char* name;
+        uint64_t start;
+
+    public:
+        explicit Zone(const char* name) : name{name}, start{Registry::instance().now()} {}
+
+        ~Zone() {
+            Registry& registry = Registry::instance();
+            registry.local().push({name, start, registry.now() - start});
+        }
+
+        Zone(const Zone&) = delete;
+        Zone& operator=(const Zone&) = delete;
+};
+
+inline void exportTrace(const char* program) {
+    const char* variable = std::getenv("RAINBOW_TRACE_FILE");
+    const std::string path = variable != nullptr ? variable : std::string(program) + ".trace.json";
+    std::ofstream stream(path);
+    if (!stream.is_open()) {
+        std::cerr << "Could not write the trace to " << path << std::endl;
+        return;
+    }
+    const uint64_t lost = Registry::instance().write(stream);
+    std::cerr << "Trace written to " << path;
+    if (lost > 0) {
+        std::cerr << " (" << lost << " oldest zones overwritten)";
+    }
+    std::cerr << std::endl;
+}
+
+} // namespace trace
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_ZONE(name) ::trace::Zone TRACE_CONCAT(traceZone, __LINE__)(name)
+#define TRACE_EXPORT(program) ::trace::exportTrace(program)
+
+#else
+
+#define TRACE_ZONE(name) ((void)0)
+#define TRACE_EXPORT(program) ((void)0)
+
+#endif // RAINBOW_TRACE
+
+#endif // TRACE_HPP
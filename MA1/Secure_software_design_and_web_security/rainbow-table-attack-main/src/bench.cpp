@@ -0,0 +1,449 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <random>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "Benchmark.hpp"
+#include "Rainbow.hpp"
+#include "HashPolicy.hpp"
+#include "Charset.hpp"
+#include "Chain.hpp"
+#include "../utils/sha256.h"
+#include "../utils/6bits-encoder.hpp"
+#include "../misc/threadpool.hpp"
+
+using std::string;
+
+// Every operator new of the program, librainbow included, is counted: the benchmarks of the hot paths check that
+// they do not allocate in their steady state. They are not inlined: GCC would see the std::free of operator delete
+// release memory of operator new, and warn (-Wmismatched-new-delete).
+static std::atomic<uint64_t> heapAllocations(0);
+
+__attribute__((noinline)) void* operator new(size_t size) {
+    heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* pointer = std::malloc(size == 0 ? 1 : size)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void operator delete(void* pointer) noexcept {
+    std::free(pointer);
+}
+
+__attribute__((noinline)) void operator delete(void* pointer, size_t) noexcept {
+    std::free(pointer);
+}
+
+// Lengths of the per-length benchmarks: the ones of the historical alnum tables
+static const unsigned LENGTHS[] = {6, 7, 8, 9, 10};
+
+// Reductions of the chains of the chain and table benchmarks
+static const int CHAINLENGTH = 100;
+
+// Random encoded alnum passwords of length chars
+std::vector<uint64_t> randomHeads(size_t count, unsigned length, std::mt19937_64& generator) {
+    std::vector<uint64_t> heads(count);
+    char password[rainbow::MAXPASSWORDLENGTH];
+    for (uint64_t& head : heads) {
+        for (unsigned i = 0; i < length; i++) {
+            password[i] = AlnumCharset::symbol(generator() % AlnumCharset::SIZE);
+        }
+        head = AlnumCharset::encode(password, length);
+    }
+    return heads;
+}
+
+// A table of count chains of 6 alnum chars, sorted by tails, generated on nbThreads threads
+std::vector<rainbow::Entry> generateTable(const std::vector<uint64_t>& heads, unsigned nbThreads) {
+    std::vector<uint64_t> tails(heads.size());
+    std::vector<std::thread> threads;
+    const size_t slice = (heads.size() + nbThreads - 1) / nbThreads;
+    for (unsigned i = 0; i < nbThreads; i++) {
+        const size_t first = std::min(heads.size(), i * slice);
+        const size_t count = std::min(heads.size(), first + slice) - first;
+        threads.emplace_back([&, first, count]() {
+            rainbow::generateChains(6, CHAINLENGTH, rainbow::Span<const uint64_t>(heads.data() + first, count),
+                                    rainbow::Span<uint64_t>(tails.data() + first, count));
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    std::vector<rainbow::Entry> entries(heads.size());
+    for (size_t i = 0; i < heads.size(); i++) {
+        entries[i] = {heads[i], tails[i]};
+    }
+    std::sort(entries.begin(), entries.end(), [](const rainbow::Entry& a, const rainbow::Entry& b) {
+        return a.second < b.second;
+    });
+    return entries;
+}
+
+template<class Hash>
+void benchHashBatch(BenchmarkRunner& runner, unsigned length) {
+    static const unsigned COUNT = 64;
+    char messages[COUNT][rainbow::MAXPASSWORDLENGTH] = {};
+    unsigned char digests[COUNT * Hash::DIGESTSIZE];
+    runner.run("BM_HashBatch/" + string(rainbow::hashName(Hash::ALGORITHM)) + "/" + std::to_string(length), [&](uint64_t iterations) {
+        for (uint64_t n = 0; n < iterations; n++) {
+            messages[n % COUNT][0] = static_cast<char>(n);
+            Hash::hashBatch(&messages[0][0], rainbow::MAXPASSWORDLENGTH, length, COUNT, digests);
+            doNotOptimize(&digests[0]);
+        }
+        return iterations * COUNT;
+    }, 1, true);
+}
+
+void microBenchmarks(BenchmarkRunner& runner) {
+    for (unsigned length : LENGTHS) {
+        const string suffix = "/" + std::to_string(length);
+        char password[rainbow::MAXPASSWORDLENGTH + 1] = "aZ3kP9qW0x";
+
+        // The scalar SHA-256 of the first generators, one password at a time
+        runner.run("BM_Sha256" + suffix, [&](uint64_t iterations) {
+            for (uint64_t n = 0; n < iterations; n++) {
+                password[0] = 'a' + n % 26;
+                string hash = sha256(password, length);
+                doNotOptimize(hash);
+            }
+            return iterations;
+        });
+
+        benchHashBatch<Sha256Policy>(runner, length);
+        benchHashBatch<Sha1Policy>(runner, length);
+        benchHashBatch<Md5Policy>(runner, length);
+        benchHashBatch<NtlmPolicy>(runner, length);
+
+        dispatchLength<AlnumCharset::MAXLENGTH>(length, [&](auto passwordLength) {
+            char hash[HEXDIGESTSIZE + 1] = "5e884898da28047151d0e56f8dc6292773603d0d6aabbdd62a11ef721d1542d8";
+            char reduced[rainbow::MAXPASSWORDLENGTH];
+            runner.run("BM_Reduction" + suffix, [&](uint64_t iterations) {
+                for (uint64_t n = 0; n < iterations; n++) {
+                    reduceHex<decltype(passwordLength)::value, AlnumCharset>(hash, n % 1000, reduced);
+                    doNotOptimize(&reduced[0]);
+                }
+                return iterations;
+            }, 1, true);
+        });
+
+        runner.run("BM_EncodeStringToUint64" + suffix, [&](uint64_t iterations) {
+            uint64_t encoded = 0;
+            for (uint64_t n = 0; n < iterations; n++) {
+                password[0] = 'a' + n % 26;
+                encoded += encodeStringToUint64(password, length);
+            }
+            doNotOptimize(encoded);
+            return iterations;
+        }, 1, true);
+
+        runner.run("BM_DecodeUint64ToString" + suffix, [&](uint64_t iterations) {
+            uint64_t encoded[16];
+            for (unsigned k = 0; k < 16; k++) {
+                password[0] = 'a' + k;
+                encoded[k] = encodeStringToUint64(password, length);
+            }
+            char decoded[rainbow::MAXPASSWORDLENGTH];
+            for (uint64_t n = 0; n < iterations; n++) {
+                decodeUint64ToString(encoded[n & 15], length, decoded);
+                doNotOptimize(&decoded[0]);
+            }
+            return iterations;
+        }, 1, true);
+
+        runner.run("BM_CharsetEncode/alnum" + suffix, [&](uint64_t iterations) {
+            uint64_t encoded = 0;
+            for (uint64_t n = 0; n < iterations; n++) {
+                password[0] = 'a' + n % 26;
+                encoded += AlnumCharset::encode(password, length);
+            }
+            doNotOptimize(encoded);
+            return iterations;
+        }, 1, true);
+
+        // 64 passwords packed one after the other, as BatchCracker converts them, items are the passwords
+        static const unsigned BATCH = 64;
+        char passwords[BATCH * rainbow::MAXPASSWORDLENGTH];
+        uint64_t codes[BATCH];
+        for (unsigned k = 0; k < BATCH * length; k++) {
+            passwords[k] = AlnumCharset::symbol(k * 7 % AlnumCharset::SIZE);
+        }
+        runner.run("BM_EncodeBatch" + suffix, [&](uint64_t iterations) {
+            for (uint64_t n = 0; n < iterations; n++) {
+                passwords[0] = 'a' + n % 26;
+                encodeStringsToUint64(passwords, length, length, BATCH, codes);
+                doNotOptimize(&codes[0]);
+            }
+            return iterations * BATCH;
+        }, 1, true);
+
+        runner.run("BM_CharsetEncodeBatch/alnum" + suffix, [&](uint64_t iterations) {
+            for (uint64_t n = 0; n < iterations; n++) {
+                passwords[0] = 'a' + n % 26;
+                for (unsigned k = 0; k < BATCH; k++) {
+                    codes[k] = AlnumCharset::encode(passwords + k * length, length);
+                }
+                doNotOptimize(&codes[0]);
+            }
+            return iterations * BATCH;
+        }, 1, true);
+
+        runner.run("BM_DecodeBatch" + suffix, [&](uint64_t iterations) {
+            for (uint64_t n = 0; n < iterations; n++) {
+                codes[0] = n % AlnumCharset::SIZE;
+                decodeUint64ToStrings(codes, BATCH, length, passwords, length);
+                doNotOptimize(&passwords[0]);
+            }
+            return iterations * BATCH;
+        }, 1, true);
+
+        runner.run("BM_CharsetDecodeBatch/alnum" + suffix, [&](uint64_t iterations) {
+            for (uint64_t n = 0; n < iterations; n++) {
+                codes[0] = n % AlnumCharset::SIZE;
+                for (unsigned k = 0; k < BATCH; k++) {
+                    AlnumCharset::decode(codes[k], length, passwords + k * length);
+                }
+                doNotOptimize(&passwords[0]);
+            }
+            return iterations * BATCH;
+        }, 1, true);
+
+        // A batch of chains, items are the hashes computed
+        std::mt19937_64 generator(length);
+        const std::vector<uint64_t> heads = randomHeads(64, length, generator);
+        std::vector<uint64_t> tails(heads.size());
+        runner.run("BM_GenerateChain" + suffix, [&](uint64_t iterations) {
+            for (uint64_t n = 0; n < iterations; n++) {
+                rainbow::generateChains(length, CHAINLENGTH, heads, tails);
+                doNotOptimize(tails.data());
+            }
+            return iterations * heads.size() * (CHAINLENGTH + 1);
+        }, 1, true);
+    }
+
+    // Lookups of random endpoints in tables of chain length 0: a reduction and a binary search each.
+    // The small table stays in cache, the large one does not.
+    for (unsigned logEntries : {16u, 22u}) {
+        const string name = "BM_TableProbe/" + std::to_string(1u << logEntries);
+        if (!runner.selected(name)) {
+            continue;
+        }
+        std::mt19937_64 generator(logEntries);
+        std::vector<rainbow::Entry> entries(size_t(1) << logEntries);
+        for (rainbow::Entry& entry : entries) {
+            entry = {0, randomHeads(1, 6, generator)[0]};
+        }
+        std::sort(entries.begin(), entries.end(), [](const rainbow::Entry& a, const rainbow::Entry& b) {
+            return a.second < b.second;
+        });
+        const rainbow::TableView table{rainbow::Span<const rainbow::Entry>(entries), 6, 0};
+
+        std::vector<rainbow::Digest> digests(1024);
+        for (rainbow::Digest& digest : digests) {
+            for (unsigned char& byte : digest.bytes) {
+                byte = static_cast<unsigned char>(generator());
+            }
+        }
+        std::vector<rainbow::Result> results(digests.size());
+        const std::atomic<bool> keepRunning(true);
+        runner.run(name, [&](uint64_t iterations) {
+            for (uint64_t n = 0; n < iterations; n++) {
+                rainbow::crack(table, digests, results, keepRunning);
+            }
+            return iterations * digests.size();
+        }, 1, true);
+    }
+}
+
+void macroBenchmarks(BenchmarkRunner& runner, const std::vector<unsigned>& threadCounts) {
+    const unsigned maxThreads = threadCounts.back();
+
+    std::mt19937_64 generator(0);
+    const std::vector<uint64_t> heads = randomHeads(1 << 14, 6, generator);
+
+    // Generation and sorting of a table of 16384 chains, items are the chains
+    for (unsigned threads : threadCounts) {
+        runner.run("BM_GenerateTable/threads:" + std::to_string(threads), [&](uint64_t iterations) {
+            for (uint64_t n = 0; n < iterations; n++) {
+                std::vector<rainbow::Entry> table = generateTable(heads, threads);
+                doNotOptimize(table.data());
+            }
+            return iterations * heads.size();
+        }, threads);
+    }
+
+    // Hashes cracked against the same table, half of them from its chains, items are the hashes
+    const std::vector<rainbow::Entry> entries = generateTable(heads, maxThreads);
+    const rainbow::TableView table{rainbow::Span<const rainbow::Entry>(entries), 6, CHAINLENGTH};
+    std::vector<rainbow::Digest> digests(256);
+    for (size_t i = 0; i < digests.size(); i++) {
+        char password[7];
+        if (i % 2 == 0) {
+            AlnumCharset::decode(heads[i], 6, password);
+        } else {
+            for (unsigned j = 0; j < 6; j++) {
+                password[j] = AlnumCharset::symbol(generator() % AlnumCharset::SIZE);
+            }
+        }
+        Sha256Policy::hashBatch(password, 6, 6, 1, digests[i].bytes);
+    }
+
+    // The hashes of the chains only, on the calling thread, items are the hashes cracked. The whole crack path,
+    // from the walks to the regeneration of the chains, must not allocate once warmed up.
+    std::vector<rainbow::Digest> crackable;
+    for (size_t i = 0; i < digests.size(); i += 2) {
+        crackable.push_back(digests[i]);
+    }
+    std::vector<rainbow::Result> crackableResults(crackable.size());
+    runner.run("BM_CrackHash", [&](uint64_t iterations) {
+        const std::atomic<bool> keepRunning(true);
+        uint64_t nbCracked = 0;
+        for (uint64_t n = 0; n < iterations; n++) {
+            nbCracked += rainbow::crack(table, crackable, crackableResults, keepRunning);
+        }
+        return nbCracked;
+    }, 1, true);
+
+    // The same hashes with the serial engine of crack_password --engine serial, which must not allocate either
+    runner.run("BM_CrackSerial", [&](uint64_t iterations) {
+        const std::atomic<bool> keepRunning(true);
+        uint64_t nbCracked = 0;
+        for (uint64_t n = 0; n < iterations; n++) {
+            nbCracked += rainbow::crackSerial(table, crackable, crackableResults, keepRunning);
+        }
+        return nbCracked;
+    }, 1, true);
+
+    for (unsigned threads : threadCounts) {
+        runner.run("BM_CrackTable/threads:" + std::to_string(threads), [&](uint64_t iterations) {
+            const std::atomic<bool> keepRunning(true);
+            for (uint64_t n = 0; n < iterations; n++) {
+                std::vector<rainbow::Result> results(digests.size());
+                std::vector<std::thread> workers;
+                const size_t slice = (digests.size() + threads - 1) / threads;
+                for (unsigned t = 0; t < threads; t++) {
+                    const size_t first = std::min(digests.size(), t * slice);
+                    const size_t count = std::min(digests.size(), first + slice) - first;
+                    workers.emplace_back([&, first, count]() {
+                        rainbow::crack(table, rainbow::Span<const rainbow::Digest>(digests.data() + first, count),
+                                       rainbow::Span<rainbow::Result>(results.data() + first, count), keepRunning);
+                    });
+                }
+                for (auto& worker : workers) {
+                    worker.join();
+                }
+            }
+            return iterations * digests.size();
+        }, threads);
+    }
+}
+
+// Tasks run by each iteration of the thread pool benchmarks
+static const size_t POOLTASKS = 1024;
+
+void poolBenchmarks(BenchmarkRunner& runner, const std::vector<unsigned>& threadCounts) {
+    // Empty tasks through the pool, items are the tasks: what a task costs the pool, and whether submitting
+    // one allocates once the queues have grown
+    for (unsigned threads : threadCounts) {
+        ThreadPool pool(threads);
+        std::atomic<uint64_t> nbRun(0);
+        const string suffix = "/threads:" + std::to_string(threads);
+
+        runner.run("BM_PoolEnqueue" + suffix, [&](uint64_t iterations) {
+            std::vector<std::future<void>> futures(POOLTASKS);
+            for (uint64_t n = 0; n < iterations; n++) {
+                for (auto& future : futures) {
+                    future = pool.enqueue([&nbRun]() { nbRun++; });
+                }
+                for (auto& future : futures) {
+                    future.get();
+                }
+            }
+            return iterations * POOLTASKS;
+        }, threads);
+
+        runner.run("BM_PoolSubmit" + suffix, [&](uint64_t iterations) {
+            for (uint64_t n = 0; n < iterations; n++) {
+                for (size_t i = 0; i < POOLTASKS; i++) {
+                    pool.submit([&nbRun]() { nbRun++; });
+                }
+                pool.wait_idle();
+            }
+            return iterations * POOLTASKS;
+        }, threads, true);
+
+        runner.run("BM_PoolEnqueueN" + suffix, [&](uint64_t iterations) {
+            for (uint64_t n = 0; n < iterations; n++) {
+                pool.enqueue_n(POOLTASKS, [&nbRun](size_t) { nbRun++; });
+                pool.wait_idle();
+            }
+            return iterations * POOLTASKS;
+        }, threads, true);
+
+        runner.run("BM_PoolParallelFor" + suffix, [&](uint64_t iterations) {
+            for (uint64_t n = 0; n < iterations; n++) {
+                pool.parallel_for(0, POOLTASKS, 1, [&nbRun](size_t first, size_t last) { nbRun += last - first; });
+            }
+            return iterations * POOLTASKS;
+        }, threads);
+        doNotOptimize(&nbRun);
+    }
+}
+
+int main(int argc, char const *argv[])
+{
+    if (argc % 2 != 1) {
+        std::cerr << "Usage : ./bench.out [--filter substring] [--min-time seconds] [--out file], where" << std::endl
+            << "- --filter only runs the benchmarks whose name holds substring," << std::endl
+            << "- --min-time is the shortest run kept for each benchmark (0.5 seconds by default)," << std::endl
+            << "- --out is the file the JSON results are written to (the standard output by default)." << std::endl;
+        return 1;
+    }
+
+    string filter;
+    double minTime = 0.5;
+    string outputFile;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const string option = argv[i];
+        const string value = argv[i + 1];
+        if (option == "--filter") filter = value;
+        else if (option == "--min-time") minTime = std::stod(value);
+        else if (option == "--out") outputFile = value;
+        else {
+            std::cerr << "Unknown option: " << option << " " << value << std::endl;
+            return 1;
+        }
+    }
+
+    // 1, 2, 4... threads up to the number of cores
+    std::vector<unsigned> threadCounts;
+    const unsigned maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned threads = 1; threads < maxThreads; threads *= 2) {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(maxThreads);
+
+    BenchmarkRunner runner(minTime, filter, &heapAllocations);
+    microBenchmarks(runner);
+    poolBenchmarks(runner, threadCounts);
+    macroBenchmarks(runner, threadCounts);
+
+    if (outputFile.empty()) {
+        runner.writeJson(std::cout);
+    } else {
+        std::ofstream stream(outputFile);
+        runner.writeJson(stream);
+    }
+
+    for (const string& name : runner.allocatingBenchmarks()) {
+        std::cerr << name << " allocated on the heap in its steady state" << std::endl;
+    }
+    return runner.allocatingBenchmarks().empty() ? 0 : 1;
+}
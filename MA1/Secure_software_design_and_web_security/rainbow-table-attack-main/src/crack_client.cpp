@@ -0,0 +1,148 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <csignal>
+#include <cstring>
+#include <algorithm>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include "HashList.hpp"
+#include "DaemonProtocol.hpp"
+#include "Timer.hpp"
+
+using std::string;
+
+std::atomic<bool> keepRunning(true);
+
+void signalHandler(int signal) {
+    if (signal == SIGINT || signal == SIGTERM) {
+        keepRunning.store(false);
+    }
+}
+
+int main(int argc, char const *argv[])
+{
+    std::signal(SIGINT, signalHandler);
+    std::signal(SIGTERM, signalHandler);
+
+    Timer timer;
+    timer.start();
+
+    if(argc != 4)
+    {
+        std::cerr << "Usage : ./crack_client.out socket_path if_hash of_pwd, where" << std::endl
+            << "- socket_path is the Unix-domain socket of a running crack_daemon.out," << std::endl
+            << "- if_hash is the name of the input file where the sha-256 hashes of the passwords are stored," << std::endl
+            << "- of_pwd is the name of the output file where the cracked passwords will be stored." << std::endl
+            << "  Passwords are printed as \"hash:password\" as soon as the daemon finds them." << std::endl;
+        return 1;
+    }
+
+    const string socketPath = argv[1];
+    const string input_hash_file = argv[2];
+    const string output_password_file = argv[3];
+
+    HashList hashList(input_hash_file);
+    const std::vector<rainbow::Digest>& digests = hashList.digests();
+
+    // Each distinct hash is submitted once, by requests of at most MAXSUBMITDIGESTS hashes: request id k + 1
+    // holds the digests from k * MAXSUBMITDIGESTS
+    const uint32_t nbRequests = (digests.size() + protocol::MAXSUBMITDIGESTS - 1) / protocol::MAXSUBMITDIGESTS;
+    std::vector<char> payload;
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        std::cerr << "Could not connect to " << socketPath << std::endl;
+        return 1;
+    }
+    for (uint32_t request = 0; request < nbRequests; request++) {
+        const size_t first = static_cast<size_t>(request) * protocol::MAXSUBMITDIGESTS;
+        const uint32_t count = std::min<size_t>(protocol::MAXSUBMITDIGESTS, digests.size() - first);
+        payload.clear();
+        protocol::putUint32(payload, request + 1);
+        protocol::putUint32(payload, count);
+        for (size_t idx = first; idx < first + count; idx++) {
+            payload.insert(payload.end(), digests[idx].bytes, digests[idx].bytes + DIGESTSIZE);
+        }
+        if (!protocol::writeFrame(fd, protocol::SUBMIT, payload)) {
+            std::cerr << "Could not submit the hashes" << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<string> crackedPasswords(digests.size(), "?");
+    std::vector<bool> requestDone(nbRequests, false);
+    uint32_t nbDone = 0;
+    uint32_t nbCracked = 0;
+    bool cancelled = false;
+    bool cancelSent = false;
+    uint8_t type;
+    while (nbDone < nbRequests) {
+        if (!keepRunning.load() && !cancelSent) {
+            for (uint32_t request = 0; request < nbRequests; request++) {
+                if (!requestDone[request]) {
+                    std::vector<char> cancel;
+                    protocol::putUint32(cancel, request + 1);
+                    protocol::writeFrame(fd, protocol::CANCEL, cancel);
+                }
+            }
+            cancelSent = true;
+        }
+
+        pollfd pfd{fd, POLLIN, 0};
+        if (poll(&pfd, 1, 200) <= 0) {
+            continue;
+        }
+        if (!protocol::readFrame(fd, type, payload)) {
+            std::cerr << "Connection to the daemon lost" << std::endl;
+            break;
+        }
+
+        uint32_t id = 0;
+        uint32_t value = 0;
+        const bool known = protocol::getUint32(payload, 0, id) && id >= 1 && id <= nbRequests;
+        const size_t first = known ? static_cast<size_t>(id - 1) * protocol::MAXSUBMITDIGESTS : 0;
+        if (type == protocol::RESULT && known && protocol::getUint32(payload, 4, value)
+            && first + value < digests.size()) {
+            const size_t idx = first + value;
+            char hash[HEXDIGESTSIZE];
+            digestToHex(digests[idx].bytes, hash);
+            crackedPasswords[idx].assign(payload.begin() + 8, payload.end());
+            std::cout << string(hash, HEXDIGESTSIZE) << ':' << crackedPasswords[idx] << std::endl;
+        } else if (type == protocol::DONE && known && protocol::getUint32(payload, 4, value) && !requestDone[id - 1]) {
+            requestDone[id - 1] = true;
+            nbDone++;
+            nbCracked += value;
+            cancelled = cancelled || (payload.size() > 8 && payload[8]);
+        } else if (type == protocol::ERROR) {
+            std::cerr << "Daemon error: " << string(payload.begin(), payload.end()) << std::endl;
+            break;
+        }
+    }
+    close(fd);
+
+    const bool done = nbDone == nbRequests;
+    if (done) {
+        std::cout << "Cracked " << nbCracked << " of " << digests.size() << " distinct hashes"
+                  << (cancelled ? " before cancellation" : "") << "." << std::endl;
+    }
+
+    std::ofstream passwd_file(output_password_file);
+    for (uint32_t digest : hashList.lines()) {
+        passwd_file << (digest == HashList::INVALID ? "?" : crackedPasswords[digest]) << '\n';
+    }
+    passwd_file << '\n';
+    passwd_file.close();
+
+    std::cout << "Cracked password in " << timer.elapsedTime() << " seconds." << std::endl;
+
+    return done ? 0 : 1;
+}
@@ -0,0 +1,360 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <csignal>
+#include <cstring>
+#include <filesystem>
+#include <cerrno>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include "../misc/threadpool.hpp"
+#include "Rainbow.hpp"
+#include "DaemonProtocol.hpp"
+#include "Trace.hpp"
+
+using std::string;
+
+std::atomic<bool> keepRunning(true);
+
+// Number of digests of a request cracked by a task
+static const unsigned TASKSIZE = 64;
+
+void signalHandler(int signal) {
+    if (signal == SIGINT || signal == SIGTERM) {
+        keepRunning.store(false);
+    }
+}
+
+struct Request {
+    uint32_t id;
+    std::vector<rainbow::Digest> digests;
+    std::atomic<bool> active{true};
+    std::atomic<size_t> remainingTasks{0};
+    std::atomic<uint32_t> nbCracked{0};
+};
+
+struct Connection {
+    int fd;
+    std::mutex writeMutex;
+    std::mutex requestsMutex;
+    std::map<uint32_t, std::shared_ptr<Request>> requests;
+    std::atomic<bool> closed{false};
+
+    explicit Connection(int fd) : fd{fd} {}
+
+    // The socket is closed only once no task refers to the connection anymore
+    ~Connection() {
+        close(fd);
+    }
+
+    bool send(uint8_t type, const std::vector<char>& payload) {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        return protocol::writeFrame(fd, type, payload);
+    }
+
+    void sendError(const string& message) {
+        send(protocol::ERROR, std::vector<char>(message.begin(), message.end()));
+    }
+};
+
+// Cracks request->digests[first, first + count) against every table, streams the passwords
+// found, and sends DONE if it is the last task of the request
+void runTask(const std::vector<rainbow::TableView>& tables, std::shared_ptr<Connection> connection,
+     std::shared_ptr<Request> request, size_t first, unsigned count) {
+    TRACE_ZONE("request task");
+    // Table by table, so that the passwords a table finds are sent before the next table is searched.
+    // A table walks the digests of the task in lockstep, their passwords are all known at the same time.
+    rainbow::Digest pending[TASKSIZE];
+    uint32_t indices[TASKSIZE];
+    rainbow::Result results[TASKSIZE];
+    for (unsigned k = 0; k < count; k++) {
+        pending[k] = request->digests[first + k];
+        indices[k] = first + k;
+    }
+
+    unsigned nbPending = count;
+    for (const rainbow::TableView& table : tables) {
+        if (nbPending == 0 || !request->active.load()) {
+            break;
+        }
+        rainbow::crack(table, rainbow::Span<const rainbow::Digest>(pending, nbPending),
+                       rainbow::Span<rainbow::Result>(results, nbPending), request->active);
+
+        unsigned kept = 0;
+        for (unsigned k = 0; k < nbPending; k++) {
+            if (results[k].length == 0) {
+                pending[kept] = pending[k];
+                indices[kept++] = indices[k];
+                continue;
+            }
+            std::vector<char> payload;
+            payload.reserve(2 * sizeof(uint32_t) + results[k].length);
+            protocol::putUint32(payload, request->id);
+            protocol::putUint32(payload, indices[k]);
+            payload.insert(payload.end(), results[k].password, results[k].password + results[k].length);
+            connection->send(protocol::RESULT, payload);
+            request->nbCracked++;
+        }
+        nbPending = kept;
+    }
+
+    if (--request->remainingTasks == 0) {
+        // Forgotten before DONE is sent, so that the client may reuse the id as soon as it reads DONE
+        {
+            std::lock_guard<std::mutex> lock(connection->requestsMutex);
+            connection->requests.erase(request->id);
+        }
+
+        std::vector<char> payload;
+        protocol::putUint32(payload, request->id);
+        protocol::putUint32(payload, request->nbCracked.load());
+        payload.push_back(request->active.load() ? 0 : 1);
+        connection->send(protocol::DONE, payload);
+    }
+}
+
+void submit(ThreadPool& pool, const std::vector<rainbow::TableView>& tables, std::shared_ptr<Connection> connection,
+     const std::vector<char>& payload) {
+    uint32_t id;
+    uint32_t count;
+    if (!protocol::getUint32(payload, 0, id) || !protocol::getUint32(payload, 4, count)
+        || payload.size() != 8 + static_cast<size_t>(count) * DIGESTSIZE) {
+        connection->sendError("Malformed SUBMIT frame");
+        return;
+    }
+
+    auto request = std::make_shared<Request>();
+    request->id = id;
+    request->digests.resize(count);
+    for (uint32_t k = 0; k < count; k++) {
+        std::memcpy(request->digests[k].bytes, payload.data() + 8 + k * DIGESTSIZE, DIGESTSIZE);
+    }
+
+    const size_t nbTasks = (count + TASKSIZE - 1) / TASKSIZE;
+    request->remainingTasks = nbTasks;
+    bool inProgress;
+    {
+        // The RESULT and DONE frames of two requests of the same id could not be told apart
+        std::lock_guard<std::mutex> lock(connection->requestsMutex);
+        inProgress = connection->requests.count(id) != 0;
+        if (!inProgress && nbTasks > 0) {
+            connection->requests[id] = request;
+        }
+    }
+    if (inProgress) {
+        connection->sendError("Request " + std::to_string(id) + " is already in progress");
+        return;
+    }
+
+    if (nbTasks == 0) {
+        std::vector<char> done;
+        protocol::putUint32(done, id);
+        protocol::putUint32(done, 0);
+        done.push_back(0);
+        connection->send(protocol::DONE, done);
+        return;
+    }
+
+    // Nobody waits on the tasks: the last one sends DONE
+    pool.enqueue_n(nbTasks, [&tables, connection, request, count](size_t task) {
+        const size_t first = task * TASKSIZE;
+        runTask(tables, connection, request, first, std::min<size_t>(TASKSIZE, count - first));
+    });
+}
+
+void cancel(std::shared_ptr<Connection> connection, const std::vector<char>& payload) {
+    uint32_t id;
+    if (!protocol::getUint32(payload, 0, id)) {
+        connection->sendError("Malformed CANCEL frame");
+        return;
+    }
+    std::lock_guard<std::mutex> lock(connection->requestsMutex);
+    auto it = connection->requests.find(id);
+    if (it != connection->requests.end()) {
+        it->second->active = false;
+    }
+}
+
+void serve(ThreadPool& pool, const std::vector<rainbow::TableView>& tables, std::shared_ptr<Connection> connection) {
+    uint8_t type;
+    std::vector<char> payload;
+    bool tooLarge = false;
+
+    while (protocol::readFrame(connection->fd, type, payload, &tooLarge)) {
+        if (type == protocol::SUBMIT) {
+            submit(pool, tables, connection, payload);
+        } else if (type == protocol::CANCEL) {
+            cancel(connection, payload);
+        } else {
+            connection->sendError("Unknown frame type");
+        }
+    }
+    if (tooLarge) {
+        connection->sendError("Frame too large (at most " + std::to_string(protocol::MAXFRAMESIZE) + " bytes)");
+    }
+
+    // The client is gone: its requests are not worth finishing
+    std::lock_guard<std::mutex> lock(connection->requestsMutex);
+    for (auto& request : connection->requests) {
+        request.second->active = false;
+    }
+    shutdown(connection->fd, SHUT_RDWR);
+    connection->closed = true;
+}
+
+// Makes room for the socket at address: nothing is there, or a socket left behind by a daemon that is gone and
+// that is removed. Returns false with a message if the path is a live socket, or anything else than a socket.
+bool claimSocketPath(const sockaddr_un& address, std::string& error) {
+    struct stat info;
+    if (lstat(address.sun_path, &info) != 0) {
+        if (errno == ENOENT) {
+            return true;
+        }
+        error = std::strerror(errno);
+        return false;
+    }
+    if (!S_ISSOCK(info.st_mode)) {
+        error = "the path exists and is not a socket";
+        return false;
+    }
+
+    int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (probe < 0) {
+        error = std::strerror(errno);
+        return false;
+    }
+    const bool live = connect(probe, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0;
+    close(probe);
+    if (live) {
+        error = "another daemon is listening on it";
+        return false;
+    }
+    if (unlink(address.sun_path) != 0) {
+        error = std::strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char const *argv[])
+{
+    std::signal(SIGINT, signalHandler);
+    std::signal(SIGTERM, signalHandler);
+    std::signal(SIGPIPE, SIG_IGN);
+
+    if(argc < 3)
+    {
+        std::cerr << "Usage : ./crack_daemon.out socket_path table [table ...], where" << std::endl
+            << "- socket_path is the path of the Unix-domain socket to listen on," << std::endl
+            << "- table is password_length:nbReduction:if_table, a rainbow table to load once and serve," << std::endl
+            << "  or a directory of tables named as generate_table.out names them." << std::endl
+            << "  Every hash submitted is looked up in the tables in the given order." << std::endl;
+        return 1;
+    }
+
+    const string socketPath = argv[1];
+
+    std::vector<rainbow::MappedTable> tables;
+    for (int i = 2; i < argc; i++) {
+        const string spec = argv[i];
+        if (std::filesystem::is_directory(spec)) {
+            for (auto& table : rainbow::openTables(spec)) {
+                tables.push_back(std::move(table));
+            }
+            continue;
+        }
+        size_t first = spec.find(':');
+        size_t second = spec.find(':', first + 1);
+        if (first == string::npos || second == string::npos) {
+            std::cerr << "Invalid table: " << spec << std::endl;
+            return 1;
+        }
+        const int passwordLength = std::stoi(spec.substr(0, first));
+        const int nbReduction = std::stoi(spec.substr(first + 1, second - first - 1));
+        const string filename = spec.substr(second + 1);
+        if (passwordLength < static_cast<int>(rainbow::MINPASSWORDLENGTH)
+            || passwordLength > static_cast<int>(rainbow::charsetMaxLength(rainbow::ALNUM))) {
+            std::cerr << "Unsupported length: " << passwordLength << std::endl;
+            return 1;
+        }
+
+        tables.emplace_back(filename, passwordLength, nbReduction);
+    }
+    std::vector<rainbow::TableView> views;
+    for (const auto& table : tables) {
+        std::cout << "Mapped table of " << table.size() << " entries (length " << table.view().passwordLength
+                  << ", " << table.view().chainLength << " reductions)." << std::endl;
+        views.push_back(table.view());
+    }
+
+    int listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (listenFd < 0 || socketPath.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Could not create the socket " << socketPath << std::endl;
+        return 1;
+    }
+    std::strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+    string error;
+    if (!claimSocketPath(address, error)) {
+        std::cerr << "Could not listen on " << socketPath << ": " << error << std::endl;
+        return 1;
+    }
+    if (bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(listenFd, 16) != 0) {
+        std::cerr << "Could not listen on " << socketPath << std::endl;
+        return 1;
+    }
+    std::cout << "Listening on " << socketPath << std::endl;
+
+    std::list<std::pair<std::thread, std::shared_ptr<Connection>>> clients;
+    {
+        // Workers stay up between requests
+        ThreadPool pool(std::thread::hardware_concurrency());
+
+        while (keepRunning.load()) {
+            pollfd pfd{listenFd, POLLIN, 0};
+            if (poll(&pfd, 1, 500) > 0) {
+                int clientFd = accept(listenFd, nullptr, nullptr);
+                if (clientFd >= 0) {
+                    auto connection = std::make_shared<Connection>(clientFd);
+                    clients.emplace_back(std::thread(serve, std::ref(pool), std::cref(views), connection), connection);
+                }
+            }
+
+            // Reap the connections that were closed
+            for (auto it = clients.begin(); it != clients.end();) {
+                if (it->second->closed.load()) {
+                    it->first.join();
+                    it = clients.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+
+        std::cout << "Shutting down..." << std::endl;
+        for (auto& client : clients) {
+            shutdown(client.second->fd, SHUT_RDWR);
+        }
+        for (auto& client : clients) {
+            client.first.join();
+        }
+    }
+
+    close(listenFd);
+    unlink(socketPath.c_str());
+    TRACE_EXPORT("crack_daemon");
+
+    return 0;
+}
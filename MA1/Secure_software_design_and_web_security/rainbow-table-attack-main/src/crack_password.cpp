@@ -7,15 +7,28 @@
 #include <atomic>
 #include <filesystem>  
 #include <system_error>  
+#include <mutex>
+#include <future>
+#include <memory>
+#include <cstring>
+#include <numeric>
 
-#include "../utils/sha256.h"
-#include "../utils/6bits-encoder.hpp"
+#include "../misc/threadpool.hpp"
 #include "Timer.hpp"
+#include "MergeJoinCracker.hpp"
+#include "Potfile.hpp"
+#include "Rainbow.hpp"
+#include "HashList.hpp"
+#include "BruteForcer.hpp"
+#include "TablePlanner.hpp"
+#include "Trace.hpp"
+#include "PerfCounters.hpp"
+#include "Numa.hpp"
+#include "HugePages.hpp"
 
 using std::string;
 
 static const unsigned HASHSIZE = 65;
-static const string charset = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
 
 
 std::atomic<bool> keepRunning(true);  // Shared flag to signal all threads to stop
@@ -27,84 +40,364 @@ void signalHandler(int signal) {
     }
 }
 
-void createTable(const string& tableFilename, std::vector<std::pair<uint64_t, uint64_t>>& myMap) {
-    std::ifstream file(tableFilename, std::ios::binary);
-    if (!file) {
-        throw std::runtime_error("Could not open file");
+enum Engine {
+    ENGINE_AUTO,
+    ENGINE_BRUTE,
+    ENGINE_SERIAL,
+    ENGINE_BATCH,
+    ENGINE_COLUMN,
+    ENGINE_MERGE
+};
+
+// Everything the cracking engines need besides the table and the hashes
+struct CrackSettings {
+    Engine engine = ENGINE_AUTO;
+    rainbow::HashAlgorithm hash = rainbow::SHA256;
+    rainbow::CharsetKind charset = rainbow::ALNUM;
+    int nbReduction = 0;
+    int numThreads = 1;
+    string tableFile;
+    Potfile* potfile = nullptr;     // cracked passwords are recorded in it, when set
+    std::ostream* stream = nullptr; // where the column engine streams its results
+    PerfProfile* profile = nullptr; // hardware counters of the phases, when set
+    bool replicate = false;         // one copy of the loaded table per NUMA node
+    HugePages hugePages = HUGEPAGES_OFF; // pages backing the loaded table and its copies
+};
+
+// Records the passwords cracked in digests[startIdx, endIdx) in the potfile, if any
+void recordCracked(Potfile* potfile, const std::vector<rainbow::Digest>& digests, const std::vector<rainbow::Result>& results,
+     size_t startIdx, size_t endIdx) {
+    if (potfile == nullptr) {
+        return;
     }
+    TRACE_ZONE("record in potfile");
+    for (size_t idx = startIdx; idx < endIdx; idx++) {
+        if (results[idx].length > 0) {
+            potfile->add(digests[idx].bytes, results[idx].password, results[idx].length);
+        }
+    }
+}
 
-    uint64_t encodedHead;
-    uint64_t encodedTail;
+// Maximum number of hashes handed to a worker at once: small enough to balance the load
+// when cracked hashes take a handful of steps and uncrackable ones the whole table
+static const size_t HASHES_PER_TASK = 64;
 
-    while (file.read(reinterpret_cast<char*>(&encodedHead), sizeof(encodedHead)) &&
-           file.read(reinterpret_cast<char*>(&encodedTail), sizeof(encodedTail))) {
-        myMap.emplace_back(std::make_pair(encodedHead, encodedTail));
-    }
-    file.close();
+// Shrinks the tasks of short lists so that every worker gets several of them
+size_t taskSize(size_t nbHashes, size_t numThreads) {
+    size_t size = (nbHashes + 4 * numThreads - 1) / (4 * numThreads);
+    return std::max<size_t>(1, std::min(size, HASHES_PER_TASK));
 }
 
-void reduction(const int passwdLength, const string &hash, const int position, string &reduced) {
-    int index = 0;
+// Where the workers run, set by main before any pool is created
+ThreadPlacement placement(AFFINITY_NONE);
+// Index in placement.nodes() of the node of the worker, it reads the table replicated on that node
+thread_local unsigned workerNode = 0;
 
-    for (int i = 0; i < passwdLength; i++) {
-        index = static_cast<int>((((hash[i] ^ position) + hash[i + 3] + hash[i + 5] + hash[i + 7] + hash[i + 9] + hash[i + 17] + position) % 62));
-        reduced[i] = charset[index];
+// Called by each worker of the pools before it runs any task
+void pinWorker(unsigned index) {
+    workerNode = placement.pin(index);
+}
+
+// Calls task(startIdx, endIdx) on the pool for chunks of size indices covering [0, count), and returns when they
+// are all done. The duration of a chunk is added to the busy time of the worker that runs it.
+template<class Function>
+void forEachTimed(ThreadPool& pool, std::vector<double>& busyTimes, size_t count, size_t size, Function task) {
+    pool.parallel_for(0, count, size, [&](size_t startIdx, size_t endIdx) {
+        Timer timer;
+        timer.start();
+        task(startIdx, endIdx);
+        busyTimes[ThreadPool::worker_index()] += timer.elapsedTime();
+    });
+}
+
+void reportBusyTimes(const std::vector<double>& busyTimes, double wallTime) {
+    for (size_t i = 0; i < busyTimes.size(); i++) {
+        std::cout << "Thread " << i << " busy for " << busyTimes[i] << " seconds ("
+                  << (wallTime > 0 ? 100 * busyTimes[i] / wallTime : 0) << "% of the cracking time)." << std::endl;
     }
 }
 
-string crackPassword(const string &head, const int &reductionIdx, const int passwdLength) {
-    string reduced = head;
-    string hash;
-    for (int i=0; i<reductionIdx; i++) {
-        hash = sha256(reduced);
-        reduction(passwdLength, hash, i, reduced);
+// Cracks digests[startIdx, endIdx) with librainbow, with its serial engine or its batch one
+void crackHashes(const std::vector<rainbow::Digest>& digests, size_t startIdx, size_t endIdx, const rainbow::TableView& table,
+     Engine engine, std::vector<rainbow::Result>& results, PerfProfile* profile) {
+    PerfScope counters(profile, engine == ENGINE_SERIAL ? "crack (serial)" : "crack (batch)");
+    rainbow::CrackStatistics statistics;
+    const rainbow::Span<const rainbow::Digest> batch(&digests[startIdx], endIdx - startIdx);
+    const rainbow::Span<rainbow::Result> batchResults(&results[startIdx], endIdx - startIdx);
+    size_t nbCracked = engine == ENGINE_SERIAL ? rainbow::crackSerial(table, batch, batchResults, keepRunning, &statistics)
+                                               : rainbow::crack(table, batch, batchResults, keepRunning, &statistics);
+    counters.addWork(statistics.hashes, statistics.lookups);
+    for (size_t k = 0; k < nbCracked; k++) {
+        std::cout << "Password cracked." << std::endl;
     }
-    return reduced;
 }
 
-void crackHashes(const std::vector<string>& hashes, int startIdx, int endIdx, int passwordLength, int nbReduction,
-     const std::vector<std::pair<uint64_t, uint64_t>>& rainbowTable, std::vector<string>& crackedPasswords) {
-    for (int idx = startIdx; idx < endIdx; ++idx) {
-        string hash = hashes[idx];
-        string tmpHash;
-        string reduced;
-        reduced.resize(passwordLength);
-        int reductionIdx = nbReduction;
-        bool cracked = false;
-
-        // Check if signal was received to break out of the loop
-        while (0 <= reductionIdx && keepRunning.load() && !cracked) {
-
-            tmpHash = hash;
-            for (int i = 0; i < nbReduction - reductionIdx; i++) {
-                reduction(passwordLength, tmpHash, reductionIdx + i, reduced);
-                tmpHash = sha256(reduced);
+// Sweeps all pending hashes column by column, cheapest columns first. A hash leaves the
+// sweep as soon as it is cracked and its password is streamed right away as "hash:password".
+void crackHashesColumnMajor(const std::vector<rainbow::Digest>& digests, const CrackSettings& settings, ThreadPool& pool,
+     std::vector<double>& busyTimes, const std::vector<rainbow::TableView>& views, std::vector<rainbow::Result>& results) {
+    const unsigned digestSize = rainbow::hashDigestSize(settings.hash);
+    std::vector<size_t> pending(digests.size());
+    std::iota(pending.begin(), pending.end(), 0);
+
+    std::mutex streamMutex;
+
+    for (int column = settings.nbReduction; 0 <= column && !pending.empty() && keepRunning.load(); column--) {
+        std::vector<char> found(pending.size(), 0);
+
+        // taskSize keeps the tasks within HASHES_PER_TASK hashes
+        const size_t size = taskSize(pending.size(), busyTimes.size());
+        forEachTimed(pool, busyTimes, pending.size(), size, [&](size_t first, size_t last) {
+            if (!keepRunning.load()) {
+                return;
+            }
+            TRACE_ZONE("crack column");
+            PerfScope counters(settings.profile, "crack (column)");
+            rainbow::Digest batch[HASHES_PER_TASK];
+            rainbow::Result batchResults[HASHES_PER_TASK];
+            const size_t count = last - first;
+            for (size_t k = 0; k < count; k++) {
+                batch[k] = digests[pending[first + k]];
+            }
+            rainbow::CrackStatistics statistics;
+            const size_t nbCracked = rainbow::crackColumn(views[workerNode], column, rainbow::Span<const rainbow::Digest>(batch, count),
+                                                          rainbow::Span<rainbow::Result>(batchResults, count), &statistics);
+            counters.addWork(statistics.hashes, statistics.lookups);
+            if (nbCracked == 0) {
+                return;
             }
-            reduction(passwordLength, tmpHash, nbReduction, reduced);
-
-            // Use std::lower_bound to search in the sorted rainbow table
-            auto it = std::lower_bound(rainbowTable.begin(), rainbowTable.end(), encodeStringToUint64(reduced), [](const std::pair<uint64_t, uint64_t>& p, uint64_t value) {
-                return p.second < value;
-            });
-
-            if (it != rainbowTable.end()) {
-                reduced = crackPassword(decodeUint64ToString(it->first, passwordLength), reductionIdx, passwordLength);
-                tmpHash = sha256(reduced);
-                if (tmpHash == hash) {
-                    std::cout << "Password cracked." << std::endl;
-                    cracked = true;
-                    break;
+            for (size_t k = 0; k < count; k++) {
+                if (batchResults[k].length == 0) {
+                    continue;
                 }
+                const size_t idx = pending[first + k];
+                found[first + k] = 1;
+                results[idx] = batchResults[k];
+
+                if (settings.potfile != nullptr) {
+                    settings.potfile->add(digests[idx].bytes, results[idx].password, results[idx].length);
+                }
+
+                char hash[HEXDIGESTSIZE];
+                digestToHex(digests[idx].bytes, hash, digestSize);
+                std::lock_guard<std::mutex> lock(streamMutex);
+                settings.stream->write(hash, 2 * digestSize).put(':').write(results[idx].password, results[idx].length) << std::endl;
             }
-            reductionIdx--;
+        });
+
+        size_t kept = 0;
+        for (size_t k = 0; k < pending.size(); k++) {
+            if (!found[k]) {
+                pending[kept++] = pending[k];
+            }
+        }
+        if (kept != pending.size()) {
+            std::cout << "Column " << column << ": cracked " << pending.size() - kept << ", "
+                      << kept << " hashes left." << std::endl;
         }
+        pending.resize(kept);
+    }
+}
 
-        if (cracked) {
-            crackedPasswords[idx] = reduced;
-        } else {
-            crackedPasswords[idx] = "?";
+// Number of candidates a worker takes from the keyspace at once
+static const uint64_t CANDIDATES_PER_TASK = 1 << 22;
+
+// Searches the whole keyspace, each worker taking the next range of candidates when it is done with its own
+void crackBruteForce(const std::vector<rainbow::Digest>& digests, unsigned passwordLength, const CrackSettings& settings,
+     ThreadPool& pool, std::vector<double>& busyTimes, std::vector<rainbow::Result>& results) {
+    BruteForcer forcer(digests, passwordLength, settings.hash, settings.charset);
+    const uint64_t keyspace = BruteForcer::keyspaceSize(passwordLength, settings.charset);
+    std::atomic<uint64_t> nextRange(0);
+
+    // One chunk per worker: the keyspace is too large to be cut in chunks up front
+    forEachTimed(pool, busyTimes, busyTimes.size(), 1, [&](size_t, size_t) {
+        PerfScope counters(settings.profile, "brute force");
+        uint64_t first;
+        while (keepRunning.load() && !forcer.done()
+               && (first = nextRange.fetch_add(CANDIDATES_PER_TASK)) < keyspace) {
+            counters.addWork(std::min(first + CANDIDATES_PER_TASK, keyspace) - first, 0);
+            const size_t nbCracked = forcer.search(first, std::min(first + CANDIDATES_PER_TASK, keyspace), results, keepRunning);
+            for (size_t k = 0; k < nbCracked; k++) {
+                std::cout << "Password cracked." << std::endl;
+            }
         }
+    });
+    std::cout << "Searched " << std::min(nextRange.load(), keyspace) << " of " << keyspace << " candidates." << std::endl;
+}
+
+// Reads a whole table file in region, mapped with hugePages
+rainbow::Span<const rainbow::Entry> readTable(const string& tableFile, HugePages hugePages, PageRegion& region) {
+    TRACE_ZONE("load table");
+    const size_t nbEntries = std::filesystem::file_size(tableFile) / sizeof(rainbow::Entry);
+    region = PageRegion(nbEntries * sizeof(rainbow::Entry), hugePages);
+    std::ifstream file(tableFile, std::ios::binary);
+    if (!file || !file.read(static_cast<char*>(region.data()), nbEntries * sizeof(rainbow::Entry))) {
+        throw std::runtime_error("Could not read " + tableFile);
+    }
+    return rainbow::Span<const rainbow::Entry>(static_cast<const rainbow::Entry*>(region.data()), nbEntries);
+}
+
+// Copies table on every NUMA node, each copy by a thread pinned to the node so that its pages are allocated there.
+// Returns the table each node reads, table itself for all nodes when it is not replicated.
+std::vector<rainbow::Span<const rainbow::Entry>> replicateTable(rainbow::Span<const rainbow::Entry> table, bool replicate,
+     HugePages hugePages, std::vector<PageRegion>& replicas) {
+    const size_t nbNodes = placement.nodes().size();
+    if (!replicate || nbNodes < 2) {
+        return std::vector<rainbow::Span<const rainbow::Entry>>(nbNodes, table);
+    }
+    TRACE_ZONE("replicate table");
+    Timer timer;
+    timer.start();
+    replicas.resize(nbNodes);
+    std::vector<std::thread> threads;
+    for (unsigned node = 0; node < nbNodes; node++) {
+        threads.emplace_back([table, hugePages, &replicas, node]() {
+            placement.pinNode(node);
+            replicas[node] = PageRegion(table.size() * sizeof(rainbow::Entry), hugePages);
+            std::memcpy(replicas[node].data(), table.data(), table.size() * sizeof(rainbow::Entry));
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    std::cout << "Replicated the table on " << nbNodes << " NUMA nodes in " << timer.elapsedTime() << " seconds ("
+              << replicas[0].describe() << ")." << std::endl;
+
+    std::vector<rainbow::Span<const rainbow::Entry>> nodeTables;
+    for (const PageRegion& replica : replicas) {
+        nodeTables.emplace_back(static_cast<const rainbow::Entry*>(replica.data()), table.size());
+    }
+    return nodeTables;
+}
+
+// Brute force when searching the whole keyspace is expected to take no longer than looking up every hash in the table
+// (the walks and the chains regenerated for the matching tails, false alarms included), the batch engine otherwise.
+// At equal cost brute force wins: it cracks every hash, when the table only covers a part of the keyspace.
+Engine pickEngine(unsigned passwordLength, size_t nbDigests, const CrackSettings& settings) {
+    const double keyspace = BruteForcer::keyspaceSize(passwordLength, settings.charset);
+    const double nbChains = std::filesystem::file_size(settings.tableFile) / sizeof(rainbow::Entry);
+    const TableEstimate estimate = estimateTables(keyspace, {nbChains, settings.nbReduction, 1});
+    const double coverage = tableCoverage(keyspace, nbChains, settings.nbReduction);
+
+    const double bruteRate = BruteForcer::measureRate(passwordLength, settings.hash, settings.charset, 0.1);
+    const double crackRate = measureCrackRate(passwordLength, settings.hash, settings.charset, 0.1);
+    const double bruteTime = keyspace / bruteRate;
+    const double tableTime = nbDigests * estimate.crackHashes / crackRate;
+
+    const Engine engine = bruteTime <= tableTime ? ENGINE_BRUTE : ENGINE_BATCH;
+    std::cout << "Measured " << bruteRate << " candidates/s (brute force: " << bruteTime << " thread-seconds, cracks every hash) and "
+              << crackRate << " chain hashes/s (table: " << tableTime << " thread-seconds, covers about "
+              << 100 * coverage << "% of the keyspace): using "
+              << (engine == ENGINE_BRUTE ? "brute force." : "the table.") << std::endl;
+    return engine;
+}
+
+// Cracks the hashes with the table file settings.tableFile, or without a table for brute force
+void crackAll(CrackSettings settings, unsigned passwordLength, const std::vector<rainbow::Digest>& digests,
+     std::vector<rainbow::Result>& results) {
+    const int nbReduction = settings.nbReduction;
+    const int numThreads = settings.numThreads;
+
+    if (settings.engine == ENGINE_AUTO) {
+        settings.engine = pickEngine(passwordLength, digests.size(), settings);
+    }
+
+    if (settings.engine == ENGINE_MERGE) {
+        // rainbowTable is left empty, the table file is streamed instead
+        MergeJoinCracker cracker(settings.tableFile, passwordLength, nbReduction, numThreads, settings.hash, settings.charset);
+        cracker.crack(digests, results, keepRunning);
+        recordCracked(settings.potfile, digests, results, 0, digests.size());
+        return;
+    }
+
+    // Each worker cracks its share of the hashes by small batches, and takes batches of the others once done
+    ThreadPool pool(numThreads, true, pinWorker);
+    std::vector<double> busyTimes(numThreads, 0.0);
+    Timer timer;
+    timer.start();
+
+    if (settings.engine == ENGINE_BRUTE) {
+        crackBruteForce(digests, passwordLength, settings, pool, busyTimes, results);
+        recordCracked(settings.potfile, digests, results, 0, digests.size());
+        reportBusyTimes(busyTimes, timer.elapsedTime());
+        return;
     }
+
+    PageRegion loaded;
+    rainbow::Span<const rainbow::Entry> rainbowTable;
+    std::cout << "Loading rainbow table of " << std::filesystem::file_size(settings.tableFile) / (2*sizeof(uint64_t))
+              << " entries..." << std::endl;
+    {
+        PerfScope counters(settings.profile, "load table");
+        rainbowTable = readTable(settings.tableFile, settings.hugePages, loaded);
+    }
+    std::cout << "Loaded rainbow table in " << timer.elapsedTime() << " seconds (" << loaded.describe() << ")." << std::endl;
+
+    std::vector<PageRegion> replicas;
+    const std::vector<rainbow::Span<const rainbow::Entry>> nodeTables = replicateTable(rainbowTable, settings.replicate,
+                                                                                      settings.hugePages, replicas);
+    if (!replicas.empty()) {
+        loaded = PageRegion();
+    }
+    timer.reset();
+    timer.start();
+
+    std::vector<rainbow::TableView> views;
+    for (const auto& nodeTable : nodeTables) {
+        views.push_back({nodeTable, passwordLength, nbReduction, settings.hash, settings.charset});
+    }
+
+    if (settings.engine == ENGINE_COLUMN) {
+        crackHashesColumnMajor(digests, settings, pool, busyTimes, views, results);
+        reportBusyTimes(busyTimes, timer.elapsedTime());
+        return;
+    }
+
+    const size_t size = taskSize(digests.size(), numThreads);
+    forEachTimed(pool, busyTimes, digests.size(), size, [&](size_t startIdx, size_t endIdx) {
+        crackHashes(digests, startIdx, endIdx, views[workerNode], settings.engine, results, settings.profile);
+        recordCracked(settings.potfile, digests, results, startIdx, endIdx);
+    });
+    reportBusyTimes(busyTimes, timer.elapsedTime());
+}
+
+// Cracks the hashes against every table of the directory settings.tableFile at once. The hashes are handed
+// out by small batches that go through all the tables, so a hash cracked with one table skips the others.
+void crackDirectory(const CrackSettings& settings, unsigned passwordLength, const std::vector<rainbow::Digest>& digests,
+     std::vector<rainbow::Result>& results) {
+    std::vector<rainbow::MappedTable> tables = rainbow::openTables(settings.tableFile, passwordLength, settings.nbReduction,
+                                                                  settings.hash, settings.charset);
+    if (tables.empty()) {
+        throw std::runtime_error("No table found in " + settings.tableFile);
+    }
+    std::vector<rainbow::TableView> views;
+    for (const auto& table : tables) {
+        std::cout << "Mapped table of " << table.size() << " entries (length " << table.view().passwordLength
+                  << ", " << table.view().chainLength << " reductions)." << std::endl;
+        views.push_back(table.view());
+    }
+
+    const int numThreads = settings.numThreads;
+    ThreadPool pool(numThreads, true, pinWorker);
+    std::vector<double> busyTimes(numThreads, 0.0);
+    Timer timer;
+    timer.start();
+
+    const size_t size = taskSize(digests.size(), numThreads);
+    forEachTimed(pool, busyTimes, digests.size(), size, [&](size_t startIdx, size_t endIdx) {
+        PerfScope counters(settings.profile, "crack (directory)");
+        rainbow::CrackStatistics statistics;
+        size_t nbCracked = rainbow::crack(rainbow::Span<const rainbow::TableView>(views),
+                                          rainbow::Span<const rainbow::Digest>(&digests[startIdx], endIdx - startIdx),
+                                          rainbow::Span<rainbow::Result>(&results[startIdx], endIdx - startIdx), keepRunning,
+                                          &statistics);
+        counters.addWork(statistics.hashes, statistics.lookups);
+        for (size_t k = 0; k < nbCracked; k++) {
+            std::cout << "Password cracked." << std::endl;
+        }
+        recordCracked(settings.potfile, digests, results, startIdx, endIdx);
+    });
+    reportBusyTimes(busyTimes, timer.elapsedTime());
 }
 
 int main(int argc, char const *argv[])
@@ -116,14 +409,35 @@ int main(int argc, char const *argv[])
     Timer timer;
     timer.start();
 
-    if(argc != 6)
+    if(argc < 6 || argc % 2 != 0)
     {
-        std::cerr << "Usage : ./crack_password.out password_length nbReduction if_table if_hash of_pwd , where" << std::endl
-            << "- password_length is the number of chars in an alphanumeric password," << std::endl
+        std::cerr << "Usage : ./crack_password.out password_length nbReduction if_table if_hash of_pwd [--engine auto|brute|serial|batch|column|merge] [--hash sha256|sha1|md5|ntlm] [--charset alnum|lowercase|digits|printable] [--potfile path] [--counters on|off] [--affinity none|node|core] [--replicate on|off] [--hugepages off|thp|2m|1g], where" << std::endl
+            << "- password_length is the number of chars in a password (1 to 12, 10 for alnum and 9 for printable)," << std::endl
             << "- nbReduction is the number of reduction to apply in the chain," << std::endl
-            << "- if_table is the name of the input file where the rainbow table is stored," << std::endl
-            << "- if_hash is the name of the input file where the sha-256 hashes of the passwords are stored," << std::endl
-            << "- of_pwd is the name of the output file where the cracked passwords will be stored." << std::endl;    
+            << "- if_table is the name of the input file where the rainbow table is stored, or a directory of tables" << std::endl
+            << "  named as generate_table.out names them, all searched at once (password_length and nbReduction" << std::endl
+            << "  then select the tables used, 0 for any; --engine is ignored)," << std::endl
+            << "- if_hash is the name of the input file where the hashes of the passwords are stored," << std::endl
+            << "- of_pwd is the name of the output file where the cracked passwords will be stored," << std::endl
+            << "- --engine selects the lookup engine: brute searches the whole keyspace (if_table is not used)," << std::endl
+            << "  serial walks one hash at a time, batch walks batches of hashes in lockstep," << std::endl
+            << "  column sweeps all hashes column by column and streams" << std::endl
+            << "  \"hash:password\" lines to of_pwd as soon as they are cracked, merge does not load the table" << std::endl
+            << "  but reads it once sequentially against the sorted endpoints of all hashes (tables larger than RAM)," << std::endl
+            << "  auto (default) measures the hash rate and picks brute unless batch should be faster," << std::endl
+            << "- --hash is the hash function of the hashes and of the table (sha256 by default)," << std::endl
+            << "- --charset is the charset of the passwords and of the table (alnum by default)," << std::endl
+            << "- --potfile is a cache of the passwords cracked by previous runs: known hashes are answered from it" << std::endl
+            << "  and new passwords are added to it (path.idx holds its index)," << std::endl
+            << "- --counters on prints the hardware counters of each phase and thread at the end (IPC, cache, branch" << std::endl
+            << "  and TLB misses per hash and per probe), as far as the kernel allows them; merge is not covered," << std::endl
+            << "- --affinity pins each worker to the CPUs of a NUMA node (node), to one CPU (core) or not at all (none," << std::endl
+            << "  default)," << std::endl
+            << "- --replicate on copies the loaded table once per NUMA node, each worker then reads the copy of its own" << std::endl
+            << "  node (implies --affinity node unless core is given; one copy per node in memory, serial, batch and column)," << std::endl
+            << "- --hugepages backs the loaded table and its copies with transparent huge pages (thp), 2 MiB or 1 GiB" << std::endl
+            << "  hugetlbfs pages (2m, 1g) or normal pages (off, default), falling back to the next smaller ones: fewer TLB" << std::endl
+            << "  misses per probe on large tables. The pages obtained are printed; directories and merge are not covered." << std::endl;
         return 1;
     }
 
@@ -133,60 +447,153 @@ int main(int argc, char const *argv[])
     const string input_hash_file = argv[4];
     const string output_password_file = argv[5];
 
-    // Get file size of input_table_file
-    std::error_code ec;
-    auto fileSize = std::filesystem::file_size(input_table_file, ec);
-    if (ec) {
-        std::cerr << "Error getting file size: " << ec.message() << std::endl;
+    CrackSettings settings;
+    settings.nbReduction = nbReduction;
+    settings.tableFile = input_table_file;
+    settings.numThreads = std::thread::hardware_concurrency();
+
+    string potfilePath;
+    bool counters = false;
+    Affinity affinity = AFFINITY_NONE;
+    bool affinityGiven = false;
+    for (int i = 6; i + 1 < argc; i += 2) {
+        const string option = argv[i];
+        const string value = argv[i + 1];
+        if (option == "--engine" && value == "auto") settings.engine = ENGINE_AUTO;
+        else if (option == "--engine" && value == "brute") settings.engine = ENGINE_BRUTE;
+        else if (option == "--engine" && value == "serial") settings.engine = ENGINE_SERIAL;
+        else if (option == "--engine" && value == "batch") settings.engine = ENGINE_BATCH;
+        else if (option == "--engine" && value == "column") settings.engine = ENGINE_COLUMN;
+        else if (option == "--engine" && value == "merge") settings.engine = ENGINE_MERGE;
+        else if (option == "--hash" && rainbow::parseHashName(value, settings.hash)) {}
+        else if (option == "--charset" && rainbow::parseCharsetName(value, settings.charset)) {}
+        else if (option == "--potfile") potfilePath = value;
+        else if (option == "--counters" && (value == "on" || value == "off")) counters = value == "on";
+        else if (option == "--affinity" && parseAffinity(value, affinity)) affinityGiven = true;
+        else if (option == "--replicate" && (value == "on" || value == "off")) settings.replicate = value == "on";
+        else if (option == "--hugepages" && parseHugePages(value, settings.hugePages)) {}
+        else {
+            std::cerr << "Unknown option: " << option << " " << value << std::endl;
+            return 1;
+        }
+    }
+
+    PerfProfile profile(counters);
+    settings.profile = &profile;
+
+    // A replica is only local to the workers pinned to its node
+    if (settings.replicate && (!affinityGiven || affinity == AFFINITY_NONE)) {
+        affinity = AFFINITY_NODE;
+    }
+    placement = ThreadPlacement(affinity);
+    if (affinity != AFFINITY_NONE || settings.replicate) {
+        std::cout << placement.describe() << std::endl;
+    }
+
+    // The potfile format holds SHA-256 hashes only
+    if (!potfilePath.empty() && settings.hash != rainbow::SHA256) {
+        std::cerr << "--potfile is only supported with --hash sha256" << std::endl;
         return 1;
     }
-    int maxEntries = fileSize / (2*sizeof(uint64_t));
 
-    std::vector<std::pair<uint64_t, uint64_t>> rainbowTable; 
-    rainbowTable.reserve(maxEntries);
-    
-    std::cout << "Loading rainbow table..." << std::endl;
-    createTable(input_table_file, rainbowTable);
+    // A directory of tables: 0 stands for any length or chain length
+    std::error_code ec;
+    const bool tableDirectory = std::filesystem::is_directory(input_table_file, ec);
+    if (tableDirectory) {
+        settings.engine = ENGINE_BATCH;
+    }
 
-    std::cout << "Loaded rainbow table in " << timer.elapsedTime() << " seconds." << std::endl;
-    timer.reset();
-    timer.start();
+    const int maxLength = rainbow::charsetMaxLength(settings.charset);
+    if ((passwordLength < 1 && !(tableDirectory && passwordLength == 0)) || passwordLength > maxLength) {
+        std::cerr << "Unsupported length: " << passwordLength << " (at most " << maxLength << " "
+                  << rainbow::charsetName(settings.charset) << " chars)" << std::endl;
+        return 1;
+    }
 
-    std::ifstream input_file(input_hash_file);
-    std::vector<string> hashes;
-    string hash;
-    while (std::getline(input_file, hash)) {
-        hashes.push_back(hash);
+    // Brute force is the only engine that does without the table
+    if (settings.engine != ENGINE_BRUTE && !tableDirectory && !std::filesystem::is_regular_file(input_table_file, ec)) {
+        std::cerr << "Could not find the table file " << input_table_file << std::endl;
+        return 1;
     }
-    input_file.close();
 
-    std::vector<string> crackedPasswords(hashes.size(), "?");
+    // Each distinct hash is cracked once, the lines only refer to it
+    HashList hashList(input_hash_file, rainbow::hashDigestSize(settings.hash));
+    const std::vector<rainbow::Digest>& digests = hashList.digests();
+    std::cout << "Read " << hashList.lines().size() << " " << rainbow::hashName(settings.hash) << " hashes, " << digests.size() << " distinct ("
+              << hashList.nbDuplicates() << " duplicates)." << std::endl;
 
-    int numThreads = std::thread::hardware_concurrency();
+    std::vector<rainbow::Result> results(digests.size());
+    for (auto& result : results) {
+        result.length = 0;
+    }
 
-    std::vector<std::thread> threads;
-    int chunkSize = hashes.size() / numThreads;
+    std::ofstream stream;
+    if (settings.engine == ENGINE_COLUMN) {
+        stream.open(output_password_file);
+        settings.stream = &stream;
+    }
 
+    // Hashes already in the potfile skip the chain work altogether
+    std::unique_ptr<Potfile> potfile;
+    std::vector<rainbow::Digest> unknownDigests;
+    std::vector<size_t> unknownIdx;
+    if (!potfilePath.empty()) {
+        potfile = std::make_unique<Potfile>(potfilePath);
+        settings.potfile = potfile.get();
+
+        TRACE_ZONE("look up potfile");
+        string password;
+        for (size_t idx = 0; idx < digests.size(); idx++) {
+            if (potfile->find(digests[idx].bytes, password) && password.size() <= rainbow::MAXPASSWORDLENGTH) {
+                results[idx].length = password.size();
+                std::memcpy(results[idx].password, password.data(), password.size());
+                if (settings.stream != nullptr) {
+                    char hash[HEXDIGESTSIZE];
+                    digestToHex(digests[idx].bytes, hash);
+                    stream.write(hash, HEXDIGESTSIZE) << ':' << password << std::endl;
+                }
+                continue;
+            }
+            unknownDigests.push_back(digests[idx]);
+            unknownIdx.push_back(idx);
+        }
+        std::cout << "Found " << digests.size() - unknownDigests.size() << " hashes in the potfile." << std::endl;
+    }
+    const std::vector<rainbow::Digest>& toCrack = potfile ? unknownDigests : digests;
+    std::vector<rainbow::Result> toCrackResults(toCrack.size());
+    for (auto& result : toCrackResults) {
+        result.length = 0;
+    }
 
-    for (int i = 0; i < numThreads; ++i) {
-        int startIdx = i * chunkSize;
-        int endIdx = (i == numThreads - 1) ? hashes.size() : startIdx + chunkSize;
-        threads.emplace_back(crackHashes, std::ref(hashes), startIdx, endIdx, passwordLength,
-            nbReduction, std::ref(rainbowTable), std::ref(crackedPasswords));
+    if (tableDirectory) {
+        crackDirectory(settings, passwordLength, toCrack, toCrackResults);
+    }
+    if (!tableDirectory) {
+        crackAll(settings, passwordLength, toCrack, toCrackResults);
     }
 
-    for (auto& thread : threads) {
-        thread.join();
+    for (size_t i = 0; i < toCrack.size(); i++) {
+        results[potfile ? unknownIdx[i] : i] = toCrackResults[i];
     }
 
-    std::ofstream passwd_file(output_password_file);
-    for (const auto& crackedPassword : crackedPasswords) {
-        passwd_file << crackedPassword << std::endl;
+    if (settings.engine != ENGINE_COLUMN) {
+        // Back to the order of the hash file, duplicates included
+        TRACE_ZONE("write passwords");
+        std::ofstream passwd_file(output_password_file);
+        for (uint32_t digest : hashList.lines()) {
+            if (digest == HashList::INVALID || results[digest].length == 0) {
+                passwd_file << '?' << '\n';
+            } else {
+                passwd_file.write(results[digest].password, results[digest].length) << '\n';
+            }
+        }
+        passwd_file << '\n';
+        passwd_file.close();
     }
-    passwd_file << '\n';
-    passwd_file.close();
 
     std::cout << "Cracked password in " << timer.elapsedTime() << " seconds." << std::endl;
+    profile.print(std::cout);
+    TRACE_EXPORT("crack_password");
 
     return 0;
 }
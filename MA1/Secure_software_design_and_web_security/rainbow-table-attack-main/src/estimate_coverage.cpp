@@ -0,0 +1,99 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <cmath>
+#include <thread>
+#include <atomic>
+#include <csignal>
+
+#include "CoverageSampler.hpp"
+#include "TablePlanner.hpp"
+#include "Trace.hpp"
+
+using std::string;
+
+std::atomic<bool> keepRunning(true);  // Shared flag to signal all threads to stop
+
+void signalHandler(int signal) {
+    if (signal == SIGINT || signal == SIGTERM) {
+        keepRunning.store(false);
+    }
+}
+
+void printInterval(const char* name, uint64_t successes, uint64_t trials, double z) {
+    const std::pair<double, double> interval = wilsonInterval(successes, trials, z);
+    std::cout << name << " confidence interval: " << 100 * interval.first << "% to " << 100 * interval.second << "%" << std::endl;
+}
+
+int main(int argc, char const *argv[])
+{
+    std::signal(SIGINT, signalHandler);
+    std::signal(SIGTERM, signalHandler);
+
+    if(argc < 4 || argc % 2 != 0)
+    {
+        std::cerr << "Usage : ./estimate_coverage.out password_length nbReduction if_table [--samples n] [--seed s] [--time seconds] [--hash sha256|sha1|md5|ntlm] [--charset alnum|lowercase|digits|printable], where" << std::endl
+            << "- password_length and nbReduction are those of the table," << std::endl
+            << "- if_table is the name of the table file," << std::endl
+            << "- --samples is the number of random passwords cracked against the table (10000 by default)," << std::endl
+            << "- --seed seeds the random passwords, the same seed draws the same ones (1 by default)," << std::endl
+            << "- --time stops the sampling after this many seconds, with the passwords cracked so far (60 by default)," << std::endl
+            << "- --hash and --charset are those of the table (sha256 and alnum by default)." << std::endl;
+        return 1;
+    }
+
+    const unsigned passwordLength = std::stoi(argv[1]);
+    const int nbReduction = std::stoi(argv[2]);
+    const string input_table_file = argv[3];
+
+    uint64_t nbSamples = 10000;
+    uint64_t seed = 1;
+    double seconds = 60;
+    rainbow::HashAlgorithm hash = rainbow::SHA256;
+    rainbow::CharsetKind charset = rainbow::ALNUM;
+    for (int i = 4; i + 1 < argc; i += 2) {
+        const string option = argv[i];
+        const string value = argv[i + 1];
+        if (option == "--samples") nbSamples = std::stoull(value);
+        else if (option == "--seed") seed = std::stoull(value);
+        else if (option == "--time") seconds = std::stod(value);
+        else if (option == "--hash" && rainbow::parseHashName(value, hash)) {}
+        else if (option == "--charset" && rainbow::parseCharsetName(value, charset)) {}
+        else {
+            std::cerr << "Unknown option: " << option << " " << value << std::endl;
+            return 1;
+        }
+    }
+
+    rainbow::MappedTable table(input_table_file, passwordLength, nbReduction, hash, charset);
+    const unsigned nbThreads = std::thread::hardware_concurrency();
+    std::cout << "Sampling up to " << nbSamples << " " << rainbow::charsetName(charset) << " passwords of " << passwordLength
+              << " chars against " << table.size() << " " << rainbow::hashName(hash) << " chains of " << nbReduction
+              << " reductions, on " << nbThreads << " threads for at most " << seconds << " seconds (seed " << seed << ")..." << std::endl;
+
+    const CoverageSample sample = sampleCoverage(table.view(), seed, nbSamples, nbThreads, seconds, keepRunning);
+    if (sample.nbSamples == 0) {
+        std::cerr << "No password sampled within the time budget" << std::endl;
+        return 1;
+    }
+
+    const double keyspace = std::pow(static_cast<double>(rainbow::charsetSize(charset)), passwordLength);
+    const double n = sample.nbSamples;
+    std::cout << "Cracked " << sample.nbCracked << " of " << sample.nbSamples << " passwords in "
+              << sample.busyTime << " thread-seconds." << std::endl
+              << std::fixed << std::setprecision(2)
+              << "Coverage: " << 100 * sample.nbCracked / n << "% (model: "
+              << 100 * tableCoverage(keyspace, table.size(), nbReduction) << "%)" << std::endl;
+    printInterval("95%", sample.nbCracked, sample.nbSamples, 1.96);
+    printInterval("99%", sample.nbCracked, sample.nbSamples, 2.576);
+    std::cout << std::defaultfloat << std::setprecision(4)
+              << "Per hash: " << sample.statistics.lookups / n << " lookups, " << sample.statistics.alarms / n
+              << " alarms, of which " << sample.statistics.falseAlarms / n << " false alarms, "
+              << sample.statistics.hashes / n << " hashes, " << 1000 * sample.busyTime / n << " ms of one thread." << std::endl;
+    if (sample.nbCracked > 0) {
+        std::cout << "Per cracked password: " << static_cast<double>(sample.statistics.hashes) / sample.nbCracked
+                  << " hashes, " << 1000 * sample.busyTime / sample.nbCracked << " ms of one thread." << std::endl;
+    }
+    TRACE_EXPORT("estimate_coverage");
+    return 0;
+}
@@ -1,23 +1,53 @@
 #include <iostream>
 #include <chrono>
+#include <string>
 #include "RainbowTable.hpp"
-
-enum LengthEnum {
-    LENGTH_6 = 6,
-    LENGTH_7 = 7,
-    LENGTH_8 = 8,
-    LENGTH_9 = 9,
-    LENGTH_10 = 10
-};
+#include "Trace.hpp"
 
 int main(int argc, char *argv[])
 {
-    if(argc != 4)
+    rainbow::HashAlgorithm hash = rainbow::SHA256;
+    rainbow::CharsetKind charset = rainbow::ALNUM;
+    GenerationSettings settings;
+    bool counters = false;
+
+    // The hash and the charset are positional, the options come after them
+    bool validArguments = argc >= 4;
+    int i = 4;
+    if (validArguments && i < argc && std::string(argv[i]).rfind("--", 0) != 0) {
+        validArguments = rainbow::parseHashName(argv[i++], hash);
+        if (validArguments && i < argc && std::string(argv[i]).rfind("--", 0) != 0) {
+            validArguments = rainbow::parseCharsetName(argv[i++], charset);
+        }
+    }
+    for (; validArguments && i < argc; i += 2) {
+        const std::string option = argv[i];
+        if (i + 1 >= argc) validArguments = false;
+        else if (option == "--progress") settings.reportInterval = std::stod(argv[i + 1]);
+        else if (option == "--metrics") settings.metricsPath = argv[i + 1];
+        else if (option == "--counters" && std::string(argv[i + 1]) == "on") counters = true;
+        else if (option == "--counters" && std::string(argv[i + 1]) == "off") counters = false;
+        else if (option == "--affinity") validArguments = parseAffinity(argv[i + 1], settings.affinity);
+        else if (option == "--hugepages") validArguments = parseHugePages(argv[i + 1], settings.hugePages);
+        else validArguments = false;
+    }
+
+    if(!validArguments)
     {
-        std::cerr << "Usage : \"./generate_table.out length size nbReduction\", where" << std::endl
-            << "- length is the number of chars in an alphanumeric password," << std::endl
+        std::cerr << "Usage : \"./generate_table.out length size nbReduction [hash [charset]] [--progress seconds] [--metrics file] [--counters on|off] [--affinity none|node|core] [--hugepages off|thp|2m|1g]\", where" << std::endl
+            << "- length is the number of chars in a password (1 to 12, 10 for alnum and 9 for printable)," << std::endl
             << "- size is the size of a file in GigaBytes," << std::endl
-            << "- nbReduction is the length of the chain." << std::endl;    
+            << "- nbReduction is the length of the chain," << std::endl
+            << "- hash is the hash function of the table: sha256 (default), sha1, md5 or ntlm," << std::endl
+            << "- charset is the charset of the passwords: alnum (default), lowercase, digits or printable," << std::endl
+            << "- --progress is the number of seconds between two progress reports (5 by default, 0 for the final one only)," << std::endl
+            << "- --metrics is a file the progress reports are appended to, one JSON object per line," << std::endl
+            << "- --counters on prints the hardware counters of the generation, sort and save at the end (IPC," << std::endl
+            << "  cache, branch and TLB misses per hash), as far as the kernel allows them," << std::endl
+            << "- --affinity pins each generation thread to the CPUs of a NUMA node (node, default), to one CPU (core)" << std::endl
+            << "  or not at all (none). A thread writes its own part of the table first, so it lands in local memory," << std::endl
+            << "- --hugepages backs the table with transparent huge pages (thp), 2 MiB or 1 GiB hugetlbfs pages (2m, 1g)" << std::endl
+            << "  or normal pages (off, default), falling back to the next smaller ones; the pages obtained are printed." << std::endl;
         return 1;
     }
 
@@ -32,45 +62,28 @@ int main(int argc, char *argv[])
 
     std::cout << "Program started at: " << std::put_time(&start_tm, "%H:%M:%S") << std::endl;
     std::cout << "Press CTRL+C to stop the program. It will still save the progress." << std::endl;
-    std::cout << "Generate approximately " << size << " GB of rainbow table with " << nbReduction << " reduction for password size " << length << std::endl;
+    std::cout << "Generate approximately " << size << " GB of rainbow table with " << nbReduction << " reduction for password size " << length
+              << " (" << rainbow::hashName(hash) << ", " << rainbow::charsetName(charset) << ")" << std::endl;
+
+    PerfProfile profile(counters);
+    settings.profile = &profile;
 
     std::chrono::time_point<std::chrono::system_clock> start, end;
     start = std::chrono::system_clock::now();
 
-    switch (length) {
-        case LENGTH_6: {
-            RainbowTable<6> rainbow(size, nbReduction);
-            rainbow.generate();
-            break;
-        }
-        case LENGTH_7: {
-            RainbowTable<7> rainbow(size, nbReduction);
-            rainbow.generate();
-            break;
-        }
-        case LENGTH_8: {
-            RainbowTable<8> rainbow(size, nbReduction);
-            rainbow.generate();
-            break;
-        }
-        case LENGTH_9: {
-            RainbowTable<9> rainbow(size, nbReduction);
-            rainbow.generate();
-            break;
-        }
-        case LENGTH_10: {
-            RainbowTable<10> rainbow(size, nbReduction);
-            rainbow.generate();
-            break;
-        }
-        default:
-            std::cerr << "Unsupported length: " << length << std::endl;
-            return 1;
+    if (length < 1 || length > static_cast<int>(rainbow::charsetMaxLength(charset))) {
+        std::cerr << "Unsupported length: " << length << " (at most " << rainbow::charsetMaxLength(charset) << " "
+                  << rainbow::charsetName(charset) << " chars)" << std::endl;
+        return 1;
     }
+    RainbowTable rainbow(length, hash, charset, size, nbReduction, settings);
+    rainbow.generate();
 
     end = std::chrono::system_clock::now();
     std::chrono::duration<double> elapsed_seconds = end - start;
     std::cout << elapsed_seconds.count() << std::endl;
+    profile.print(std::cout);
+    TRACE_EXPORT("generate_table");
 
     return 0;
 }
\ No newline at end of file
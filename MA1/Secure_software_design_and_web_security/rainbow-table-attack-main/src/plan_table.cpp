@@ -0,0 +1,199 @@
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <thread>
+#include <unistd.h>
+
+#include "TablePlanner.hpp"
+
+using std::string;
+
+// Chain lengths tried by the planner
+static const int CHAINLENGTHS[] = {100, 200, 300, 500, 1000, 2000, 3000, 5000, 10000, 20000, 50000};
+
+// Settings whose coverage is this close to the best one are ranked by their crack time instead,
+// and settings whose crack times are this close in ratio by their generation time
+static const double COVERAGETOLERANCE = 0.01;
+static const double CRACKTIMETOLERANCE = 0.05;
+
+static const double bytesPerGB = 1e9;
+static const double bytesPerChain = 2 * sizeof(uint64_t);
+
+struct Candidate {
+    TableSetting setting;
+    TableEstimate estimate;
+    double generationTime; // seconds on all threads
+    double crackTime;      // seconds on one thread, per hash looked up
+};
+
+// Whether a is a better setting than b, when the best coverage of all the settings is bestCoverage
+bool isBetter(const Candidate& a, const Candidate& b, double bestCoverage) {
+    const bool aCovers = a.estimate.coverage >= bestCoverage - COVERAGETOLERANCE;
+    const bool bCovers = b.estimate.coverage >= bestCoverage - COVERAGETOLERANCE;
+    if (aCovers != bCovers) {
+        return aCovers;
+    }
+    if (!aCovers) {
+        return a.estimate.coverage > b.estimate.coverage;
+    }
+    if (std::abs(a.crackTime - b.crackTime) > CRACKTIMETOLERANCE * std::max(a.crackTime, b.crackTime)) {
+        return a.crackTime < b.crackTime;
+    }
+    return a.generationTime < b.generationTime;
+}
+
+string formatDuration(double seconds) {
+    std::ostringstream stream;
+    stream << std::fixed << std::setprecision(1);
+    if (seconds < 1) stream << seconds * 1000 << "ms";
+    else if (seconds < 60) stream << seconds << "s";
+    else if (seconds < 3600) stream << seconds / 60 << "min";
+    else if (seconds < 86400) stream << seconds / 3600 << "h";
+    else stream << seconds / 86400 << "d";
+    return stream.str();
+}
+
+void printCandidate(const Candidate& candidate) {
+    const TableSetting& setting = candidate.setting;
+    const TableEstimate& estimate = candidate.estimate;
+    std::cout << std::setw(7) << setting.chainLength
+              << std::setw(14) << std::setprecision(4) << setting.nbChains
+              << std::setw(7) << setting.nbTables
+              << std::setw(11) << std::setprecision(4) << setting.nbTables * estimate.storedChains * bytesPerChain / bytesPerGB
+              << std::setw(10) << std::fixed << std::setprecision(2) << 100 * estimate.coverage
+              << std::setw(8) << 100 * estimate.mergeRate << std::defaultfloat
+              << std::setw(11) << formatDuration(candidate.generationTime)
+              << std::setw(11) << formatDuration(candidate.crackTime)
+              << std::setw(10) << std::setprecision(3) << estimate.falseAlarms << std::endl;
+}
+
+int main(int argc, char const *argv[])
+{
+    if(argc < 4 || argc % 2 != 0)
+    {
+        std::cerr << "Usage : ./plan_table.out password_length [--time seconds] [--disk GB] [--memory GB] [--hash sha256|sha1|md5|ntlm] [--charset alnum|lowercase|digits|printable], where" << std::endl
+            << "- password_length is the number of chars in a password," << std::endl
+            << "- --time is the longest time to generate the tables, in seconds," << std::endl
+            << "- --disk is the largest size of all the tables, in GigaBytes (at least one of --time and --disk is needed)," << std::endl
+            << "- --memory is the largest size of one table, which crack_password.out loads in memory (half the RAM by default)," << std::endl
+            << "- --hash and --charset are those of the tables (sha256 and alnum by default)." << std::endl
+            << "The hash rate of the machine is measured first, then the expected coverage, merge rate, size, generation" << std::endl
+            << "time and crack time of tables of several chain lengths that fit the budget are printed, with the best one." << std::endl;
+        return 1;
+    }
+
+    const int passwordLength = std::stoi(argv[1]);
+    double timeBudget = 0;
+    double diskBudget = 0;
+    double memoryLimit = sysconf(_SC_PHYS_PAGES) * static_cast<double>(sysconf(_SC_PAGESIZE)) / 2 / bytesPerGB;
+    rainbow::HashAlgorithm hash = rainbow::SHA256;
+    rainbow::CharsetKind charset = rainbow::ALNUM;
+    for (int i = 2; i + 1 < argc; i += 2) {
+        const string option = argv[i];
+        const string value = argv[i + 1];
+        if (option == "--time") timeBudget = std::stod(value);
+        else if (option == "--disk") diskBudget = std::stod(value);
+        else if (option == "--memory") memoryLimit = std::stod(value);
+        else if (option == "--hash" && rainbow::parseHashName(value, hash)) {}
+        else if (option == "--charset" && rainbow::parseCharsetName(value, charset)) {}
+        else {
+            std::cerr << "Unknown option: " << option << " " << value << std::endl;
+            return 1;
+        }
+    }
+    if (timeBudget <= 0 && diskBudget <= 0) {
+        std::cerr << "A --time or a --disk budget is needed" << std::endl;
+        return 1;
+    }
+    const int maxLength = rainbow::charsetMaxLength(charset);
+    if (passwordLength < 1 || passwordLength > maxLength) {
+        std::cerr << "Unsupported length: " << passwordLength << " (at most " << maxLength << " "
+                  << rainbow::charsetName(charset) << " chars)" << std::endl;
+        return 1;
+    }
+
+    const unsigned nbThreads = std::thread::hardware_concurrency();
+    const double keyspace = std::pow(static_cast<double>(rainbow::charsetSize(charset)), passwordLength);
+    std::cout << "Calibrating " << rainbow::hashName(hash) << " chains of " << passwordLength << " "
+              << rainbow::charsetName(charset) << " chars on " << nbThreads << (nbThreads > 1 ? " threads..." : " thread...") << std::endl;
+    const double generationRate = measureGenerationRate(passwordLength, hash, charset, nbThreads, 1.0);
+    const double crackRate = measureCrackRate(passwordLength, hash, charset, 1.0);
+    std::cout << "Generation: " << generationRate << " hashes/s on all threads, lookup: " << crackRate
+              << " hashes/s on one thread. Keyspace: " << keyspace << " passwords." << std::endl;
+
+    // For each chain length, the largest number of chains within the budget and every power of 2 below it
+    std::vector<Candidate> candidates;
+    for (int chainLength : CHAINLENGTHS) {
+        double maxChains = INFINITY;
+        if (timeBudget > 0) {
+            maxChains = std::min(maxChains, timeBudget * generationRate / (chainLength + 1));
+        }
+        if (diskBudget > 0) {
+            maxChains = std::min(maxChains, diskBudget * bytesPerGB / bytesPerChain);
+        }
+        std::vector<double> totals{std::floor(maxChains)};
+        for (double total = 1024; total < maxChains; total *= 2) {
+            totals.push_back(total);
+        }
+        for (double total : totals) {
+            if (total < 1) {
+                continue;
+            }
+            // Tables are split so that each one fits in memory
+            Candidate candidate;
+            candidate.setting.chainLength = chainLength;
+            candidate.setting.nbTables = std::max(1.0, std::ceil(total * bytesPerChain / bytesPerGB / memoryLimit));
+            candidate.setting.nbChains = std::floor(total / candidate.setting.nbTables);
+            candidate.estimate = estimateTables(keyspace, candidate.setting);
+            candidate.generationTime = candidate.estimate.generationHashes / generationRate;
+            candidate.crackTime = candidate.estimate.crackHashes / crackRate;
+            candidates.push_back(candidate);
+        }
+    }
+    if (candidates.empty()) {
+        std::cerr << "No table fits in the budget" << std::endl;
+        return 1;
+    }
+
+    double bestCoverage = 0;
+    for (const Candidate& candidate : candidates) {
+        bestCoverage = std::max(bestCoverage, candidate.estimate.coverage);
+    }
+
+    // The best setting of each chain length, then the best of all
+    std::cout << std::endl << "  chain        chains tables  size (GB)  coverage  merges   generate      crack  false alarms" << std::endl
+              << "                 /table                         %       %  all threads   per hash      per hash" << std::endl;
+    const Candidate* best = nullptr;
+    for (int chainLength : CHAINLENGTHS) {
+        const Candidate* bestOfLength = nullptr;
+        for (const Candidate& candidate : candidates) {
+            if (candidate.setting.chainLength == chainLength
+                && (bestOfLength == nullptr || isBetter(candidate, *bestOfLength, bestCoverage))) {
+                bestOfLength = &candidate;
+            }
+        }
+        if (bestOfLength == nullptr) {
+            continue;
+        }
+        printCandidate(*bestOfLength);
+        if (best == nullptr || isBetter(*bestOfLength, *best, bestCoverage)) {
+            best = bestOfLength;
+        }
+    }
+
+    const TableSetting& setting = best->setting;
+    std::cout << std::endl << "Recommended: " << setting.nbTables << " table" << (setting.nbTables > 1 ? "s" : "")
+              << " of " << setting.nbChains << " chains of " << setting.chainLength << " reductions, "
+              << std::fixed << std::setprecision(2) << 100 * best->estimate.coverage << std::defaultfloat
+              << "% of the keyspace:" << std::endl
+              << "    ./generate_table.out " << passwordLength << " " << setting.nbChains * bytesPerChain / bytesPerGB
+              << " " << setting.chainLength << " " << rainbow::hashName(hash) << " " << rainbow::charsetName(charset) << std::endl;
+    if (setting.nbTables > 1) {
+        std::cout << "Run it " << setting.nbTables << " times, renaming the table between the runs (they get the same name)."
+                  << " The tables share their reduction functions, so their coverage is an upper bound." << std::endl;
+    }
+    return 0;
+}
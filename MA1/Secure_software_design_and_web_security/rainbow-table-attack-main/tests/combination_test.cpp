@@ -0,0 +1,110 @@
+#include <iostream>
+#include <vector>
+#include <utility>
+#include <stdexcept>
+
+#include "../misc/combination.hpp"
+
+using namespace rainbow;
+
+static int nbFailures = 0;
+
+static void expect(bool condition, const char* what, std::size_t n, std::size_t k, std::size_t i = 0) {
+    if (!condition) {
+        std::cerr << "FAILED: " << what << " (n = " << n << ", k = " << k << ", i = " << i << ")" << std::endl;
+        nbFailures++;
+    }
+}
+
+// Every k-combination of n objects in lexical order, by counting over the subsets of n bits
+template<std::size_t N, std::size_t K>
+std::vector<Combination<N>> enumerate() {
+    std::vector<Combination<N>> combinations;
+    for (unsigned long subset = 0; subset < (1ul << N); subset++) {
+        if (static_cast<std::size_t>(__builtin_popcountl(subset)) != K) {
+            continue;
+        }
+        Combination<N> comb {};
+        for (std::size_t position = 0; position < N; position++) {
+            comb[position] = (subset >> (N - 1 - position)) & 1;
+        }
+        combinations.push_back(comb);
+    }
+    return combinations;
+}
+
+// Checks next, pick, rank, unrank and seek of KCombinationGenerator<N, K> against enumerate
+template<std::size_t N, std::size_t K>
+void checkGenerator() {
+    using Generator = KCombinationGenerator<N, K>;
+    const std::vector<Combination<N>> expected = enumerate<N, K>();
+    expect(expected.size() == binom<std::size_t>(N, K), "binom", N, K);
+
+    if constexpr (K > 0) { // next() does not support K = 0 yet
+        Generator generator;
+        std::vector<Combination<N>> generated;
+        for (auto it = generator.begin(); it != generator.end() && generated.size() <= expected.size(); ++it) {
+            generated.push_back(*it);
+        }
+        expect(generated == expected, "next", N, K);
+
+        // from a few start indices, including (n k) where nothing is left
+        for (std::size_t start = 0; start <= expected.size(); start += 1 + expected.size() / 7) {
+            Generator seeked;
+            seeked.seek(start);
+            std::size_t i = start;
+            for (auto it = seeked.begin(); it != seeked.end() && i <= expected.size(); ++it, i++) {
+                expect(i < expected.size() && *it == expected[i], "seek", N, K, start);
+            }
+            expect(i == expected.size(), "seek end", N, K, start);
+        }
+    }
+
+    Generator generator;
+    for (std::size_t i = 0; i < expected.size(); i++) {
+        expect(generator.pick(i) == expected[i], "pick", N, K, i);
+        expect(Generator::rank(expected[i]) == i, "rank", N, K, i);
+        expect(Generator::rank(Generator::unrank(i)) == i, "unrank", N, K, i);
+    }
+
+    bool thrown = false;
+    try {
+        generator.pick(expected.size());
+    } catch (const std::out_of_range&) {
+        thrown = true;
+    }
+    expect(thrown, "pick out of range", N, K);
+}
+
+template<std::size_t N, std::size_t... K>
+void checkGenerators(std::index_sequence<K...>) {
+    (checkGenerator<N, K>(), ...);
+}
+
+// The binomial coefficients are computed at compile time, and saturate once they overflow
+constexpr BinomialTable<70> binomials {};
+static_assert(binomials(64, 32) == 1832624140942590534ull, "(64 32)");
+static_assert(binomials(67, 33) == 14226520737620288370ull, "(67 33), the largest exact one");
+static_assert(binomials(70, 35) == std::numeric_limits<std::size_t>::max(), "(70 35) saturates");
+static_assert(binom<std::size_t>(64, 32) == 1832624140942590534ull, "binom");
+
+int main() {
+    checkGenerators<1>(std::make_index_sequence<2>());
+    checkGenerators<5>(std::make_index_sequence<6>());
+    checkGenerators<8>(std::make_index_sequence<9>());
+    checkGenerators<12>(std::make_index_sequence<13>());
+
+    PascalTriangle<std::size_t> triangle(40);
+    for (std::size_t n = 0; n <= 40; n++) {
+        for (std::size_t k = 0; k <= n; k++) {
+            expect(triangle(n, k) == binomials(n, k) && binom(n, k) == binomials(n, k), "PascalTriangle", n, k);
+        }
+    }
+
+    if (nbFailures > 0) {
+        std::cerr << nbFailures << " checks failed." << std::endl;
+        return 1;
+    }
+    std::cout << "combination: all checks passed." << std::endl;
+    return 0;
+}
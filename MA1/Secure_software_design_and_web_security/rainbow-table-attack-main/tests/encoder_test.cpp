@@ -0,0 +1,192 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <random>
+#include <stdexcept>
+#include <cstdint>
+#include <cstring>
+
+#include "../utils/6bits-encoder.hpp"
+
+static int nbFailures = 0;
+
+static void expect(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "FAILED: " << what << std::endl;
+        nbFailures++;
+    }
+}
+
+static const char SYMBOLS[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+
+// Chars that are not in SYMBOLS, around its ranges and outside ASCII
+static const unsigned char INVALID[] = {0, ' ', '/', ':', '@', '[', '`', '{', 0x7f, 0x80, 0xc3, 0xff};
+
+static const size_t COUNTS[] = {1, 3, 7, 33, 65};
+
+// The strides of a batch of passwords of length chars: packed, padded by an odd number of bytes, and null terminated
+static std::vector<size_t> strides(size_t length) {
+    return {length, length + 1, length + 3, 17};
+}
+
+static std::string where(size_t length, size_t count, size_t stride) {
+    return " (length " + std::to_string(length) + ", count " + std::to_string(count) + ", stride " + std::to_string(stride) + ")";
+}
+
+// Number of std::invalid_argument thrown by call
+template<class Function>
+static int nbThrown(Function call) {
+    try {
+        call();
+    } catch (const std::invalid_argument&) {
+        return 1;
+    }
+    return 0;
+}
+
+// The batches give the passwords of the scalar functions, whatever the bytes between them, and leave those bytes as
+// they are. The input buffer is exactly as large as the batch, for -fsanitize=address to catch a read past it.
+static void checkRoundTrip(std::mt19937_64& generator) {
+    for (size_t length = 1; length <= 10; length++) {
+        for (size_t count : COUNTS) {
+            for (size_t stride : strides(length)) {
+                const std::string context = where(length, count, stride);
+                std::vector<char> input((count - 1) * stride + length);
+                for (size_t i = 0; i < input.size(); i++) {
+                    input[i] = static_cast<char>(generator()); // the bytes between the passwords
+                }
+                for (size_t i = 0; i < count; i++) {
+                    for (size_t k = 0; k < length; k++) {
+                        input[i * stride + k] = SYMBOLS[generator() % 62];
+                    }
+                }
+
+                std::vector<uint64_t> encoded(count);
+                if (nbThrown([&] { encodeStringsToUint64(input.data(), stride, length, count, encoded.data()); }) != 0) {
+                    expect(false, "valid batch rejected" + context);
+                    continue;
+                }
+                bool same = true;
+                for (size_t i = 0; i < count; i++) {
+                    same = same && encoded[i] == encodeStringToUint64(&input[i * stride], length);
+                }
+                expect(same, "batch encoding differs from encodeStringToUint64" + context);
+
+                std::vector<char> output(input.size(), '#');
+                if (nbThrown([&] { decodeUint64ToStrings(encoded.data(), count, length, output.data(), stride); }) != 0) {
+                    expect(false, "valid codes rejected" + context);
+                    continue;
+                }
+                bool decoded = true;
+                bool untouched = true;
+                char password[10];
+                for (size_t i = 0; i < count; i++) {
+                    decodeUint64ToString(encoded[i], length, password);
+                    decoded = decoded && std::memcmp(&output[i * stride], password, length) == 0;
+                    for (size_t k = length; k < stride && i + 1 < count; k++) {
+                        untouched = untouched && output[i * stride + k] == '#';
+                    }
+                }
+                expect(decoded, "batch decoding differs from decodeUint64ToString" + context);
+                expect(untouched, "batch decoding wrote between the passwords" + context);
+            }
+        }
+    }
+}
+
+// Every invalid char, at any position of any password, makes the batch throw once, however many there are
+static void checkInvalidChars(std::mt19937_64& generator) {
+    for (size_t length = 1; length <= 10; length++) {
+        for (size_t count : COUNTS) {
+            const size_t stride = length + 1;
+            const std::string context = where(length, count, stride);
+            std::vector<char> input((count - 1) * stride + length);
+            for (size_t i = 0; i < input.size(); i++) {
+                input[i] = SYMBOLS[generator() % 62];
+            }
+            std::vector<uint64_t> encoded(count);
+            expect(nbThrown([&] { encodeStringsToUint64(input.data(), stride, length, count, encoded.data()); }) == 0,
+                   "valid batch rejected" + context);
+
+            bool reported = true;
+            for (size_t i : {size_t(0), count / 2, count - 1}) {
+                for (size_t k = 0; k < length; k++) {
+                    for (unsigned char invalid : INVALID) {
+                        const char saved = input[i * stride + k];
+                        input[i * stride + k] = static_cast<char>(invalid);
+                        reported = reported
+                                   && nbThrown([&] { encodeStringToUint64(&input[i * stride], length); }) == 1
+                                   && nbThrown([&] { encodeStringsToUint64(input.data(), stride, length, count, encoded.data()); }) == 1;
+                        input[i * stride + k] = saved;
+                    }
+                }
+            }
+            expect(reported, "invalid char not reported" + context);
+
+            // one in every password, reported by a single exception
+            for (size_t i = 0; i < count; i++) {
+                input[i * stride + i % length] = '-';
+            }
+            expect(nbThrown([&] { encodeStringsToUint64(input.data(), stride, length, count, encoded.data()); }) == 1,
+                   "invalid chars of a batch not reported once" + context);
+        }
+    }
+}
+
+// Codes 62 and 63, at any position of any password, make the batch throw once. The bits above the length chars are
+// ignored, as the scalar decoder does.
+static void checkInvalidCodes(std::mt19937_64& generator) {
+    for (size_t length = 1; length <= 10; length++) {
+        for (size_t count : COUNTS) {
+            const size_t stride = length;
+            const std::string context = where(length, count, stride);
+            std::vector<uint64_t> encoded(count);
+            for (size_t i = 0; i < count; i++) {
+                uint64_t value = generator() << (6 * length); // garbage above the password
+                for (size_t k = 0; k < length; k++) {
+                    value |= uint64_t(generator() % 62) << (6 * k);
+                }
+                encoded[i] = value;
+            }
+            std::vector<char> output(count * stride);
+            expect(nbThrown([&] { decodeUint64ToStrings(encoded.data(), count, length, output.data(), stride); }) == 0,
+                   "valid codes rejected" + context);
+
+            bool reported = true;
+            char password[10];
+            for (size_t i : {size_t(0), count / 2, count - 1}) {
+                for (size_t k = 0; k < length; k++) {
+                    for (uint64_t code : {62, 63}) {
+                        const uint64_t saved = encoded[i];
+                        encoded[i] = (saved & ~(uint64_t(63) << (6 * k))) | (code << (6 * k));
+                        reported = reported
+                                   && nbThrown([&] { decodeUint64ToString(encoded[i], length, password); }) == 1
+                                   && nbThrown([&] { decodeUint64ToStrings(encoded.data(), count, length, output.data(), stride); }) == 1;
+                        encoded[i] = saved;
+                    }
+                }
+            }
+            expect(reported, "invalid code not reported" + context);
+
+            for (size_t i = 0; i < count; i++) {
+                encoded[i] |= uint64_t(63) << (6 * (i % length));
+            }
+            expect(nbThrown([&] { decodeUint64ToStrings(encoded.data(), count, length, output.data(), stride); }) == 1,
+                   "invalid codes of a batch not reported once" + context);
+        }
+    }
+}
+
+int main() {
+    std::mt19937_64 generator(0);
+    checkRoundTrip(generator);
+    checkInvalidChars(generator);
+    checkInvalidCodes(generator);
+
+    if (nbFailures > 0) {
+        std::cerr << nbFailures << " checks failed." << std::endl;
+        return 1;
+    }
+    std::cout << "6bits-encoder: all checks passed." << std::endl;
+    return 0;
+}
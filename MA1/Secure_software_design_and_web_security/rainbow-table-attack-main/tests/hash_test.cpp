@@ -0,0 +1,299 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <random>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+#include "../src/HashPolicy.hpp"
+#include "../utils/sha256.h"
+
+static int nbFailures = 0;
+
+static void expect(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "FAILED: " << what << std::endl;
+        nbFailures++;
+    }
+}
+
+static std::string toHex(const unsigned char* digest, size_t size) {
+    static const char HEX[] = "0123456789abcdef";
+    std::string hex;
+    for (size_t i = 0; i < size; i++) {
+        hex += HEX[digest[i] >> 4];
+        hex += HEX[digest[i] & 15];
+    }
+    return hex;
+}
+
+static uint32_t rotl(uint32_t x, unsigned c) {
+    return (x << c) | (x >> (32 - c));
+}
+
+// Straightforward one-message implementations of the RFC, for messages of any length, to check the kernels against
+
+// The message padded to whole blocks of 64 bytes, with its length in bits in the last 8 bytes
+static std::vector<unsigned char> pad(const std::string& message, bool bigEndian) {
+    std::vector<unsigned char> padded(message.begin(), message.end());
+    padded.push_back(0x80);
+    while (padded.size() % 64 != 56) {
+        padded.push_back(0);
+    }
+    const uint64_t bits = 8 * uint64_t(message.size());
+    for (int i = 0; i < 8; i++) {
+        padded.push_back(static_cast<unsigned char>(bits >> (8 * (bigEndian ? 7 - i : i))));
+    }
+    return padded;
+}
+
+static uint32_t loadLittle(const unsigned char* p) {
+    return uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24;
+}
+
+static uint32_t loadBig(const unsigned char* p) {
+    return uint32_t(p[0]) << 24 | uint32_t(p[1]) << 16 | uint32_t(p[2]) << 8 | uint32_t(p[3]);
+}
+
+static std::string storeLittle(const uint32_t* words, size_t count) {
+    std::string digest;
+    for (size_t i = 0; i < count; i++) {
+        for (int k = 0; k < 4; k++) {
+            digest += static_cast<char>(words[i] >> (8 * k));
+        }
+    }
+    return digest;
+}
+
+static std::string referenceMd4(const std::string& message) {
+    static const unsigned ORDER[3][16] = {
+        {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+        {0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15},
+        {0, 8, 4, 12, 2, 10, 6, 14, 1, 9, 5, 13, 3, 11, 7, 15}
+    };
+    static const unsigned SHIFTS[3][4] = {{3, 7, 11, 19}, {3, 5, 9, 13}, {3, 9, 11, 15}};
+    static const uint32_t CONSTANTS[3] = {0, 0x5a827999, 0x6ed9eba1};
+
+    uint32_t h[4] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476};
+    const std::vector<unsigned char> padded = pad(message, false);
+    for (size_t block = 0; block < padded.size(); block += 64) {
+        uint32_t x[16];
+        for (int i = 0; i < 16; i++) {
+            x[i] = loadLittle(&padded[block + 4 * i]);
+        }
+        uint32_t v[4] = {h[0], h[1], h[2], h[3]};
+        for (int round = 0; round < 3; round++) {
+            for (int i = 0; i < 16; i++) {
+                // v[a], v[b], v[c], v[d] rotate right by one word every step
+                const int a = (16 - i) % 4, b = (17 - i) % 4, c = (18 - i) % 4, d = (19 - i) % 4;
+                uint32_t f;
+                if (round == 0) {
+                    f = (v[b] & v[c]) | (~v[b] & v[d]);
+                } else if (round == 1) {
+                    f = (v[b] & v[c]) | (v[b] & v[d]) | (v[c] & v[d]);
+                } else {
+                    f = v[b] ^ v[c] ^ v[d];
+                }
+                v[a] = rotl(v[a] + f + x[ORDER[round][i]] + CONSTANTS[round], SHIFTS[round][i % 4]);
+            }
+        }
+        for (int i = 0; i < 4; i++) {
+            h[i] += v[i];
+        }
+    }
+    return storeLittle(h, 4);
+}
+
+// MD4 of the password as UTF-16LE, each byte being a code unit
+static std::string referenceNtlm(const std::string& password) {
+    std::string utf16;
+    for (char c : password) {
+        utf16 += c;
+        utf16 += '\0';
+    }
+    return referenceMd4(utf16);
+}
+
+static std::string referenceMd5(const std::string& message) {
+    static const unsigned SHIFTS[4][4] = {{7, 12, 17, 22}, {5, 9, 14, 20}, {4, 11, 16, 23}, {6, 10, 15, 21}};
+    uint32_t constants[64];
+    for (int i = 0; i < 64; i++) {
+        constants[i] = static_cast<uint32_t>(std::fabs(std::sin(i + 1.0)) * 4294967296.0);
+    }
+
+    uint32_t h[4] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476};
+    const std::vector<unsigned char> padded = pad(message, false);
+    for (size_t block = 0; block < padded.size(); block += 64) {
+        uint32_t x[16];
+        for (int i = 0; i < 16; i++) {
+            x[i] = loadLittle(&padded[block + 4 * i]);
+        }
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3];
+        for (int i = 0; i < 64; i++) {
+            uint32_t f;
+            int g;
+            if (i < 16) {
+                f = (b & c) | (~b & d);
+                g = i;
+            } else if (i < 32) {
+                f = (d & b) | (~d & c);
+                g = (5 * i + 1) % 16;
+            } else if (i < 48) {
+                f = b ^ c ^ d;
+                g = (3 * i + 5) % 16;
+            } else {
+                f = c ^ (b | ~d);
+                g = (7 * i) % 16;
+            }
+            const uint32_t next = b + rotl(a + f + constants[i] + x[g], SHIFTS[i / 16][i % 4]);
+            a = d;
+            d = c;
+            c = b;
+            b = next;
+        }
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+    }
+    return storeLittle(h, 4);
+}
+
+static std::string referenceSha1(const std::string& message) {
+    uint32_t h[5] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0};
+    const std::vector<unsigned char> padded = pad(message, true);
+    for (size_t block = 0; block < padded.size(); block += 64) {
+        uint32_t w[80];
+        for (int i = 0; i < 16; i++) {
+            w[i] = loadBig(&padded[block + 4 * i]);
+        }
+        for (int i = 16; i < 80; i++) {
+            w[i] = rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        }
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i = 0; i < 80; i++) {
+            uint32_t f, k;
+            if (i < 20) {
+                f = (b & c) | (~b & d);
+                k = 0x5a827999;
+            } else if (i < 40) {
+                f = b ^ c ^ d;
+                k = 0x6ed9eba1;
+            } else if (i < 60) {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8f1bbcdc;
+            } else {
+                f = b ^ c ^ d;
+                k = 0xca62c1d6;
+            }
+            const uint32_t next = rotl(a, 5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = rotl(b, 30);
+            b = a;
+            a = next;
+        }
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+    }
+    std::string digest;
+    for (uint32_t word : h) {
+        for (int k = 3; k >= 0; k--) {
+            digest += static_cast<char>(word >> (8 * k));
+        }
+    }
+    return digest;
+}
+
+static std::string referenceSha256(const std::string& message) {
+    SHA256 sha;
+    sha.add(message.data(), message.size());
+    unsigned char digest[SHA256::HashBytes];
+    sha.getHash(digest);
+    return std::string(reinterpret_cast<char*>(digest), sizeof(digest));
+}
+
+// The digest of a single message by Policy::hashBatch, in hex
+template<class Policy>
+static std::string hashOne(const std::string& message) {
+    unsigned char digest[Policy::DIGESTSIZE];
+    Policy::hashBatch(message.data(), message.size(), message.size(), 1, digest);
+    return toHex(digest, Policy::DIGESTSIZE);
+}
+
+// The vectors of RFC 1320, RFC 1321, FIPS 180 and the NTLM hashes of well-known passwords
+static void checkKnownAnswers() {
+    expect(hashOne<NtlmPolicy>("") == "31d6cfe0d16ae931b73c59d7e0c089c0", "NTLM(\"\")");
+    expect(hashOne<NtlmPolicy>("password") == "8846f7eaee8fb117ad06bdd830b7586c", "NTLM(\"password\")");
+    expect(hashOne<NtlmPolicy>("123456") == "32ed87bdb5fdc5e9cba88547376818d4", "NTLM(\"123456\")");
+    expect(toHex(reinterpret_cast<const unsigned char*>(referenceMd4("").data()), 16) == "31d6cfe0d16ae931b73c59d7e0c089c0",
+           "reference MD4(\"\")");
+    expect(toHex(reinterpret_cast<const unsigned char*>(referenceMd4("abc").data()), 16) == "a448017aaf21d8525fc10ae87aa6729d",
+           "reference MD4(\"abc\")");
+    expect(toHex(reinterpret_cast<const unsigned char*>(referenceMd4("message digest").data()), 16)
+           == "d9130a8164549fe818874806e1c7014b", "reference MD4(\"message digest\")");
+
+    expect(hashOne<Md5Policy>("") == "d41d8cd98f00b204e9800998ecf8427e", "MD5(\"\")");
+    expect(hashOne<Md5Policy>("abc") == "900150983cd24fb0d6963f7d28e17f72", "MD5(\"abc\")");
+    expect(hashOne<Md5Policy>("message digest") == "f96b697d7cb7938d525a2f31aaf161d0", "MD5(\"message digest\")");
+
+    expect(hashOne<Sha1Policy>("") == "da39a3ee5e6b4b0d3255bfef95601890afd80709", "SHA-1(\"\")");
+    expect(hashOne<Sha1Policy>("abc") == "a9993e364706816aba3e25717850c26c9cd0d89d", "SHA-1(\"abc\")");
+
+    expect(hashOne<Sha256Policy>("") == "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855", "SHA-256(\"\")");
+    expect(hashOne<Sha256Policy>("abc") == "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad", "SHA-256(\"abc\")");
+}
+
+// Counts around the 8 lanes of the kernels: partial groups alone, full groups, and full groups followed by partial ones
+static const size_t COUNTS[] = {1, 3, 7, 8, 9, 16, 17, 23};
+
+// Every message of batches of every length up to maxLength, stored every stride bytes with random bytes between them,
+// hashes as the reference does. The buffers are exactly as large as the batches, for -fsanitize=address to catch the
+// lanes of a partial group reading or writing past them.
+template<class Policy>
+static void checkBatches(const std::string& name, std::string (*reference)(const std::string&), size_t maxLength,
+                         std::mt19937_64& generator) {
+    for (size_t length = 0; length <= maxLength; length++) {
+        for (size_t count : COUNTS) {
+            for (size_t stride : {length, length + 3}) {
+                std::vector<char> messages(std::max<size_t>((count - 1) * stride + length, 1)); // one byte with length 0
+                for (char& byte : messages) {
+                    byte = static_cast<char>(generator());
+                }
+                std::vector<unsigned char> digests(count * Policy::DIGESTSIZE);
+                Policy::hashBatch(messages.data(), stride, length, count, digests.data());
+
+                bool same = true;
+                for (size_t i = 0; i < count; i++) {
+                    const std::string expected = reference(std::string(&messages[i * stride], length));
+                    same = same && std::memcmp(&digests[i * Policy::DIGESTSIZE], expected.data(), Policy::DIGESTSIZE) == 0;
+                }
+                expect(same, name + " batch differs from the reference (length " + std::to_string(length) + ", count "
+                             + std::to_string(count) + ", stride " + std::to_string(stride) + ")");
+            }
+        }
+    }
+}
+
+int main() {
+    checkKnownAnswers();
+
+    // the kernels hash single blocks: 55 bytes at most, 27 chars for NTLM
+    std::mt19937_64 generator(0);
+    checkBatches<Sha256Policy>("SHA-256", referenceSha256, 55, generator);
+    checkBatches<Sha1Policy>("SHA-1", referenceSha1, 55, generator);
+    checkBatches<Md5Policy>("MD5", referenceMd5, 55, generator);
+    checkBatches<NtlmPolicy>("NTLM", referenceNtlm, 27, generator);
+
+    if (nbFailures > 0) {
+        std::cerr << nbFailures << " checks failed." << std::endl;
+        return 1;
+    }
+    std::cout << "hash policies: all checks passed." << std::endl;
+    return 0;
+}
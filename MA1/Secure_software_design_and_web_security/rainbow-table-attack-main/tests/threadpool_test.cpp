@@ -0,0 +1,376 @@
+#include <iostream>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <stdexcept>
+#include <memory>
+#include <future>
+#include <cstdlib>
+#include <cstdint>
+
+#include "../misc/threadpool.hpp"
+
+static std::atomic<int> nbFailures(0); // expect is also called by the workers
+
+// Allocations of the calling thread, to tell a task stored in place from a task stored on the heap
+static thread_local uint64_t heapAllocations = 0;
+
+__attribute__((noinline)) void* operator new(size_t size) {
+    heapAllocations++;
+    if (void* pointer = std::malloc(size == 0 ? 1 : size)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void operator delete(void* pointer) noexcept {
+    std::free(pointer);
+}
+
+__attribute__((noinline)) void operator delete(void* pointer, size_t) noexcept {
+    std::free(pointer);
+}
+
+static void expect(bool condition, const char* what) {
+    if (!condition) {
+        std::cerr << "FAILED: " << what << std::endl;
+        nbFailures++;
+    }
+}
+
+// Every index is done once, by chunks of at most grain indices, also from a task of the pool
+static void checkCoverage() {
+    ThreadPool pool(4);
+    for (size_t grain : {1, 7, 1000, 100000}) {
+        std::vector<int> counts(50000, 0);
+        pool.parallel_for(0, counts.size(), grain, [&](size_t first, size_t last) {
+            expect(last - first <= grain, "chunk larger than grain");
+            for (size_t i = first; i < last; i++) {
+                counts[i]++;
+            }
+        });
+        bool once = true;
+        for (int count : counts) {
+            once = once && count == 1;
+        }
+        expect(once, "index not done exactly once");
+    }
+
+    std::atomic<size_t> sum(0);
+    pool.parallel_for(0, 64, 1, [&](size_t, size_t) {
+        pool.parallel_for(0, 100, 7, [&](size_t first, size_t last) { sum += last - first; });
+    });
+    expect(sum == 6400, "nested parallel_for");
+}
+
+// The first exception thrown by a chunk is rethrown to the caller
+static void checkException() {
+    ThreadPool pool(4);
+    bool thrown = false;
+    try {
+        pool.parallel_for(0, 1000, 10, [](size_t first, size_t) {
+            if (first == 500) {
+                throw std::runtime_error("chunk 50");
+            }
+        });
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    expect(thrown, "exception not rethrown");
+}
+
+// parallel_for returns when the pool is stopped while range tasks are still queued, from outside the pool
+// and from a task of the pool
+static void checkStop() {
+    for (int round = 0; round < 50; round++) {
+        ThreadPool pool(4);
+        std::thread stopper([&pool, round] {
+            std::this_thread::sleep_for(std::chrono::microseconds(round * 37 % 500));
+            pool.stop();
+        });
+        std::vector<int> data(1 << 13);
+        try {
+            pool.parallel_for(0, data.size(), 16, [&](size_t first, size_t last) {
+                for (size_t i = first; i < last; i++) {
+                    data[i]++;
+                }
+                std::this_thread::sleep_for(std::chrono::microseconds(5));
+            });
+        } catch (const std::runtime_error&) {
+            // stopped before the call
+        }
+        stopper.join();
+
+        ThreadPool nested(2);
+        std::atomic<bool> started(false);
+        std::atomic<bool> returned(false);
+        nested.submit([&] {
+            started = true;
+            try {
+                nested.parallel_for(0, 4096, 1, [](size_t, size_t) {
+                    std::this_thread::sleep_for(std::chrono::microseconds(20));
+                });
+            } catch (const std::runtime_error&) {
+            }
+            returned = true;
+        });
+        while (!started.load()) {
+            std::this_thread::yield();
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(round * 11 % 300));
+        nested.stop();
+        expect(returned.load(), "parallel_for of a task did not return after stop");
+    }
+}
+
+// Waits until done is true, for at most a few seconds. Returns done.
+static bool waitFor(const std::atomic<bool>& done) {
+    for (int i = 0; i < 5000 && !done.load(); i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return done.load();
+}
+
+// wait_idle waits for the tasks and the tasks they submit, returns once the pool is stopped, and throws from a task
+static void checkWaitIdle() {
+    ThreadPool pool(4);
+    std::atomic<int> count(0);
+    for (int i = 0; i < 100; i++) {
+        pool.submit([&] {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+            pool.submit([&] { count++; });
+            count++;
+        });
+    }
+    pool.wait_idle();
+    expect(count == 200, "wait_idle returned before every task was done");
+
+    std::atomic<bool> thrown(false);
+    pool.submit([&] {
+        try {
+            pool.wait_idle();
+        } catch (const std::runtime_error&) {
+            thrown = true;
+        }
+    });
+    pool.wait_idle();
+    expect(thrown.load(), "wait_idle from a task did not throw");
+
+    // a task that blocks the only worker, and a task queued behind it that will never run
+    ThreadPool blocked(1);
+    std::atomic<bool> release(false);
+    std::atomic<bool> waited(false);
+    blocked.submit([&] {
+        while (!release.load()) {
+            std::this_thread::yield();
+        }
+    });
+    blocked.submit([] {});
+    std::thread waiter([&] {
+        blocked.wait_idle();
+        waited = true;
+    });
+    std::thread stopper([&] { blocked.stop(); });
+    expect(waitFor(waited), "wait_idle did not return after stop");
+    release = true;
+    stopper.join();
+    waiter.join();
+}
+
+// join runs every queued task before it stops the pool, and throws from a task
+static void checkJoin() {
+    ThreadPool pool(2);
+    std::atomic<int> count(0);
+    for (int i = 0; i < 1000; i++) {
+        pool.submit([&] {
+            std::this_thread::sleep_for(std::chrono::microseconds(10));
+            count++;
+        });
+    }
+    std::atomic<bool> thrown(false);
+    pool.submit([&] {
+        try {
+            pool.join();
+        } catch (const std::runtime_error&) {
+            thrown = true;
+        }
+    });
+    pool.join();
+    expect(count == 1000, "join did not run every queued task");
+    expect(pool.stopped(), "join did not stop the pool");
+    expect(thrown.load(), "join from a task did not throw");
+}
+
+// stop from a worker, and the destructor run by a task of the pool, do not end the program
+static void checkStopFromTask() {
+    for (int round = 0; round < 20; round++) {
+        ThreadPool pool(3);
+        std::atomic<bool> stopped(false);
+        for (int i = 0; i < 100; i++) {
+            pool.submit([] { std::this_thread::sleep_for(std::chrono::microseconds(10)); });
+        }
+        pool.submit([&] {
+            pool.stop();
+            stopped = true;
+        });
+        expect(waitFor(stopped), "stop from a task did not return");
+    } // destroyed from the main thread, after a worker stopped it
+
+    for (bool stopOnDeallocation : {false, true}) {
+        for (int round = 0; round < 20; round++) {
+            ThreadPool* pool = new ThreadPool(2, stopOnDeallocation);
+            std::atomic<int> count(0);
+            std::atomic<bool> deleted(false);
+            for (int i = 0; i < 100; i++) {
+                pool->submit([&] {
+                    std::this_thread::sleep_for(std::chrono::microseconds(10));
+                    count++;
+                });
+            }
+            // nobody may use the pool while it is destroyed, not even to return from submit
+            std::atomic<bool> submitted(false);
+            pool->submit([pool, &submitted, &deleted] {
+                while (!submitted.load()) {
+                    std::this_thread::yield();
+                }
+                delete pool;
+                deleted = true;
+            });
+            submitted = true;
+            expect(waitFor(deleted), "destructor run by a task did not return");
+            if (!stopOnDeallocation) {
+                expect(count == 100, "destructor run by a task did not run the queued tasks");
+            }
+        }
+    }
+}
+
+// Counts its live copies, and pads the captures of a task to bytes
+template<size_t bytes>
+struct Tracked {
+    static inline std::atomic<int> live{0};
+    char padding[bytes] = {};
+
+    Tracked() { live++; }
+    Tracked(const Tracked&) noexcept { live++; }
+    ~Tracked() { live--; }
+};
+
+// Small functions are stored in the task, larger ones and the ones that may throw when moved on the heap, and both
+// are run and destroyed once
+static void checkInplaceTask() {
+    std::atomic<int> runs(0);
+    {
+        Tracked<8> small;
+        uint64_t before = heapAllocations;
+        InplaceTask task([small, &runs] { runs++; });
+        expect(heapAllocations == before, "small task allocated");
+        InplaceTask moved(std::move(task));
+        expect(!task && moved, "moved task not left empty");
+        moved();
+        expect(heapAllocations == before, "small task allocated when moved or run");
+    }
+    {
+        Tracked<InplaceTask::CAPACITY> large;
+        uint64_t before = heapAllocations;
+        InplaceTask task([large, &runs] { runs++; });
+        expect(heapAllocations == before + 1, "large task not stored on the heap");
+        InplaceTask moved(std::move(task));
+        expect(heapAllocations == before + 1, "large task reallocated when moved");
+        moved();
+    }
+    {
+        struct ThrowingMove {
+            ThrowingMove() = default;
+            ThrowingMove(const ThrowingMove&) noexcept(false) {}
+        } small;
+        uint64_t before = heapAllocations;
+        InplaceTask task([small, &runs] { runs++; });
+        expect(heapAllocations == before + 1, "task that may throw when moved not stored on the heap");
+        task();
+    }
+    expect(runs == 3, "task not run once");
+    expect(Tracked<8>::live == 0 && Tracked<InplaceTask::CAPACITY>::live == 0, "captures of a task not destroyed");
+}
+
+// Every index of enqueue_n is run once, also with fewer tasks than workers and from a task
+static void checkEnqueueN() {
+    ThreadPool pool(4);
+    for (size_t n : {0, 1, 3, 4, 5, 1000}) {
+        std::vector<std::atomic<int>> counts(n);
+        pool.enqueue_n(n, [&counts](size_t i) { counts[i]++; });
+        pool.wait_idle();
+        bool once = true;
+        for (auto& count : counts) {
+            once = once && count.load() == 1;
+        }
+        expect(once, "index of enqueue_n not run exactly once");
+    }
+
+    std::vector<std::atomic<int>> counts(64 * 8);
+    pool.enqueue_n(8, [&pool, &counts](size_t task) {
+        pool.enqueue_n(64, [&counts, task](size_t i) { counts[task * 64 + i]++; });
+    });
+    pool.wait_idle();
+    bool once = true;
+    for (auto& count : counts) {
+        once = once && count.load() == 1;
+    }
+    expect(once, "index of a nested enqueue_n not run exactly once");
+}
+
+// Submitted tasks with large or move-only captures are run and destroyed, and the futures of enqueue resolve
+static void checkSubmit() {
+    ThreadPool pool(4);
+    std::atomic<int> sum(0);
+    {
+        Tracked<4 * InplaceTask::CAPACITY> large;
+        for (int i = 0; i < 100; i++) {
+            pool.submit([large, &sum] { sum++; });
+            auto owned = std::make_unique<int>(i);
+            pool.submit([owned = std::move(owned), &sum] { sum += *owned; });
+        }
+    }
+    pool.wait_idle();
+    expect(sum == 100 + 4950, "submitted task not run once");
+    expect(Tracked<4 * InplaceTask::CAPACITY>::live == 0, "captures of a submitted task not destroyed");
+
+    std::vector<std::future<int>> futures;
+    for (int i = 0; i < 100; i++) {
+        futures.push_back(pool.enqueue([](int a, int b) { return a * b; }, i, 3));
+    }
+    bool resolved = true;
+    for (int i = 0; i < 100; i++) {
+        resolved = resolved && futures[i].get() == 3 * i;
+    }
+    expect(resolved, "future of enqueue not resolved");
+
+    std::future<void> thrown = pool.enqueue([] { throw std::runtime_error("task"); });
+    bool caught = false;
+    try {
+        thrown.get();
+    } catch (const std::runtime_error&) {
+        caught = true;
+    }
+    expect(caught, "exception of an enqueued task not in its future");
+}
+
+int main() {
+    checkInplaceTask();
+    checkEnqueueN();
+    checkSubmit();
+    checkCoverage();
+    checkException();
+    checkStop();
+    checkWaitIdle();
+    checkJoin();
+    checkStopFromTask();
+
+    if (nbFailures > 0) {
+        std::cerr << nbFailures.load() << " checks failed." << std::endl;
+        return 1;
+    }
+    std::cout << "threadpool: all checks passed." << std::endl;
+    return 0;
+}
@@ -1,16 +1,27 @@
 #include "6bits-encoder.hpp"
 #include <stdexcept>
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#if defined(__BMI2__) && defined(__x86_64__)
+#include <immintrin.h>
+#endif
 
 
 uint64_t encodeStringToUint64(const std::string& input) {
+    return encodeStringToUint64(input.c_str(), input.length());
+}
 
-    if (input.length() < 6 || input.length() > 10) {
-        throw std::invalid_argument("Input string must be between 6 and 10 characters.");
+uint64_t encodeStringToUint64(const char* input, size_t length) {
+
+    if (length < 1 || length > 10) {
+        throw std::invalid_argument("Input string must be between 1 and 10 characters.");
     }
 
     uint64_t result = 0;
 
-    for (size_t i = 0; i < input.length(); ++i) {
+    for (size_t i = 0; i < length; ++i) {
         char c = input[i];
         uint64_t value;
 
@@ -39,11 +50,21 @@ uint64_t encodeStringToUint64(const std::string& input) {
 
 std::string decodeUint64ToString(uint64_t encoded, size_t length) {
 
-    if (length < 6 || length > 10) {
-        throw std::invalid_argument("Length must be between 6 and 10.");
+    if (length < 1 || length > 10) {
+        throw std::invalid_argument("Length must be between 1 and 10.");
     }
 
     std::string result(length, ' ');
+    decodeUint64ToString(encoded, length, &result[0]);
+
+    return result;
+}
+
+void decodeUint64ToString(uint64_t encoded, size_t length, char* result) {
+
+    if (length < 1 || length > 10) {
+        throw std::invalid_argument("Length must be between 1 and 10.");
+    }
 
     for (size_t i = 0; i < length; ++i) {
         uint64_t mask = 0x3F; // Mask to extract 6 bits
@@ -63,6 +84,141 @@ std::string decodeUint64ToString(uint64_t encoded, size_t length) {
             throw std::invalid_argument("Encoded value contains invalid 6-bit segments.");
         }
     }
+}
 
-    return result;
+
+// The batch variants below look the codes up instead of branching, and only check the chars once per batch. With
+// BMI2 (-march=native on x86-64 since Haswell), the first 8 chars of a password are mapped with SSE byte arithmetic
+// and packed with pext, or spread with pdep and mapped back.
+
+static const char SYMBOLS[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+
+// Code of every char, 64 for the chars that are not in SYMBOLS: or-ed over a batch, bit 6 tells if one was invalid
+static constexpr std::array<uint8_t, 256> codeTable() {
+    std::array<uint8_t, 256> table{};
+    for (unsigned c = 0; c < 256; c++) {
+        table[c] = 64;
+    }
+    for (unsigned i = 0; i < 62; i++) {
+        table[static_cast<unsigned char>(SYMBOLS[i])] = i;
+    }
+    return table;
+}
+
+static constexpr std::array<uint8_t, 256> CODES = codeTable();
+
+static void checkLength(size_t length) {
+    if (length < 1 || length > 10) {
+        throw std::invalid_argument("Length must be between 1 and 10.");
+    }
+}
+
+#if defined(__BMI2__) && defined(__x86_64__)
+
+static const uint64_t BYTEBITS = 0x3F3F3F3F3F3F3F3FULL;
+
+// Packs the codes of the first count (at most 8) chars of chars, one per byte, the first in the lowest byte.
+// Sets invalid if one of them is not in SYMBOLS.
+static inline uint64_t encodeChars(uint64_t chars, unsigned count, uint64_t& invalid) {
+    const __m128i c = _mm_cvtsi64_si128(chars);
+    const __m128i above9 = _mm_cmpgt_epi8(c, _mm_set1_epi8('9'));
+    const __m128i aboveZ = _mm_cmpgt_epi8(c, _mm_set1_epi8('Z'));
+    // '0' -> 0, 'A' -> 10, 'a' -> 36
+    __m128i code = _mm_sub_epi8(c, _mm_set1_epi8('0'));
+    code = _mm_sub_epi8(code, _mm_and_si128(above9, _mm_set1_epi8(7)));
+    code = _mm_sub_epi8(code, _mm_and_si128(aboveZ, _mm_set1_epi8(6)));
+
+    const __m128i digit = _mm_andnot_si128(above9, _mm_cmpgt_epi8(c, _mm_set1_epi8('0' - 1)));
+    const __m128i upper = _mm_andnot_si128(aboveZ, _mm_cmpgt_epi8(c, _mm_set1_epi8('A' - 1)));
+    const __m128i lower = _mm_andnot_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('z')), _mm_cmpgt_epi8(c, _mm_set1_epi8('a' - 1)));
+    const unsigned valid = _mm_movemask_epi8(_mm_or_si128(digit, _mm_or_si128(upper, lower)));
+    invalid |= ~valid & ((1u << count) - 1);
+
+    return _pext_u64(_mm_cvtsi128_si64(code), BYTEBITS) & ((uint64_t(1) << (6 * count)) - 1);
+}
+
+// Chars of the first count (at most 8) codes of encoded, one per byte. Sets invalid if one of them is above 61.
+static inline uint64_t decodeChars(uint64_t encoded, unsigned count, uint64_t& invalid) {
+    const __m128i code = _mm_cvtsi64_si128(_pdep_u64(encoded & ((uint64_t(1) << (6 * count)) - 1), BYTEBITS));
+    const __m128i above9 = _mm_cmpgt_epi8(code, _mm_set1_epi8(9));
+    const __m128i above35 = _mm_cmpgt_epi8(code, _mm_set1_epi8(35));
+    __m128i c = _mm_add_epi8(code, _mm_set1_epi8('0'));
+    c = _mm_add_epi8(c, _mm_and_si128(above9, _mm_set1_epi8(7)));
+    c = _mm_add_epi8(c, _mm_and_si128(above35, _mm_set1_epi8(6)));
+    invalid |= _mm_movemask_epi8(_mm_cmpgt_epi8(code, _mm_set1_epi8(61)));
+    return _mm_cvtsi128_si64(c);
+}
+
+#else
+
+static inline uint64_t encodeChars(uint64_t chars, unsigned count, uint64_t& invalid) {
+    uint64_t encoded = 0;
+    for (unsigned i = 0; i < count; i++) {
+        const uint8_t code = CODES[(chars >> (8 * i)) & 0xFF];
+        invalid |= code & 64;
+        encoded |= uint64_t(code & 63) << (6 * i);
+    }
+    return encoded;
+}
+
+static inline uint64_t decodeChars(uint64_t encoded, unsigned count, uint64_t& invalid) {
+    uint64_t chars = 0;
+    for (unsigned i = 0; i < count; i++) {
+        const unsigned code = (encoded >> (6 * i)) & 63;
+        // 62 and 63 carry into bit 6
+        invalid |= (code + 2) & 64;
+        chars |= uint64_t(static_cast<unsigned char>(SYMBOLS[std::min(code, 61u)])) << (8 * i);
+    }
+    return chars;
+}
+
+#endif
+
+void encodeStringsToUint64(const char* input, size_t stride, size_t length, size_t count, uint64_t* output) {
+    checkLength(length);
+    if (count == 0) {
+        return;
+    }
+    const unsigned head = std::min<size_t>(length, 8);
+    // 8 bytes can be read at once from the passwords that are followed by at least 8 - head bytes of the batch
+    const size_t end = (count - 1) * stride + length;
+    uint64_t invalid = 0;
+    for (size_t i = 0; i < count; i++) {
+        const char* password = input + i * stride;
+        uint64_t chars = 0;
+        std::memcpy(&chars, password, i * stride + 8 <= end ? 8 : head);
+        uint64_t encoded = encodeChars(chars, head, invalid);
+        for (size_t k = 8; k < length; k++) {
+            const uint8_t code = CODES[static_cast<unsigned char>(password[k])];
+            invalid |= code & 64;
+            encoded |= uint64_t(code & 63) << (6 * k);
+        }
+        output[i] = encoded;
+    }
+    if (invalid != 0) {
+        throw std::invalid_argument("Input string contains invalid characters. Allowed characters are a-z, A-Z, and 0-9.");
+    }
+}
+
+void decodeUint64ToStrings(const uint64_t* encoded, size_t count, size_t length, char* output, size_t stride) {
+    checkLength(length);
+    if (count == 0) {
+        return;
+    }
+    const unsigned head = std::min<size_t>(length, 8);
+    uint64_t invalid = 0;
+    for (size_t i = 0; i < count; i++) {
+        char* password = output + i * stride;
+        const uint64_t chars = decodeChars(encoded[i], head, invalid);
+        // Not past the password: the bytes between two of them, a null terminator for instance, are left as they are
+        std::memcpy(password, &chars, head);
+        for (size_t k = 8; k < length; k++) {
+            const unsigned code = (encoded[i] >> (6 * k)) & 63;
+            invalid |= (code + 2) & 64;
+            password[k] = SYMBOLS[std::min(code, 61u)];
+        }
+    }
+    if (invalid != 0) {
+        throw std::invalid_argument("Encoded value contains invalid 6-bit segments.");
+    }
 }
@@ -8,8 +8,24 @@
 // Function to encode a string into a uint64_t
 uint64_t encodeStringToUint64(const std::string& input);
 
+// Same as above, for a buffer of length chars that is not null terminated
+uint64_t encodeStringToUint64(const char* input, size_t length);
+
 // Function to decode a uint64_t back into a string
 std::string decodeUint64ToString(uint64_t encoded, size_t length);
 
+// Same as above, writing the length chars into output (no null terminator)
+void decodeUint64ToString(uint64_t encoded, size_t length, char* output);
+
+// Encodes count passwords of length chars (1 to 10), the i-th one starting at input + i * stride, into output[i].
+// The chars are checked once for the whole batch: throws std::invalid_argument if any of them is not in a-z, A-Z
+// or 0-9, output is then left partly written.
+void encodeStringsToUint64(const char* input, size_t stride, size_t length, size_t count, uint64_t* output);
+
+// Decodes encoded[0, count) into passwords of length chars (1 to 10), the i-th one written at output + i * stride
+// (no null terminators). Throws std::invalid_argument once if any 6-bit code is above 61, output is then left partly
+// written.
+void decodeUint64ToStrings(const uint64_t* encoded, size_t count, size_t length, char* output, size_t stride);
+
 
 #endif //INC_6BITS_ENCODER_HPP
@@ -0,0 +1,92 @@
+#ifndef MD4_LANES_HPP
+#define MD4_LANES_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+// Number of messages hashed side by side, as in sha256-lanes.hpp
+static const unsigned MD4_LANES = 8;
+
+namespace md4lanes {
+
+// message word and rotation of each of the 48 steps
+static const unsigned X[48] = {
+    0, 1, 2,  3, 4, 5,  6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+    0, 4, 8, 12, 1, 5,  9, 13, 2, 6, 10, 14, 3, 7, 11, 15,
+    0, 8, 4, 12, 2, 10, 6, 14, 1, 9,  5, 13, 3, 11, 7, 15
+};
+
+static const unsigned S[48] = {
+    3, 7, 11, 19, 3, 7, 11, 19, 3, 7, 11, 19, 3, 7, 11, 19,
+    3, 5,  9, 13, 3, 5,  9, 13, 3, 5,  9, 13, 3, 5,  9, 13,
+    3, 9, 11, 15, 3, 9, 11, 15, 3, 9, 11, 15, 3, 9, 11, 15
+};
+
+static const uint32_t IV[4] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476};
+
+inline uint32_t rotl(uint32_t x, unsigned c)
+{
+    return (x << c) | (x >> (32 - c));
+}
+
+// Hashes MD4_LANES single-block messages of the same length. messages[l] points to the l-th message,
+// digests receives MD4_LANES * 16 bytes. With UTF16LE (NTLM), each byte of the messages is hashed as
+// a UTF-16LE code unit, so length must be <= 27 bytes, and <= 55 bytes otherwise.
+template<bool UTF16LE>
+inline void hashLanes(const char* const* messages, size_t length, unsigned char* digests)
+{
+    uint32_t m[16][MD4_LANES];
+    const size_t size = UTF16LE ? 2 * length : length;
+
+    // build the padded block, one lane at a time, in little endian
+    for (unsigned l = 0; l < MD4_LANES; l++) {
+        unsigned char block[64] = {0};
+        if (UTF16LE) {
+            for (size_t i = 0; i < length; i++)
+                block[2*i] = messages[l][i];
+        } else {
+            std::memcpy(block, messages[l], length);
+        }
+        block[size] = 0x80;
+        uint64_t bits = 8 * (uint64_t)size;
+        for (int i = 0; i < 8; i++)
+            block[56 + i] = (unsigned char)(bits >> (8 * i));
+        for (int i = 0; i < 16; i++)
+            m[i][l] = block[4*i] | ((uint32_t)block[4*i+1] << 8) | ((uint32_t)block[4*i+2] << 16) | ((uint32_t)block[4*i+3] << 24);
+    }
+
+    uint32_t a[MD4_LANES], b[MD4_LANES], c[MD4_LANES], d[MD4_LANES];
+    for (unsigned l = 0; l < MD4_LANES; l++) {
+        a[l] = IV[0]; b[l] = IV[1]; c[l] = IV[2]; d[l] = IV[3];
+    }
+
+    // each step updates a, then the registers rotate: (a, b, c, d) <- (d, a', b, c)
+    for (int i = 0; i < 48; i++) {
+        const int round = i / 16;
+        for (unsigned l = 0; l < MD4_LANES; l++) {
+            uint32_t f;
+            if (round == 0)      f = (b[l] & c[l]) | (~b[l] & d[l]);
+            else if (round == 1) f = (b[l] & c[l]) | (b[l] & d[l]) | (c[l] & d[l]);
+            else                 f = b[l] ^ c[l] ^ d[l];
+            const uint32_t k = round == 0 ? 0 : round == 1 ? 0x5a827999 : 0x6ed9eba1;
+            uint32_t t = rotl(a[l] + f + m[X[i]][l] + k, S[i]);
+            a[l] = d[l]; d[l] = c[l]; c[l] = b[l]; b[l] = t;
+        }
+    }
+
+    for (unsigned l = 0; l < MD4_LANES; l++) {
+        const uint32_t state[4] = {a[l] + IV[0], b[l] + IV[1], c[l] + IV[2], d[l] + IV[3]};
+        unsigned char* out = digests + 16 * l;
+        for (int i = 0; i < 4; i++) {
+            out[4*i]     = (unsigned char)(state[i]);
+            out[4*i + 1] = (unsigned char)(state[i] >> 8);
+            out[4*i + 2] = (unsigned char)(state[i] >> 16);
+            out[4*i + 3] = (unsigned char)(state[i] >> 24);
+        }
+    }
+}
+
+} // namespace md4lanes
+
+#endif // MD4_LANES_HPP
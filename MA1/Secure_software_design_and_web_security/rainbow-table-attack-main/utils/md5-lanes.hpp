@@ -0,0 +1,90 @@
+#ifndef MD5_LANES_HPP
+#define MD5_LANES_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+// Number of messages hashed side by side, as in sha256-lanes.hpp
+static const unsigned MD5_LANES = 8;
+
+namespace md5lanes {
+
+static const uint32_t K[64] = {
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+    0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+    0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+    0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+    0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+    0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+};
+
+static const unsigned S[64] = {
+    7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+    5,  9, 14, 20, 5,  9, 14, 20, 5,  9, 14, 20, 5,  9, 14, 20,
+    4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+    6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21
+};
+
+static const uint32_t IV[4] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476};
+
+inline uint32_t rotl(uint32_t x, unsigned c)
+{
+    return (x << c) | (x >> (32 - c));
+}
+
+// Hashes MD5_LANES single-block messages (length <= 55 bytes) of the same length.
+// messages[l] points to the l-th message, digests receives MD5_LANES * 16 bytes.
+inline void hashLanes(const char* const* messages, size_t length, unsigned char* digests)
+{
+    uint32_t m[16][MD5_LANES];
+
+    // build the padded block, one lane at a time, in little endian
+    for (unsigned l = 0; l < MD5_LANES; l++) {
+        unsigned char block[64] = {0};
+        std::memcpy(block, messages[l], length);
+        block[length] = 0x80;
+        uint64_t bits = 8 * (uint64_t)length;
+        for (int i = 0; i < 8; i++)
+            block[56 + i] = (unsigned char)(bits >> (8 * i));
+        for (int i = 0; i < 16; i++)
+            m[i][l] = block[4*i] | ((uint32_t)block[4*i+1] << 8) | ((uint32_t)block[4*i+2] << 16) | ((uint32_t)block[4*i+3] << 24);
+    }
+
+    uint32_t a[MD5_LANES], b[MD5_LANES], c[MD5_LANES], d[MD5_LANES];
+    for (unsigned l = 0; l < MD5_LANES; l++) {
+        a[l] = IV[0]; b[l] = IV[1]; c[l] = IV[2]; d[l] = IV[3];
+    }
+
+    for (int i = 0; i < 64; i++) {
+        const int round = i / 16;
+        const int g = round == 0 ? i : round == 1 ? (5*i + 1) % 16 : round == 2 ? (3*i + 5) % 16 : (7*i) % 16;
+        for (unsigned l = 0; l < MD5_LANES; l++) {
+            uint32_t f;
+            if (round == 0)      f = (b[l] & c[l]) | (~b[l] & d[l]);
+            else if (round == 1) f = (d[l] & b[l]) | (~d[l] & c[l]);
+            else if (round == 2) f = b[l] ^ c[l] ^ d[l];
+            else                 f = c[l] ^ (b[l] | ~d[l]);
+            f += a[l] + K[i] + m[g][l];
+            a[l] = d[l]; d[l] = c[l]; c[l] = b[l];
+            b[l] = b[l] + rotl(f, S[i]);
+        }
+    }
+
+    for (unsigned l = 0; l < MD5_LANES; l++) {
+        const uint32_t state[4] = {a[l] + IV[0], b[l] + IV[1], c[l] + IV[2], d[l] + IV[3]};
+        unsigned char* out = digests + 16 * l;
+        for (int i = 0; i < 4; i++) {
+            out[4*i]     = (unsigned char)(state[i]);
+            out[4*i + 1] = (unsigned char)(state[i] >> 8);
+            out[4*i + 2] = (unsigned char)(state[i] >> 16);
+            out[4*i + 3] = (unsigned char)(state[i] >> 24);
+        }
+    }
+}
+
+} // namespace md5lanes
+
+#endif // MD5_LANES_HPP
@@ -0,0 +1,74 @@
+#ifndef SHA1_LANES_HPP
+#define SHA1_LANES_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+// Number of messages hashed side by side, as in sha256-lanes.hpp
+static const unsigned SHA1_LANES = 8;
+
+namespace sha1lanes {
+
+static const uint32_t IV[5] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0};
+
+inline uint32_t rotl(uint32_t x, unsigned c)
+{
+    return (x << c) | (x >> (32 - c));
+}
+
+// Hashes SHA1_LANES single-block messages (length <= 55 bytes) of the same length.
+// messages[l] points to the l-th message, digests receives SHA1_LANES * 20 bytes.
+inline void hashLanes(const char* const* messages, size_t length, unsigned char* digests)
+{
+    uint32_t w[80][SHA1_LANES];
+
+    // build the padded block, one lane at a time, in big endian
+    for (unsigned l = 0; l < SHA1_LANES; l++) {
+        unsigned char block[64] = {0};
+        std::memcpy(block, messages[l], length);
+        block[length] = 0x80;
+        uint64_t bits = 8 * (uint64_t)length;
+        for (int i = 0; i < 8; i++)
+            block[63 - i] = (unsigned char)(bits >> (8 * i));
+        for (int i = 0; i < 16; i++)
+            w[i][l] = ((uint32_t)block[4*i] << 24) | ((uint32_t)block[4*i+1] << 16) | ((uint32_t)block[4*i+2] << 8) | block[4*i+3];
+    }
+
+    for (int i = 16; i < 80; i++)
+        for (unsigned l = 0; l < SHA1_LANES; l++)
+            w[i][l] = rotl(w[i-3][l] ^ w[i-8][l] ^ w[i-14][l] ^ w[i-16][l], 1);
+
+    uint32_t a[SHA1_LANES], b[SHA1_LANES], c[SHA1_LANES], d[SHA1_LANES], e[SHA1_LANES];
+    for (unsigned l = 0; l < SHA1_LANES; l++) {
+        a[l] = IV[0]; b[l] = IV[1]; c[l] = IV[2]; d[l] = IV[3]; e[l] = IV[4];
+    }
+
+    for (int i = 0; i < 80; i++) {
+        const int round = i / 20;
+        const uint32_t k = round == 0 ? 0x5a827999 : round == 1 ? 0x6ed9eba1 : round == 2 ? 0x8f1bbcdc : 0xca62c1d6;
+        for (unsigned l = 0; l < SHA1_LANES; l++) {
+            uint32_t f;
+            if (round == 0)      f = (b[l] & c[l]) | (~b[l] & d[l]);
+            else if (round == 2) f = (b[l] & c[l]) | (b[l] & d[l]) | (c[l] & d[l]);
+            else                 f = b[l] ^ c[l] ^ d[l];
+            uint32_t t = rotl(a[l], 5) + f + e[l] + k + w[i][l];
+            e[l] = d[l]; d[l] = c[l]; c[l] = rotl(b[l], 30); b[l] = a[l]; a[l] = t;
+        }
+    }
+
+    for (unsigned l = 0; l < SHA1_LANES; l++) {
+        const uint32_t state[5] = {a[l] + IV[0], b[l] + IV[1], c[l] + IV[2], d[l] + IV[3], e[l] + IV[4]};
+        unsigned char* out = digests + 20 * l;
+        for (int i = 0; i < 5; i++) {
+            out[4*i]     = (unsigned char)(state[i] >> 24);
+            out[4*i + 1] = (unsigned char)(state[i] >> 16);
+            out[4*i + 2] = (unsigned char)(state[i] >> 8);
+            out[4*i + 3] = (unsigned char)(state[i]);
+        }
+    }
+}
+
+} // namespace sha1lanes
+
+#endif // SHA1_LANES_HPP